@@ -0,0 +1,449 @@
+// Microbenchmarks over a synthetic APK corpus. APKs are generated once per parameter set and cached
+// in the corpus directory; results go out as JSON, one record per benchmark and APK.
+//
+//   apksig_bench [--corpus DIR] [--sizes 1M,16M,256M,1G,4000M] [--signers N] [--certs N] [--attrs N]
+//                [--comment BYTES] [--threads N] [--min-time SECONDS] [--out FILE]
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "apksig/apksig.hpp"
+#include "apksig/cert_cache.hpp"
+#include "apksig/sign.hpp"
+#include "apksig/verify.hpp"
+#include "inflate.hpp"
+#include "signing_block_format.hpp"
+#include "write_utils.hpp"
+#include "zip_format.hpp"
+
+#ifndef APKSIG_BENCH_CORPUS_DIR
+#define APKSIG_BENCH_CORPUS_DIR "bench-corpus"
+#endif
+
+namespace {
+
+std::atomic<uint64_t> allocations{0};
+
+}  // namespace
+
+// Counts allocations for allocations/op. Array and aligned forms end up here or are rare enough to
+// leave out. Kept out of line so the compiler doesn't pair the inlined malloc/free with new/delete
+// expressions.
+[[gnu::noinline]] void* operator new(std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size == 0 ? 1 : size)) return p;
+  throw std::bad_alloc();
+}
+[[gnu::noinline]] void operator delete(void* p) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+using apksig::detail::append_le;
+using apksig::detail::append_len_prefixed;
+using apksig::detail::write_bytes;
+
+// A self-signed P-256 certificate, so certificate parsing and hashing see a real X.509 structure.
+constexpr uint8_t fixture_certificate[] = {
+    0x30, 0x82, 0x01, 0x84, 0x30, 0x82, 0x01, 0x2b, 0xa0, 0x03, 0x02, 0x01, 0x02, 0x02, 0x14, 0x56,
+    0x12, 0x86, 0xfc, 0x4e, 0x17, 0x9d, 0x35, 0x89, 0x40, 0xd2, 0x1f, 0xe6, 0xcd, 0x04, 0x00, 0xbc,
+    0x1b, 0x8f, 0x42, 0x30, 0x0a, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x04, 0x03, 0x02, 0x30,
+    0x17, 0x31, 0x15, 0x30, 0x13, 0x06, 0x03, 0x55, 0x04, 0x03, 0x0c, 0x0c, 0x61, 0x70, 0x6b, 0x73,
+    0x69, 0x67, 0x20, 0x62, 0x65, 0x6e, 0x63, 0x68, 0x30, 0x20, 0x17, 0x0d, 0x32, 0x36, 0x31, 0x30,
+    0x31, 0x36, 0x31, 0x32, 0x33, 0x37, 0x34, 0x34, 0x5a, 0x18, 0x0f, 0x32, 0x31, 0x32, 0x36, 0x30,
+    0x39, 0x32, 0x32, 0x31, 0x32, 0x33, 0x37, 0x34, 0x34, 0x5a, 0x30, 0x17, 0x31, 0x15, 0x30, 0x13,
+    0x06, 0x03, 0x55, 0x04, 0x03, 0x0c, 0x0c, 0x61, 0x70, 0x6b, 0x73, 0x69, 0x67, 0x20, 0x62, 0x65,
+    0x6e, 0x63, 0x68, 0x30, 0x59, 0x30, 0x13, 0x06, 0x07, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x02, 0x01,
+    0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x03, 0x01, 0x07, 0x03, 0x42, 0x00, 0x04, 0xdd, 0xbf,
+    0x97, 0xd1, 0x3c, 0x95, 0x94, 0x0c, 0x13, 0x16, 0xdb, 0x6e, 0x40, 0xea, 0xb7, 0xf7, 0xd0, 0xc3,
+    0xb5, 0x5b, 0xb0, 0xd0, 0xc6, 0xf7, 0xe7, 0xd2, 0xd3, 0xb1, 0x54, 0x65, 0xf7, 0xb7, 0x73, 0x31,
+    0xdb, 0x76, 0xa2, 0x4a, 0x32, 0xee, 0xea, 0x29, 0x80, 0xba, 0xe5, 0x64, 0x27, 0x3c, 0xc9, 0x5b,
+    0x45, 0x34, 0xc3, 0x23, 0x2d, 0xb4, 0xb5, 0xa7, 0x64, 0x5c, 0x9a, 0xd6, 0x35, 0x07, 0xa3, 0x53,
+    0x30, 0x51, 0x30, 0x1d, 0x06, 0x03, 0x55, 0x1d, 0x0e, 0x04, 0x16, 0x04, 0x14, 0xdb, 0x16, 0x67,
+    0x09, 0x4d, 0xbd, 0xd1, 0x7a, 0x97, 0x5d, 0x69, 0x34, 0x8f, 0x46, 0x85, 0xe5, 0x68, 0x44, 0x8e,
+    0x94, 0x30, 0x1f, 0x06, 0x03, 0x55, 0x1d, 0x23, 0x04, 0x18, 0x30, 0x16, 0x80, 0x14, 0xdb, 0x16,
+    0x67, 0x09, 0x4d, 0xbd, 0xd1, 0x7a, 0x97, 0x5d, 0x69, 0x34, 0x8f, 0x46, 0x85, 0xe5, 0x68, 0x44,
+    0x8e, 0x94, 0x30, 0x0f, 0x06, 0x03, 0x55, 0x1d, 0x13, 0x01, 0x01, 0xff, 0x04, 0x05, 0x30, 0x03,
+    0x01, 0x01, 0xff, 0x30, 0x0a, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x04, 0x03, 0x02, 0x03,
+    0x47, 0x00, 0x30, 0x44, 0x02, 0x20, 0x6f, 0x4b, 0x66, 0xa1, 0x6b, 0x60, 0x3b, 0x6d, 0xa2, 0xec,
+    0x5e, 0xb0, 0xd9, 0x28, 0xcd, 0x62, 0x60, 0xa0, 0x4d, 0x71, 0xb3, 0x46, 0x79, 0x3c, 0xe2, 0xc0,
+    0x54, 0x2e, 0xef, 0xae, 0xfe, 0x11, 0x02, 0x20, 0x29, 0xda, 0xfc, 0x07, 0x83, 0x4e, 0x56, 0xee,
+    0x2c, 0xe6, 0x62, 0x86, 0x55, 0x4e, 0x84, 0x2f, 0x09, 0x8c, 0x39, 0x02, 0xee, 0x69, 0xdf, 0xd6,
+    0x1f, 0x13, 0x4f, 0x87, 0xee, 0x06, 0x0c, 0x5a,
+};
+
+struct corpus_params {
+  uint64_t size = 0;
+  unsigned signers = 1;
+  unsigned certs = 1;
+  unsigned attrs = 0;
+  unsigned comment = 0;
+};
+
+struct options {
+  std::filesystem::path corpus = APKSIG_BENCH_CORPUS_DIR;
+  std::vector<uint64_t> sizes{1ull << 20, 16ull << 20, 256ull << 20};
+  corpus_params params;
+  unsigned threads = 0;
+  double min_time = 1.0;
+  std::filesystem::path out;
+};
+
+std::vector<uint8_t> len_prefixed_seq(const std::vector<std::vector<uint8_t>>& elements) {
+  std::vector<uint8_t> out;
+  for (const auto& e : elements) append_len_prefixed(out, e);
+  return out;
+}
+
+class xorshift {
+ public:
+  explicit xorshift(uint64_t seed) : state_(seed | 1) {}
+
+  uint64_t next() noexcept {
+    state_ ^= state_ << 13;
+    state_ ^= state_ >> 7;
+    state_ ^= state_ << 17;
+    return state_;
+  }
+
+  std::vector<uint8_t> bytes(size_t n) {
+    std::vector<uint8_t> out(n);
+    fill(out.data(), n);
+    return out;
+  }
+
+  void fill(uint8_t* p, size_t n) noexcept {
+    for (size_t i = 0; i < n; i++) p[i] = static_cast<uint8_t>(next() >> 56);
+  }
+
+ private:
+  uint64_t state_;
+};
+
+// A v2 block whose signers carry the requested certificates and attributes. Digests, signatures
+// and keys are random: the parse benchmarks never verify them.
+std::vector<uint8_t> signing_block(const corpus_params& params, xorshift& rng) {
+  const std::vector<uint8_t> cert(std::begin(fixture_certificate), std::end(fixture_certificate));
+  std::vector<std::vector<uint8_t>> signers;
+  for (unsigned s = 0; s < params.signers; s++) {
+    std::vector<uint8_t> digest;
+    append_le<uint32_t>(digest, 0x0103);
+    append_len_prefixed(digest, rng.bytes(32));
+    std::vector<std::vector<uint8_t>> attrs;
+    for (unsigned a = 0; a < params.attrs; a++) {
+      std::vector<uint8_t> attr;
+      append_le<uint32_t>(attr, 0x10000 + a);
+      const auto value = rng.bytes(16);
+      attr.insert(attr.end(), value.cbegin(), value.cend());
+      attrs.push_back(std::move(attr));
+    }
+    std::vector<uint8_t> signed_data;
+    append_len_prefixed(signed_data, len_prefixed_seq({digest}));
+    append_len_prefixed(signed_data, len_prefixed_seq(std::vector<std::vector<uint8_t>>(params.certs, cert)));
+    append_len_prefixed(signed_data, len_prefixed_seq(attrs));
+    append_le<uint32_t>(signed_data, 0);
+
+    std::vector<uint8_t> signature;
+    append_le<uint32_t>(signature, 0x0103);
+    append_len_prefixed(signature, rng.bytes(256));
+    std::vector<uint8_t> signer;
+    append_len_prefixed(signer, signed_data);
+    append_len_prefixed(signer, len_prefixed_seq({signature}));
+    append_len_prefixed(signer, rng.bytes(294));
+    signers.push_back(std::move(signer));
+  }
+
+  std::vector<uint8_t> v2_value;
+  append_len_prefixed(v2_value, len_prefixed_seq(signers));
+  return apksig::encode_signing_block({{apksig::detail::v2_block_id, v2_value}}, false);
+}
+
+// Stored entries of pseudo-random bytes adding up to params.size, the signing block, the central
+// directory and an EOCD record with a params.comment byte comment. Entries stay below 4 GiB and
+// the whole file below the 32-bit ZIP offsets.
+void write_apk(const std::filesystem::path& fpath, const corpus_params& params) {
+  constexpr uint64_t max_entry_size = 512ull << 20;
+  constexpr size_t buffer_size = 1 << 20;
+  if (params.size > 0xffffffffull - (64ull << 20)) throw std::runtime_error("APK size needs ZIP64");
+
+  const auto tmp_fpath = std::filesystem::path(fpath).concat(".tmp");
+  std::ofstream ofs(tmp_fpath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+  ofs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+  xorshift rng(params.size);
+  std::vector<uint8_t> buffer(buffer_size);
+  std::vector<uint8_t> cd;
+  uint16_t entry_count = 0;
+
+  for (uint64_t written = 0; written < params.size || entry_count == 0; entry_count++) {
+    const auto entry_size = static_cast<uint32_t>(std::min(max_entry_size, params.size - written));
+    const auto name = "assets/blob" + std::to_string(entry_count) + ".bin";
+    const auto local_offset = static_cast<uint32_t>(ofs.tellp());
+
+    std::vector<uint8_t> header;
+    append_le<uint32_t>(header, 0x04034b50);
+    append_le<uint16_t>(header, 20);
+    append_le<uint16_t>(header, 0);
+    append_le<uint16_t>(header, 0);
+    append_le<uint16_t>(header, 0);
+    append_le<uint16_t>(header, 0x21);
+    append_le<uint32_t>(header, 0);  // CRC, patched below.
+    append_le<uint32_t>(header, entry_size);
+    append_le<uint32_t>(header, entry_size);
+    append_le<uint16_t>(header, static_cast<uint16_t>(name.size()));
+    append_le<uint16_t>(header, 0);
+    header.insert(header.end(), name.cbegin(), name.cend());
+    write_bytes(ofs, header);
+
+    uint32_t crc = 0;
+    for (uint64_t left = entry_size; left > 0;) {
+      const auto n = static_cast<size_t>(std::min<uint64_t>(left, buffer_size));
+      rng.fill(buffer.data(), n);
+      crc = apksig::detail::crc32_update(crc, buffer.data(), n);
+      ofs.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(n));
+      left -= n;
+    }
+    const auto end = ofs.tellp();
+    std::vector<uint8_t> crc_bytes;
+    append_le<uint32_t>(crc_bytes, crc);
+    ofs.seekp(static_cast<std::streamoff>(local_offset) + 14);
+    write_bytes(ofs, crc_bytes);
+    ofs.seekp(end);
+    written += entry_size;
+
+    append_le<uint32_t>(cd, 0x02014b50);
+    append_le<uint16_t>(cd, 20);
+    append_le<uint16_t>(cd, 20);
+    append_le<uint16_t>(cd, 0);
+    append_le<uint16_t>(cd, 0);
+    append_le<uint16_t>(cd, 0);
+    append_le<uint16_t>(cd, 0x21);
+    append_le<uint32_t>(cd, crc);
+    append_le<uint32_t>(cd, entry_size);
+    append_le<uint32_t>(cd, entry_size);
+    append_le<uint16_t>(cd, static_cast<uint16_t>(name.size()));
+    append_le<uint16_t>(cd, 0);
+    append_le<uint16_t>(cd, 0);
+    append_le<uint16_t>(cd, 0);
+    append_le<uint16_t>(cd, 0);
+    append_le<uint32_t>(cd, 0);
+    append_le<uint32_t>(cd, local_offset);
+    cd.insert(cd.end(), name.cbegin(), name.cend());
+  }
+
+  write_bytes(ofs, signing_block(params, rng));
+  const auto cd_offset = static_cast<uint32_t>(ofs.tellp());
+  write_bytes(ofs, cd);
+
+  std::vector<uint8_t> eocd;
+  append_le<uint32_t>(eocd, 0x06054b50);
+  append_le<uint16_t>(eocd, 0);
+  append_le<uint16_t>(eocd, 0);
+  append_le<uint16_t>(eocd, entry_count);
+  append_le<uint16_t>(eocd, entry_count);
+  append_le<uint32_t>(eocd, static_cast<uint32_t>(cd.size()));
+  append_le<uint32_t>(eocd, cd_offset);
+  append_le<uint16_t>(eocd, static_cast<uint16_t>(params.comment));
+  // A comment without the EOCD magic in it, so the search has to scan all of it.
+  eocd.resize(eocd.size() + params.comment, 'c');
+  write_bytes(ofs, eocd);
+  ofs.close();
+  std::filesystem::rename(tmp_fpath, fpath);
+}
+
+std::filesystem::path corpus_apk(const options& opts, uint64_t size) {
+  const auto& p = opts.params;
+  const auto name = "apk-" + std::to_string(size) + "-s" + std::to_string(p.signers) + "-c" + std::to_string(p.certs) +
+                    "-a" + std::to_string(p.attrs) + "-m" + std::to_string(p.comment) + ".apk";
+  const auto fpath = opts.corpus / name;
+  if (!std::filesystem::exists(fpath)) {
+    std::cerr << "generating " << fpath.string() << "\n";
+    std::filesystem::create_directories(opts.corpus);
+    auto params = p;
+    params.size = size;
+    write_apk(fpath, params);
+  }
+  return fpath;
+}
+
+struct bench_result {
+  std::string name;
+  uint64_t apk_size;
+  uint64_t iterations;
+  double ns_per_op;
+  double bytes_per_second;
+  double allocations_per_op;
+};
+
+// Runs f once to warm up, then repeatedly until min_time has passed.
+template <class F>
+bench_result run(const std::string& name, uint64_t apk_size, uint64_t bytes_per_op, double min_time, F f) {
+  using clock = std::chrono::steady_clock;
+  f();
+  uint64_t iterations = 0;
+  const auto allocations_before = allocations.load(std::memory_order_relaxed);
+  const auto start = clock::now();
+  auto elapsed = clock::duration::zero();
+  do {
+    f();
+    iterations++;
+    elapsed = clock::now() - start;
+  } while (std::chrono::duration<double>(elapsed).count() < min_time);
+  const auto allocated = allocations.load(std::memory_order_relaxed) - allocations_before;
+
+  const auto ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+  const auto ns_per_op = ns / static_cast<double>(iterations);
+  return {name,
+          apk_size,
+          iterations,
+          ns_per_op,
+          static_cast<double>(bytes_per_op) / (ns_per_op / 1e9),
+          static_cast<double>(allocated) / static_cast<double>(iterations)};
+}
+
+std::vector<bench_result> run_all(const options& opts) {
+  std::vector<bench_result> results;
+  const std::vector<uint8_t> cert(std::begin(fixture_certificate), std::end(fixture_certificate));
+  results.push_back(run("certificate_hashing", 0, cert.size(), opts.min_time,
+                        [&] { apksig::interned_certificate interned(cert); }));
+
+  for (const auto size : opts.sizes) {
+    const auto fpath = corpus_apk(opts, size);
+    const auto file_size = std::filesystem::file_size(fpath);
+
+    // The EOCD locator alone: one read of the search window and the backward scan over it.
+    std::ifstream ifs(fpath, std::ios_base::in | std::ios_base::binary);
+    ifs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+    const auto window_size = std::min<uint64_t>(file_size, apksig::detail::eocd_max_distance);
+    std::vector<uint8_t> window(static_cast<size_t>(window_size));
+    results.push_back(run("eocd_search", size, window_size, opts.min_time, [&] {
+      ifs.seekg(static_cast<std::streamoff>(file_size - window_size));
+      ifs.read(reinterpret_cast<char*>(window.data()), static_cast<std::streamsize>(window.size()));
+      if (!apksig::detail::find_eocd(window.data(), window.size())) throw std::runtime_error("No EOCD record");
+    }));
+
+    apksig::siginfo probe{fpath};
+    probe.parse();
+    const auto& sections = probe.get_sections();
+
+    // Opening the file, the EOCD search, the footer read and one header read per pair.
+    const auto try_parse_bytes = window_size + apksig::detail::signing_block_footer_size +
+                                 probe.get_pairs().size() * apksig::detail::pair_header_size;
+    results.push_back(run("try_parse", size, try_parse_bytes, opts.min_time, [&] {
+      apksig::siginfo info{fpath};
+      if (!info.try_parse()) throw std::runtime_error("Corpus APK does not parse");
+    }));
+
+    const auto block_size = sections.cd_offset - sections.signing_block_offset;
+    results.push_back(run("signing_block_parse", size, block_size, opts.min_time, [&] {
+      apksig::siginfo info{fpath};
+      info.parse();
+      if (info.get_v2_block().signers.size() != opts.params.signers) throw std::runtime_error("Signer count mismatch");
+    }));
+
+    apksig::content_digest_options digest_opts;
+    digest_opts.algos = {apksig::content_digest_algo::chunked_sha256};
+    digest_opts.threads = opts.threads;
+    results.push_back(run("content_digest_sha256", size, file_size, opts.min_time,
+                          [&] { apksig::compute_content_digests(fpath, sections, digest_opts); }));
+  }
+  return results;
+}
+
+void write_json(std::ostream& os, const options& opts, const std::vector<bench_result>& results) {
+  const auto& p = opts.params;
+  os << "{\n  \"corpus\": {\"signers\": " << p.signers << ", \"certs\": " << p.certs << ", \"attrs\": " << p.attrs
+     << ", \"comment\": " << p.comment << "},\n  \"results\": [\n";
+  for (size_t i = 0; i < results.size(); i++) {
+    const auto& r = results[i];
+    os << "    {\"name\": \"" << r.name << "\", \"apk_size\": " << r.apk_size << ", \"iterations\": " << r.iterations
+       << ", \"ns_per_op\": " << r.ns_per_op << ", \"bytes_per_second\": " << r.bytes_per_second
+       << ", \"allocations_per_op\": " << r.allocations_per_op << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  os << "  ]\n}\n";
+}
+
+// "4G", "256M", "64K" or plain bytes.
+uint64_t parse_size(std::string_view s) {
+  uint64_t unit = 1;
+  switch (s.empty() ? '\0' : s.back()) {
+    case 'G':
+      unit = 1ull << 30;
+      break;
+    case 'M':
+      unit = 1ull << 20;
+      break;
+    case 'K':
+      unit = 1ull << 10;
+      break;
+  }
+  if (unit != 1) s.remove_suffix(1);
+  return std::stoull(std::string(s)) * unit;
+}
+
+options parse_args(int argc, const char* argv[]) {
+  options opts;
+  for (int i = 1; i < argc; i++) {
+    const std::string_view arg = argv[i];
+    if (i + 1 == argc) throw std::invalid_argument("Missing value for " + std::string(arg));
+    const std::string value = argv[++i];
+    if (arg == "--corpus") {
+      opts.corpus = value;
+    } else if (arg == "--sizes") {
+      opts.sizes.clear();
+      for (size_t pos = 0; pos <= value.size();) {
+        const auto comma = std::min(value.find(',', pos), value.size());
+        opts.sizes.push_back(parse_size(std::string_view(value).substr(pos, comma - pos)));
+        pos = comma + 1;
+      }
+    } else if (arg == "--signers") {
+      opts.params.signers = static_cast<unsigned>(std::stoul(value));
+    } else if (arg == "--certs") {
+      opts.params.certs = static_cast<unsigned>(std::stoul(value));
+    } else if (arg == "--attrs") {
+      opts.params.attrs = static_cast<unsigned>(std::stoul(value));
+    } else if (arg == "--comment") {
+      opts.params.comment = static_cast<unsigned>(std::min(std::stoul(value), 0xfffful));
+    } else if (arg == "--threads") {
+      opts.threads = static_cast<unsigned>(std::stoul(value));
+    } else if (arg == "--min-time") {
+      opts.min_time = std::stod(value);
+    } else if (arg == "--out") {
+      opts.out = value;
+    } else {
+      throw std::invalid_argument("Unknown option " + std::string(arg));
+    }
+  }
+  return opts;
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+  try {
+    const auto opts = parse_args(argc, argv);
+    const auto results = run_all(opts);
+    if (opts.out.empty()) {
+      write_json(std::cout, opts, results);
+    } else {
+      std::ofstream ofs(opts.out);
+      ofs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+      write_json(ofs, opts, results);
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "apksig_bench: " << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
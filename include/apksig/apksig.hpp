@@ -1,10 +1,16 @@
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
-#include <fstream>
+#include <istream>
+#include <memory>
 #include <stdexcept>
 #include <vector>
 
+#include "apksig/central_directory.hpp"
+#include "apksig/limits.hpp"
+#include "apksig/manifest.hpp"
+
 namespace apksig {
 
 struct digest {
@@ -35,35 +41,159 @@ using public_key = std::vector<uint8_t>;
 struct v2_signer {
   v2_signed_data signed_data;
   std::vector<signature> signatures;
-  public_key public_key;
+  ::apksig::public_key public_key;
+  // signed_data as encoded in the block, which is what the signatures cover.
+  std::vector<uint8_t> signed_data_bytes;
 };
 
 struct v2_block {
   std::vector<v2_signer> signers;
 };
 
+struct v3_signed_data {
+  std::vector<digest> digests;
+  std::vector<certificate> certificates;
+  uint32_t min_sdk;
+  uint32_t max_sdk;
+  std::vector<add_attr> add_attrs;
+};
+
+struct v3_signer {
+  v3_signed_data signed_data;
+  uint32_t min_sdk;
+  uint32_t max_sdk;
+  std::vector<signature> signatures;
+  ::apksig::public_key public_key;
+  std::vector<uint8_t> signed_data_bytes;
+};
+
+// Also the layout of the v3.1 block.
+struct v3_block {
+  std::vector<v3_signer> signers;
+};
+
+// A stamp signature over the content digests of one signature scheme.
+struct source_stamp_signed_digest {
+  // 1: JAR signing, 2: v2, 3: v3.
+  uint32_t scheme_id;
+  std::vector<signature> signatures;
+};
+
+// The SourceStamp block (V2 layout) an app store adds to attest where an APK came from.
+struct source_stamp {
+  certificate stamp_certificate;
+  std::vector<source_stamp_signed_digest> signed_digests;
+  // Encoded attributes, as signed by stamp_attribute_signatures.
+  std::vector<uint8_t> signed_stamp_attributes;
+  std::vector<signature> stamp_attribute_signatures;
+};
+
+// File offsets of the regions of an APK that matter for signing. The ZIP entries occupy
+// [0, signing_block_offset), the APK Signing Block [signing_block_offset, cd_offset), the central
+// directory [cd_offset, eocd_offset) and the EOCD record [eocd_offset, file_size).
+struct apk_sections {
+  uint64_t signing_block_offset = 0;
+  uint64_t cd_offset = 0;
+  uint64_t eocd_offset = 0;
+  uint64_t file_size = 0;
+};
+
+// One ID-value pair of the APK Signing Block, known or not. The value occupies
+// [value_offset, value_offset + value_size) of the file.
+struct id_value_pair {
+  uint32_t id;
+  uint64_t value_offset;
+  uint64_t value_size;
+};
+
+enum class parse_errc {
+  ok,
+  // The stream could not be sought or read.
+  io_error,
+  // No EOCD record in the last 64 KiB + 22 bytes.
+  not_a_zip,
+  central_directory_out_of_range,
+  no_signing_block,
+  // The footer's block size is out of range, or the block's leading size disagrees with it.
+  bad_signing_block_size,
+  bad_id_value_pair,
+  // The signing block is larger than parse_limits::max_block_size, or decoding a block would
+  // exceed another of the parse_limits.
+  limit_exceeded,
+  // A v2, v3, v3.1 or SourceStamp block does not decode. offset is the start of its value.
+  bad_block,
+  // Memory for the pair table or a decoded block could not be allocated.
+  out_of_memory,
+};
+
+// Outcome of siginfo::try_parse(). offset is the file offset the error refers to.
+struct parse_status {
+  parse_errc code = parse_errc::ok;
+  uint64_t offset = 0;
+
+  explicit operator bool() const noexcept { return code == parse_errc::ok; }
+  const char* message() const noexcept;
+};
+
+// What throws: parse() throws parse_error. The block getters and the read_* functions throw
+// parse_error on malformed input or exceeded limits and std::ios_base::failure on read errors,
+// except that after try_decode() returned ok the getters no longer throw. The constructors only
+// throw std::bad_alloc; a file that can't be opened is reported by parse() and try_parse().
 class siginfo {
  public:
-  siginfo(const std::filesystem::path& apk_file_path);
+  siginfo(const std::filesystem::path& apk_file_path, const parse_limits& limits = {});
+  // Parses from an arbitrary seekable stream. Stream positions are taken as file offsets. Streams
+  // that are good get failbit and badbit exceptions enabled.
+  explicit siginfo(std::unique_ptr<std::istream> is, const parse_limits& limits = {});
+  siginfo(siginfo&&) noexcept;
+  siginfo& operator=(siginfo&&) noexcept;
+  ~siginfo();
 
   bool has_v2_block() const noexcept { return v2_block_pos_ != -1; };
   bool has_v3_block() const noexcept { return v3_block_pos_ != -1; };
   bool has_v3_1_block() const noexcept { return v3_1_block_pos_ != -1; };
+  bool has_source_stamp() const noexcept;
+  // Locates the signing block and its pairs. Blocks are decoded on first access through the
+  // getters below, which may be called from several threads at once.
   void parse();
-  const v2_block& get_v2_block() const noexcept { return v2_block_; }
+  // Same as parse(), but reports malformed or unreadable input through the returned status
+  // instead of throwing. Reads go straight to the stream buffer, so the stream's exception mask
+  // doesn't apply.
+  parse_status try_parse() noexcept;
+  // Decodes every block the getters below return, reporting the first failure through the returned
+  // status instead of throwing. Call after a successful try_parse().
+  parse_status try_decode() noexcept;
+  const v2_block& get_v2_block() const;
+  const v3_block& get_v3_block() const;
+  const v3_block& get_v3_1_block() const;
+  // Empty when the APK carries no stamp.
+  const source_stamp& get_source_stamp() const;
+  const apk_sections& get_sections() const noexcept { return sections_; }
+  // Every pair of the signing block in block order, as found by parse().
+  const std::vector<id_value_pair>& get_pairs() const noexcept { return pairs_; }
+  // The first pair with this id, or nullptr.
+  const id_value_pair* find_pair(uint32_t id) const noexcept;
+  // Reads the value of a pair on request.
+  std::vector<uint8_t> read_pair_value(const id_value_pair& pair);
+  // Reads and indexes the central directory located by parse().
+  central_directory read_central_directory();
+  // Reads the identity fields of AndroidManifest.xml through the same stream, see read_manifest().
+  manifest_info read_manifest();
 
  private:
-  std::ifstream ifs_;
+  parse_status locate_pairs();
+
+  std::unique_ptr<std::istream> is_;
+  parse_limits limits_;
+  apk_sections sections_;
+  std::vector<id_value_pair> pairs_;
   std::streampos v2_block_pos_ = -1;
   std::streampos v3_block_pos_ = -1;
   std::streampos v3_1_block_pos_ = -1;
-  v2_block v2_block_;
-
-  static constexpr std::array<std::uint8_t, 4> eocd_magic{0x50, 0x4B, 0x05, 0x06};
-  static constexpr std::string_view apk_magic{"APK Sig Block 42"};
-  static constexpr uint32_t v2_id = 0x7109871a;
-  static constexpr uint32_t v3_id = 0xf05368c0;
-  static constexpr uint32_t v3_1_id = 0x1b93ad61;
+  // Memoized decoded blocks and the lock that serializes stream access, kept on the heap so
+  // siginfo stays movable.
+  struct lazy_blocks;
+  std::unique_ptr<lazy_blocks> lazy_;
 };
 
 class parse_error : public std::runtime_error {
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <istream>
+#include <string_view>
+#include <vector>
+
+#include "apksig/limits.hpp"
+
+namespace apksig {
+
+struct cd_entry {
+  // Points into the owning central_directory's name arena.
+  std::string_view name;
+  uint64_t local_header_offset = 0;
+  uint64_t compressed_size = 0;
+  uint64_t uncompressed_size = 0;
+  uint16_t method = 0;
+  uint32_t crc32 = 0;
+};
+
+// Index over a ZIP central directory, built in one linear pass over a single read of the
+// directory. Names live in one arena and are found through an open addressing hash table. Movable
+// but not copyable, since entries point into the arena.
+class central_directory {
+ public:
+  // Reads and indexes the directory at [cd_offset, cd_offset + cd_size) of is. Throws parse_error
+  // if cd_size exceeds limits.max_central_directory_size.
+  static central_directory read(std::istream& is, uint64_t cd_offset, uint64_t cd_size,
+                                const parse_limits& limits = {});
+  // Locates the directory through the EOCD record of a ZIP file.
+  static central_directory read(const std::filesystem::path& zip_file_path, const parse_limits& limits = {});
+
+  central_directory(central_directory&&) noexcept = default;
+  central_directory& operator=(central_directory&&) noexcept = default;
+  central_directory(const central_directory&) = delete;
+  central_directory& operator=(const central_directory&) = delete;
+
+  // nullptr if there is no entry with that exact name.
+  const cd_entry* find(std::string_view name) const noexcept;
+  // In directory order.
+  const std::vector<cd_entry>& entries() const noexcept { return entries_; }
+  // Where the directory starts. Entry data lies before it.
+  uint64_t offset() const noexcept { return offset_; }
+
+ private:
+  central_directory() = default;
+  void build_table();
+
+  uint64_t offset_ = 0;
+  std::vector<char> arena_;
+  std::vector<cd_entry> entries_;
+  // Entry index + 1 per slot, 0 for empty slots. The size is a power of two.
+  std::vector<uint32_t> slots_;
+};
+
+// Offset of the entry's data, which starts after its local header. The local header's extra field
+// may differ from the central directory's, so it has to be read.
+uint64_t entry_data_offset(std::istream& is, const cd_entry& entry);
+
+// Reads an entry's uncompressed contents, inflating deflated entries and checking the CRC-32. The
+// entry's data must end by data_end, normally the central directory's offset(), and neither of its
+// sizes may exceed max_size, normally parse_limits::max_entry_size, which bounds what is allocated. Throws parse_error for other
+// compression methods, sizes out of range or corrupt data.
+std::vector<uint8_t> read_entry(std::istream& is, const cd_entry& entry, uint64_t data_end, uint64_t max_size);
+
+}  // namespace apksig
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+#include "apksig/apksig.hpp"
+
+struct mbedtls_x509_crt;
+
+namespace apksig {
+
+// A certificate with the fingerprints callers usually want, hashed once over its raw DER. The
+// X.509 parse happens on first use of x509() or public_key() only, so fingerprinting works for
+// certificates mbedtls can't load (DSA keys, leniently encoded legacy certificates). Safe to share
+// between threads.
+class interned_certificate {
+ public:
+  explicit interned_certificate(const certificate& der);
+  interned_certificate(const interned_certificate&) = delete;
+  interned_certificate& operator=(const interned_certificate&) = delete;
+  ~interned_certificate();
+
+  const certificate& der() const noexcept;
+  const std::array<uint8_t, 32>& sha256() const noexcept;
+  const std::array<uint8_t, 20>& sha1() const noexcept;
+  // Whether mbedtls parses the certificate.
+  bool has_x509() const;
+  // DER encoded SubjectPublicKeyInfo. Throws parse_error unless has_x509().
+  const ::apksig::public_key& public_key() const;
+  // Throws parse_error unless has_x509().
+  const mbedtls_x509_crt& x509() const;
+
+ private:
+  struct impl;
+  std::unique_ptr<impl> impl_;
+};
+
+// Maps certificate bytes to their interned_certificate, so each distinct certificate is hashed (and
+// parsed, if asked to) once no matter how many APKs carry it. Lookups and inserts are thread-safe;
+// hashing happens outside the cache lock, so two threads interning the same new certificate may
+// both hash it, but both get the one that was cached.
+class certificate_cache {
+ public:
+  certificate_cache() = default;
+  certificate_cache(const certificate_cache&) = delete;
+  certificate_cache& operator=(const certificate_cache&) = delete;
+
+  // The process-wide instance.
+  static certificate_cache& global();
+
+  std::shared_ptr<const interned_certificate> intern(const certificate& der);
+  size_t size() const;
+  void clear();
+
+ private:
+  mutable std::mutex mutex_;
+  // Keys view the DER owned by the interned certificate.
+  std::unordered_map<std::string_view, std::shared_ptr<const interned_certificate>> entries_;
+};
+
+// Shorthand for certificate_cache::global().intern(der).
+std::shared_ptr<const interned_certificate> intern_certificate(const certificate& der);
+
+}  // namespace apksig
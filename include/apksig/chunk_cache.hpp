@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "apksig/apksig.hpp"
+#include "apksig/digest.hpp"
+
+namespace apksig {
+
+struct chunk_record {
+  uint64_t offset;
+  uint32_t size;
+  // checksum64 of the chunk bytes, see change_detection::checksum.
+  uint64_t checksum;
+};
+
+// The chunk digests of one content digest computation, enough to recombine the top-level digests
+// later after rehashing only the chunks that changed. Covers chunked algorithms only.
+struct chunk_digest_cache {
+  apk_sections sections;
+  std::vector<content_digest_algo> algos;
+  // In digest order: ZIP entries, central directory, EOCD.
+  std::vector<chunk_record> chunks;
+  // chunk_digests[i] holds one digest of algos[i] per chunk.
+  std::vector<std::vector<uint8_t>> chunk_digests;
+};
+
+enum class change_detection {
+  // Read every chunk and compare a fast non-cryptographic checksum with the recorded one. Meant
+  // for trusted input: it does not withstand deliberately colliding modifications.
+  checksum,
+  // Compare every chunk byte for byte with a copy of the previously digested file.
+  reference_copy,
+  // Trust the caller's list of modified byte ranges. Unchanged chunks are not even read.
+  dirty_ranges,
+};
+
+struct byte_range {
+  uint64_t offset;
+  uint64_t size;
+};
+
+struct change_detector {
+  change_detection mode = change_detection::checksum;
+  std::filesystem::path reference_copy;
+  std::vector<byte_range> dirty_ranges;
+};
+
+void save_chunk_cache(const std::filesystem::path& cache_file_path, const chunk_digest_cache& cache);
+chunk_digest_cache load_chunk_cache(const std::filesystem::path& cache_file_path);
+
+}  // namespace apksig
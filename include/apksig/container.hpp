@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "apksig/apksig.hpp"
+
+namespace apksig {
+
+// An APK stored inside a ZIP container such as .apks, .xapk or an APEX.
+struct nested_apk {
+  std::string name;
+  // Range of the entry data within the container.
+  uint64_t offset = 0;
+  uint64_t size = 0;
+  // Only stored (uncompressed) entries can be parsed in place.
+  bool stored = false;
+};
+
+struct nested_apk_result {
+  nested_apk entry;
+  // Parsed through a view of the container; reads go to the container file.
+  std::optional<siginfo> info;
+  // Why info is empty.
+  std::string error;
+};
+
+// Lists the entries of the container's central directory whose names end in .apk or .apex.
+std::vector<nested_apk> find_nested_apks(const std::filesystem::path& container_file_path);
+
+// Parses the signing blocks of every nested APK in place, without extracting anything, spreading
+// the entries across threads (0 uses every hardware thread). Failures are reported per entry.
+std::vector<nested_apk_result> scan_container(const std::filesystem::path& container_file_path,
+                                              unsigned threads = 0);
+
+}  // namespace apksig
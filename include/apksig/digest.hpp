@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace apksig {
+
+// Content digest algorithms of the v2+ signature schemes. The values match the IDs used by the
+// reference implementation so they can be encoded as is.
+enum class content_digest_algo : uint32_t {
+  chunked_sha256 = 1,
+  chunked_sha512 = 2,
+  verity_chunked_sha256 = 3,
+};
+
+// Maps a signature algorithm ID (as found in digest::sig_algo_id) to the content digest it signs.
+std::optional<content_digest_algo> content_digest_algo_of(uint32_t sig_algo_id) noexcept;
+
+size_t digest_size(content_digest_algo algo) noexcept;
+
+// Orders content digests for picking one where any would do, lowest first: chunked SHA-512, which
+// is at least as strong as SHA-256 and cheaper to compute on 64-bit CPUs, then chunked SHA-256, then
+// verity, which hashes every 4 KiB block salted plus the tree levels above them.
+int content_digest_preference(content_digest_algo algo) noexcept;
+
+struct content_digest {
+  content_digest_algo algo;
+  std::vector<uint8_t> digest_data;
+};
+
+// Incrementally computes a chunked content digest. Every chunk of at most chunk_size bytes is
+// digested on its own and the top-level digest is taken over the concatenated chunk digests.
+// Chunks never span sections, so each section has to be fed separately.
+class chunked_digester {
+ public:
+  static constexpr size_t chunk_size = 1024 * 1024;  // 1MiB
+
+  explicit chunked_digester(content_digest_algo algo);
+
+  // Writes the digest of a single chunk to out, digest_size(algo) bytes.
+  static void digest_chunk(content_digest_algo algo, const uint8_t* data, size_t size, uint8_t* out);
+
+  void add_chunk(const uint8_t* data, size_t size);
+  // Appends count chunk digests computed elsewhere, e.g. on other threads.
+  void add_chunk_digests(const uint8_t* digests, uint32_t count);
+  void add_section(const uint8_t* data, size_t size);
+  std::vector<uint8_t> finish() const;
+
+  content_digest_algo algo() const noexcept { return algo_; }
+  uint32_t chunk_count() const noexcept { return chunk_count_; }
+
+ private:
+  content_digest_algo algo_;
+  uint32_t chunk_count_ = 0;
+  std::vector<uint8_t> chunk_digests_;
+};
+
+}  // namespace apksig
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <streambuf>
+#include <vector>
+
+namespace apksig {
+
+// Read-only stream buffer over bytes held in memory. Positions are reported relative to
+// base_offset, which lets a tail of a larger file be parsed with the file's own offsets. Seeking
+// outside [base_offset, base_offset + size] fails.
+class memory_streambuf : public std::streambuf {
+ public:
+  explicit memory_streambuf(std::shared_ptr<const std::vector<uint8_t>> bytes, uint64_t base_offset = 0);
+
+ protected:
+  pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+  pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+
+ private:
+  std::shared_ptr<const std::vector<uint8_t>> bytes_;
+  uint64_t base_offset_;
+};
+
+class memory_istream : public std::istream {
+ public:
+  explicit memory_istream(std::shared_ptr<const std::vector<uint8_t>> bytes, uint64_t base_offset = 0);
+
+ private:
+  memory_streambuf buf_;
+};
+
+// Read-only stream buffer over the byte range [offset, offset + size) of a file, with positions
+// relative to offset, so an archive member can be parsed in place as if it were a file of its own.
+// Each instance opens its own handle to the file.
+class file_range_streambuf : public std::streambuf {
+ public:
+  file_range_streambuf(const std::filesystem::path& file, uint64_t offset, uint64_t size);
+
+ protected:
+  int_type underflow() override;
+  std::streamsize xsgetn(char_type* s, std::streamsize n) override;
+  pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+  pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+
+ private:
+  uint64_t position() const noexcept;
+  // Reads up to n bytes at range position pos, bypassing the buffer.
+  size_t read_at(uint64_t pos, char* out, size_t n);
+
+  std::filebuf file_;
+  uint64_t offset_;
+  uint64_t size_;
+  // Range position of the first buffered byte.
+  uint64_t buf_pos_ = 0;
+  std::vector<char> buf_;
+};
+
+class file_range_istream : public std::istream {
+ public:
+  file_range_istream(const std::filesystem::path& file, uint64_t offset, uint64_t size);
+
+ private:
+  file_range_streambuf buf_;
+};
+
+}  // namespace apksig
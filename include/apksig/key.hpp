@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "apksig/apksig.hpp"
+
+namespace apksig {
+
+// Private key loaded through mbedtls, together with the certificate chain that vouches for it
+// (leaf first). Signing is serialized internally, so a key can be shared between threads.
+class signing_key {
+ public:
+  // key_data and cert_data may be PEM or DER.
+  signing_key(const std::vector<uint8_t>& key_data, const std::vector<uint8_t>& cert_data,
+              std::string_view password = {});
+  signing_key(signing_key&&) noexcept;
+  signing_key& operator=(signing_key&&) noexcept;
+  ~signing_key();
+
+  static signing_key load(const std::filesystem::path& key_file, const std::filesystem::path& cert_file,
+                          std::string_view password = {});
+
+  const std::vector<certificate>& certificates() const noexcept;
+  // DER encoded SubjectPublicKeyInfo.
+  const ::apksig::public_key& public_key() const noexcept;
+  // The SHA2-256 based signature algorithm ID matching the key type.
+  uint32_t default_sig_algo_id() const;
+
+  std::vector<uint8_t> sign(uint32_t sig_algo_id, const uint8_t* data, size_t size) const;
+
+ private:
+  struct impl;
+  std::unique_ptr<impl> impl_;
+};
+
+}  // namespace apksig
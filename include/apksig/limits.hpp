@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace apksig {
+
+// Bounds on what parsing one APK may consume, whatever its length fields claim. Every nested length
+// is checked against its enclosing element before anything is allocated, so a siginfo holds at
+// most max_total_allocation bytes of decoded blocks plus a 64 KiB parse buffer and a pair table
+// proportional to max_block_size. Reads of the central directory and of whole ZIP entries are
+// bounded by the last two fields.
+struct parse_limits {
+  // The whole APK Signing Block, both size fields included.
+  uint64_t max_block_size = 32 * 1024 * 1024;
+  size_t max_signers = 10;
+  // Per signer.
+  size_t max_certificates = 16;
+  // Shared by all blocks decoded through one siginfo, bookkeeping included.
+  uint64_t max_total_allocation = 64 * 1024 * 1024;
+  // The central directory, which is read whole to be indexed.
+  uint64_t max_central_directory_size = 64 * 1024 * 1024;
+  // Compressed and uncompressed size of each ZIP entry read whole: AndroidManifest.xml, and the
+  // signature files and entries checked by verify_v1().
+  uint64_t max_entry_size = 512 * 1024 * 1024;
+};
+
+}  // namespace apksig
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <istream>
+#include <optional>
+#include <string>
+
+#include "apksig/central_directory.hpp"
+#include "apksig/limits.hpp"
+
+namespace apksig {
+
+// The identity fields of AndroidManifest.xml. Fields given as resource references, or SDK versions
+// given as codenames, are left empty.
+struct manifest_info {
+  std::string package;
+  std::optional<uint32_t> version_code;
+  std::string version_name;
+  std::optional<int32_t> min_sdk_version;
+  std::optional<int32_t> target_sdk_version;
+};
+
+// Streams through the chunks of a binary XML (AXML) manifest, decoding only the strings of the
+// attributes it extracts, and stops once the <manifest> and <uses-sdk> elements were seen.
+manifest_info parse_binary_manifest(const uint8_t* data, size_t size);
+
+// Reads AndroidManifest.xml out of an APK through its central directory. The entry may be at most
+// limits.max_entry_size, and the directory read from a path at most max_central_directory_size.
+manifest_info read_manifest(std::istream& apk, const central_directory& dir, const parse_limits& limits = {});
+manifest_info read_manifest(const std::filesystem::path& apk_file_path, const parse_limits& limits = {});
+
+}  // namespace apksig
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "apksig/limits.hpp"
+
+namespace apksig {
+
+struct probe_result {
+  bool has_signing_block = false;
+  bool has_v2 = false;
+  bool has_v3 = false;
+  bool has_v3_1 = false;
+  // A v4 signature lives next to the APK, as <apk>.idsig, rather than inside it.
+  bool has_v4 = false;
+  uint64_t signing_block_offset = 0;
+  // Whole block, both size fields included.
+  uint64_t signing_block_size = 0;
+  // IDs of every ID-value pair in block order, known or not.
+  std::vector<uint32_t> pair_ids;
+};
+
+// Reports which signature schemes an APK carries without parsing any of them. The last tail_size
+// bytes are read in one go; when the signing block doesn't fit in them, one positional read fetches
+// its footer and one more the block itself, never the central directory in between. Throws
+// parse_error, with the message of the matching parse_errc, when the file is not a ZIP, the signing
+// block is malformed, or it is larger than limits.max_block_size. The size is checked before the
+// block is read.
+probe_result probe(const std::filesystem::path& apk_file_path, size_t tail_size = 64 * 1024,
+                   const parse_limits& limits = {});
+
+}  // namespace apksig
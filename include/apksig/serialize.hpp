@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "apksig/apksig.hpp"
+
+namespace apksig {
+
+// Bytes owned by someone else, typically a mapped or received serialized siginfo.
+struct byte_view {
+  const uint8_t* data = nullptr;
+  size_t size = 0;
+
+  bool empty() const noexcept { return size == 0; }
+  const uint8_t* begin() const noexcept { return data; }
+  const uint8_t* end() const noexcept { return data + size; }
+  std::vector<uint8_t> to_vector() const { return {begin(), end()}; }
+};
+
+// An (ID, bytes) element: digests and signatures (ID is a signature algorithm) and additional
+// attributes (ID is the attribute ID).
+struct id_bytes_view {
+  uint32_t id;
+  byte_view bytes;
+};
+
+// A v2, v3 or v3.1 signer, pointing into the serialized bytes. The SDK range is 0 for v2.
+struct signer_view {
+  // What the signatures cover.
+  byte_view signed_data;
+  std::vector<id_bytes_view> digests;
+  std::vector<byte_view> certificates;
+  std::vector<id_bytes_view> add_attrs;
+  uint32_t min_sdk = 0;
+  uint32_t max_sdk = 0;
+  std::vector<id_bytes_view> signatures;
+  byte_view public_key;
+};
+
+// Serializes what parse() found: the APK sections, the whole ID-value pair table and the raw values
+// of the v2, v3, v3.1 and source stamp pairs. The values keep the signing block's own encoding, so
+// reading them back needs no translation. Layout, all integers little endian:
+//
+//   "APKSIGSI"  u32 version  u32 pair count
+//   u64 signing block offset, cd offset, eocd offset, file size
+//   per pair: u32 id, u32 flags (1: value embedded), u64 value offset in the APK, u64 value size,
+//             u64 offset of the embedded value in this buffer (0 if not embedded)
+//   embedded values
+std::vector<uint8_t> serialize_siginfo(siginfo& info);
+
+// Reads serialized siginfo in place. The constructor checks the header and that everything the
+// pair table points at lies within the buffer; blocks are decoded into views on request. Nothing
+// is copied, so data must outlive the view and everything obtained from it.
+class siginfo_view {
+ public:
+  siginfo_view(const uint8_t* data, size_t size);
+
+  const apk_sections& sections() const noexcept { return sections_; }
+  const std::vector<id_value_pair>& pairs() const noexcept { return pairs_; }
+  // The embedded value of the first pair with this id, or an empty view.
+  byte_view pair_value(uint32_t id) const noexcept;
+
+  bool has_v2_block() const noexcept;
+  bool has_v3_block() const noexcept;
+  bool has_v3_1_block() const noexcept;
+  bool has_source_stamp() const noexcept;
+  // Throw parse_error when the embedded block is malformed.
+  std::vector<signer_view> v2_signers() const;
+  std::vector<signer_view> v3_signers() const;
+  std::vector<signer_view> v3_1_signers() const;
+
+ private:
+  apk_sections sections_;
+  std::vector<id_value_pair> pairs_;
+  // Parallel to pairs_, empty for pairs that were not embedded.
+  std::vector<byte_view> values_;
+};
+
+}  // namespace apksig
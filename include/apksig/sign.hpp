@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "apksig/apksig.hpp"
+#include "apksig/digest.hpp"
+#include "apksig/key.hpp"
+
+namespace apksig {
+
+// An ID-value pair to be written into an APK Signing Block.
+struct signing_block_pair {
+  uint32_t id;
+  std::vector<uint8_t> value;
+};
+
+struct sign_options {
+  // Signature algorithms every signer signs with, e.g. 0x0103 and 0x0421. The content digests
+  // they sign are what gets computed. Empty picks the key's default_sig_algo_id(). Verity
+  // algorithms need the ZIP entries to end on a 4 KiB boundary.
+  std::vector<uint32_t> sig_algo_ids;
+  bool v2 = true;
+  bool v3 = true;
+  // SDK range of the v3 signer.
+  uint32_t min_sdk = 28;
+  uint32_t max_sdk = 0x7fffffff;
+  // Written after the signature pairs in this order, e.g. a SourceStamp block.
+  std::vector<signing_block_pair> extra_pairs;
+  // 0 uses every hardware thread.
+  unsigned threads = 0;
+};
+
+struct align_options {
+  // Stored entries start at a multiple of this.
+  uint32_t alignment = 4;
+  // Stored .so entries, so the platform can map them straight from the APK. 0 uses alignment.
+  uint32_t native_library_alignment = 16 * 1024;
+};
+
+// Encodes a complete APK Signing Block: the leading size, the pairs in order, the trailing size
+// and the magic. With verity_padding, a zero filled padding pair makes the block size a multiple
+// of 4 KiB.
+std::vector<uint8_t> encode_signing_block(const std::vector<signing_block_pair>& pairs, bool verity_padding);
+
+// The v2 and v3 pairs (as enabled in opts) of a single signer with key, signing the given content
+// digests. Every algorithm of opts.sig_algo_ids needs its content digest in digests.
+std::vector<signing_block_pair> make_signature_pairs(const std::vector<content_digest>& digests,
+                                                     const signing_key& key, const sign_options& opts);
+
+// Signs an APK with key. The ZIP entries are copied to output_apk, followed by the new signing
+// block, the central directory and the EOCD record with the central directory offset rewritten.
+// An existing signing block of input_apk is replaced. Content digests are computed across threads
+// in one read of the input and the copy is streamed, so neither holds the APK in memory.
+void sign_apk(const std::filesystem::path& input_apk_path, const std::filesystem::path& output_apk_path,
+              const signing_key& key, const sign_options& opts = {});
+
+// zipalign and sign_apk() in one pass: one read of input_apk and one write of output_apk. Entries
+// are copied in file order, each stored entry's local header extra field padded so its data is
+// aligned, and the 1 MiB content chunks are hashed across threads as they are written. The
+// signing block, the central directory with the new local header offsets and the EOCD record
+// follow. Verity algorithms are not supported here, since the tree needs the final size up front.
+void align_and_sign(const std::filesystem::path& input_apk_path, const std::filesystem::path& output_apk_path,
+                    const signing_key& key, const sign_options& sign_opts = {}, const align_options& align_opts = {});
+
+}  // namespace apksig
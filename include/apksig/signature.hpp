@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "apksig/apksig.hpp"
+
+namespace apksig {
+
+enum class signature_status {
+  valid,
+  invalid,
+  // DSA or an unknown signature algorithm ID.
+  unsupported_algorithm,
+  // The public key could not be parsed.
+  bad_public_key,
+};
+
+// One signature to check. The pointed-to data must outlive the verification call.
+struct signature_request {
+  const ::apksig::public_key* public_key;
+  uint32_t sig_algo_id;
+  const uint8_t* data;
+  size_t size;
+  const std::vector<uint8_t>* signature;
+};
+
+// Verifies signatures with a bounded LRU of parsed public keys, keyed by the SHA-256 of their
+// SubjectPublicKeyInfo, so repeated signers only pay for key parsing and RSA/EC setup once.
+// Thread-safe; checks against the same key are serialized.
+class signature_verifier {
+ public:
+  explicit signature_verifier(size_t capacity = 1024);
+  signature_verifier(const signature_verifier&) = delete;
+  signature_verifier& operator=(const signature_verifier&) = delete;
+  ~signature_verifier();
+
+  signature_status verify(const signature_request& request);
+  // Groups the requests by public key, so each key is looked up once per batch, and verifies the
+  // groups across threads (0 uses every hardware thread). Results are in request order.
+  std::vector<signature_status> verify_batch(const std::vector<signature_request>& requests, unsigned threads = 1);
+
+  size_t cached_keys() const;
+  // Number of keys parsed so far, i.e. cache misses.
+  size_t key_setups() const noexcept;
+
+ private:
+  struct impl;
+  std::unique_ptr<impl> impl_;
+};
+
+// One request per signature of signer, each over signer.signed_data_bytes.
+std::vector<signature_request> signature_requests(const v2_signer& signer);
+std::vector<signature_request> signature_requests(const v3_signer& signer);
+
+}  // namespace apksig
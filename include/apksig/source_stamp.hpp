@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "apksig/apksig.hpp"
+#include "apksig/digest.hpp"
+#include "apksig/signature.hpp"
+
+namespace apksig {
+
+// The content digests of one signature scheme's signer, which is what a source stamp signs for
+// that scheme.
+struct stamp_scheme_digests {
+  // 1: JAR signing, 2: v2, 3: v3.
+  uint32_t scheme_id;
+  std::vector<content_digest> digests;
+};
+
+struct source_stamp_result {
+  bool verified = false;
+  // Identifies who stamped the APK.
+  std::array<uint8_t, 32> certificate_sha256{};
+  std::string error;
+};
+
+// The digests carried by the first v2 and v3 signers of info, one entry per scheme present.
+std::vector<stamp_scheme_digests> stamp_digests(const siginfo& info);
+
+// Checks that the stamp certificate's key signed the digests of every given scheme, and the stamp
+// attributes. Digests are used as given, nothing is rehashed: pass the ones verify_contents
+// already checked against the APK. Without a verifier a temporary one is used.
+source_stamp_result verify_source_stamp(const source_stamp& stamp, const std::vector<stamp_scheme_digests>& schemes,
+                                        signature_verifier* verifier = nullptr);
+
+// Same, for the stamp and the v2/v3 signer digests of info.
+source_stamp_result verify_source_stamp(const siginfo& info, signature_verifier* verifier = nullptr);
+
+}  // namespace apksig
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "apksig/signature.hpp"
+#include "apksig/verify.hpp"
+
+namespace apksig {
+
+struct split_verify_options {
+  bool verify_signatures = true;
+  bool verify_contents = true;
+  // Check only the cheapest content digest of each signer, see content_verify_options.
+  bool cheapest_digest_only = true;
+  // 0 uses every hardware thread. Splits are verified concurrently, leftover threads go to hashing.
+  unsigned threads = 0;
+  // Shared key cache, so the keys of the base are reused for its splits. Optional.
+  signature_verifier* verifier = nullptr;
+  // Platform SDK version the signer is selected for, see verify_split_set().
+  uint32_t sdk_version = 34;
+};
+
+// One certificate of a v3 signer's proof-of-rotation lineage.
+struct lineage_node {
+  std::array<uint8_t, 32> certificate_sha256;
+  // Capabilities the certificate keeps after rotation, e.g. 1 for installed data.
+  uint32_t flags;
+};
+
+struct split_report {
+  std::filesystem::path path;
+  // Set when the split could not be parsed or verified at all.
+  std::string error;
+  // Scheme of the selected signers: 2, 3, or 31 for v3.1.
+  uint32_t scheme = 0;
+  // SHA-256 of each signer's signing certificate, sorted. This is the split's signer set.
+  std::vector<std::array<uint8_t, 32>> signer_certificates;
+  // Per signer: every supported signature verifies and there is at least one.
+  std::vector<bool> signers_verified;
+  std::vector<content_verify_result> contents;
+  // Proof-of-rotation lineage of a v3 or v3.1 signer, oldest certificate first and ending with the
+  // signing certificate. Empty without rotation. With verify_signatures, each node's signature by
+  // its predecessor is checked as part of verified.
+  std::vector<lineage_node> lineage;
+  // Same signer set as the first split.
+  bool matches_base = false;
+  bool verified = false;
+};
+
+struct split_set_report {
+  std::vector<split_report> splits;
+  // The lineages of all splits agree: any two are equal, or the shorter one is the tail of the
+  // longer. Capability flags are not compared.
+  bool lineages_compatible = false;
+  // Every split parsed and has the signer set of the first one, and the lineages are compatible.
+  bool consistent = false;
+  // consistent, and every split verified.
+  bool verified = false;
+};
+
+// Parses and verifies a base APK (first) and its splits concurrently, then checks that every split
+// is signed by the same signers as the base, as the package installer requires. Signers are
+// selected the way the installer does for opts.sdk_version: the v3.1 signer whose SDK range covers
+// it, else the v3 one, else the v2 signers. Certificates go through the process-wide
+// certificate_cache.
+split_set_report verify_split_set(const std::vector<std::filesystem::path>& apk_file_paths,
+                                  const split_verify_options& opts = {});
+
+}  // namespace apksig
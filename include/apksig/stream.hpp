@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <istream>
+#include <vector>
+
+#include "apksig/apksig.hpp"
+#include "apksig/digest.hpp"
+
+namespace apksig {
+
+struct stream_options {
+  // Upper bound on the bytes held back while streaming. It has to cover the APK Signing Block, the
+  // central directory and the EOCD record; anything older is digested and dropped.
+  size_t max_tail_size = 64 * 1024 * 1024;  // 64MiB
+  std::vector<content_digest_algo> digest_algos{content_digest_algo::chunked_sha256};
+};
+
+struct stream_result {
+  siginfo info;
+  std::vector<content_digest> content_digests;
+  uint64_t size;
+};
+
+// Forward-only APK parser for non-seekable input (pipes, sockets, stdin). Bytes are fed in order;
+// full chunks falling out of the bounded tail are digested on the fly and the EOCD and signing
+// block are located in the retained tail once the input ends.
+class stream_parser {
+ public:
+  explicit stream_parser(stream_options opts = {});
+
+  void update(const uint8_t* data, size_t size);
+  stream_result finish();
+
+ private:
+  void evict_front_chunk();
+
+  stream_options opts_;
+  std::vector<chunked_digester> digesters_;
+  std::deque<std::vector<uint8_t>> tail_;
+  uint64_t tail_offset_ = 0;
+  uint64_t size_ = 0;
+};
+
+// Reads is until EOF and parses it with a stream_parser.
+stream_result parse_stream(std::istream& is, stream_options opts = {});
+
+}  // namespace apksig
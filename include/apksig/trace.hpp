@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+
+namespace apksig {
+
+// Phases the library records trace events for when built with APKSIG_TRACING (the CMake option of
+// that name). Without it the instrumentation compiles to nothing.
+enum class trace_phase : uint8_t {
+  eocd_search,
+  footer_read,
+  pair_iteration,
+  v2_decode,
+  // Parsing and hashing a certificate when it is first interned.
+  cert_hashing,
+  // Reads of the content digest pass, on the thread driving it.
+  content_read,
+  // Hashing of one content chunk, on a worker thread.
+  content_digest,
+  signature_verify,
+};
+
+const char* trace_phase_name(trace_phase phase) noexcept;
+
+constexpr bool tracing_enabled() noexcept {
+#ifdef APKSIG_TRACING
+  return true;
+#else
+  return false;
+#endif
+}
+
+// Writes the events recorded so far by every thread in the Chrome trace event format, which
+// chrome://tracing and Perfetto load. Each event carries its thread, start, duration and the
+// number of bytes the phase processed. Events other threads record meanwhile may be left out.
+// Writing doesn't consume the events, see clear_trace().
+void write_chrome_trace(std::ostream& os);
+void write_chrome_trace(const std::filesystem::path& json_file_path);
+
+// Drops every recorded event and frees the buffers holding them, so a long-running process can
+// write one trace per unit of work. Threads keep their (now empty) buffers. No other thread may be
+// running instrumented library code meanwhile.
+void clear_trace();
+
+}  // namespace apksig
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "apksig/apksig.hpp"
+
+namespace apksig {
+
+struct v1_verify_options {
+  // 0 uses every hardware thread.
+  unsigned threads = 0;
+  // Bounds the central directory and each entry, which is read whole. Every worker holds one entry
+  // at a time.
+  parse_limits limits;
+};
+
+struct v1_signer_result {
+  // Base name of the signature file, e.g. "CERT" for META-INF/CERT.SF.
+  std::string name;
+  ::apksig::certificate certificate;
+  // The PKCS #7 block verifies over the .SF file.
+  bool signature_verified = false;
+  // The .SF file's digests match MANIFEST.MF.
+  bool manifest_verified = false;
+  std::string error;
+};
+
+struct v1_entry_result {
+  std::string name;
+  bool verified = false;
+  std::string error;
+};
+
+struct v1_verify_result {
+  // META-INF/MANIFEST.MF exists.
+  bool present = false;
+  // Every signer and every entry verified, and there is at least one signer.
+  bool verified = false;
+  std::vector<v1_signer_result> signers;
+  // Every ZIP entry outside the signature files, in central directory order.
+  std::vector<v1_entry_result> entries;
+  std::string error;
+};
+
+// Verifies the JAR signature (APK Signature Scheme v1): each META-INF/*.SF file against its
+// PKCS #7 block and against MANIFEST.MF, and every entry against its manifest digest. Entries are
+// inflated and digested in parallel. Throws parse_error when the central directory or MANIFEST.MF
+// can't be read within opts.limits; other failures are reported in the result.
+v1_verify_result verify_v1(const std::filesystem::path& apk_file_path, const v1_verify_options& opts = {});
+
+}  // namespace apksig
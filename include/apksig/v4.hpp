@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+#include "apksig/apksig.hpp"
+#include "apksig/key.hpp"
+
+namespace apksig {
+
+struct v4_hashing_info {
+  uint32_t hash_algorithm;  // 1: SHA-256
+  uint8_t log2_blocksize;
+  std::vector<uint8_t> salt;
+  std::vector<uint8_t> raw_root_hash;
+};
+
+struct v4_signing_info {
+  std::vector<uint8_t> apk_digest;
+  ::apksig::certificate certificate;
+  std::vector<uint8_t> additional_data;
+  ::apksig::public_key public_key;
+  uint32_t sig_algo_id;
+  std::vector<uint8_t> signature;
+};
+
+// Contents of an .idsig file.
+struct v4_signature {
+  uint32_t version;
+  v4_hashing_info hashing_info;
+  v4_signing_info signing_info;
+  // Whatever follows the signing info inside the signing infos (additional signing info blocks).
+  std::vector<uint8_t> signing_info_blocks;
+  // Empty when the file carries no tree.
+  std::vector<uint8_t> merkle_tree;
+};
+
+v4_signature parse_v4_signature(std::istream& is);
+v4_signature parse_v4_signature(const std::filesystem::path& idsig_file_path);
+
+void write_v4_signature(std::ostream& os, const v4_signature& sig);
+void write_v4_signature(const std::filesystem::path& idsig_file_path, const v4_signature& sig);
+
+// The bytes a v4 signature signs: the APK size followed by the hashing info and the signing info
+// without its signature.
+std::vector<uint8_t> v4_signed_data(uint64_t apk_size, const v4_hashing_info& hashing_info,
+                                    const v4_signing_info& signing_info);
+
+// Builds the Merkle tree over the APK across threads and signs it with key. The APK must already
+// carry a v3 or v2 signature. The preferred content digest of the v3 signer, or of the v2 signer
+// without a v3 block, becomes the v4 apk_digest.
+v4_signature generate_v4_signature(const std::filesystem::path& apk_file_path, const signing_key& key,
+                                   unsigned threads = 0);
+
+// Rebuilds the Merkle tree over the APK and checks it against the root hash (and the tree, when
+// present) of the v4 signature.
+bool verify_v4_merkle_tree(const std::filesystem::path& apk_file_path, const v4_signature& sig, unsigned threads = 0);
+
+}  // namespace apksig
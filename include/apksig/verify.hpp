@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "apksig/apksig.hpp"
+#include "apksig/chunk_cache.hpp"
+#include "apksig/digest.hpp"
+
+namespace apksig {
+
+struct content_digest_options {
+  std::vector<content_digest_algo> algos;
+  // Also compute the SHA-256 of the whole file, signing block included, in the same pass.
+  bool whole_file_sha256 = false;
+  // 0 uses every hardware thread.
+  unsigned threads = 0;
+  // Chunk digests recorded by an earlier run. Chunks that detection finds unchanged keep their
+  // recorded digests instead of being rehashed.
+  const chunk_digest_cache* previous = nullptr;
+  change_detector detection;
+  // Below 1, only this fraction of the ZIP entry chunks (picked at random from sample_seed) plus
+  // every central directory and EOCD chunk is read and hashed; all other chunks take their digests
+  // from `previous`, which must describe the same file layout. Chunked algorithms only.
+  double sample_ratio = 1.0;
+  uint64_t sample_seed = 0;
+  // Receives the chunk digests of this run.
+  chunk_digest_cache* record = nullptr;
+};
+
+struct content_digest_set {
+  std::vector<content_digest> digests;
+  // Empty unless requested.
+  std::vector<uint8_t> whole_file_sha256;
+  size_t hashed_chunks = 0;
+  size_t reused_chunks = 0;
+};
+
+struct content_verify_options {
+  // Only check the content digest that is cheapest to compute instead of every digest the signer
+  // carries. All digests are signed, so any of them proves the contents.
+  bool cheapest_only = false;
+  bool whole_file_sha256 = false;
+  // 0 uses every hardware thread.
+  unsigned threads = 0;
+  // When set, verification starts from the chunk digests in *cache (if it holds any for this
+  // file's algorithms) and leaves this run's chunk digests in it for the next verification.
+  chunk_digest_cache* cache = nullptr;
+  change_detector detection;
+  // Spot-check mode: below 1, only a seeded random sample of the ZIP entry chunks plus the
+  // central directory and EOCD chunks is hashed and compared against *cache, which must come
+  // from an earlier full verification of the same file. The cache is left untouched.
+  double sample_ratio = 1.0;
+  uint64_t sample_seed = 0;
+};
+
+struct content_digest_check {
+  content_digest_algo algo;
+  std::vector<uint8_t> expected;
+  std::vector<uint8_t> computed;
+
+  bool matches() const noexcept { return expected == computed; }
+};
+
+struct content_verify_result {
+  // True when at least one digest was checked and every checked digest matches. In spot-check
+  // mode this only covers the sampled chunks, see `sampled`.
+  bool verified = false;
+  // Set when the result comes from spot-check mode: chunks outside the sample were not read, so
+  // the contents were not fully verified.
+  bool sampled = false;
+  // Fraction of the content chunks actually hashed.
+  double sample_ratio = 1.0;
+  std::vector<content_digest_check> checks;
+  std::vector<uint8_t> whole_file_sha256;
+  size_t hashed_chunks = 0;
+  size_t reused_chunks = 0;
+};
+
+// Computes every requested content digest in a single sequential read of the APK. Each chunk read
+// is fanned out to all requested hashers, chunks being hashed across threads while the next batch
+// is read. Verity digests require the signing block to start on a 4KiB boundary. With a previous
+// chunk digest cache only changed chunks are rehashed; with change_detection::dirty_ranges (and
+// neither verity nor a whole-file hash requested) unchanged chunks are not read at all.
+content_digest_set compute_content_digests(const std::filesystem::path& apk_file_path, const apk_sections& sections,
+                                           const content_digest_options& opts);
+
+std::vector<uint8_t> compute_content_digest(const std::filesystem::path& apk_file_path, const apk_sections& sections,
+                                            content_digest_algo algo, unsigned threads = 0);
+
+// Checks the APK contents against the digests of a signer's signed data, reading the file once
+// whatever the number of digests. Digests with unknown signature algorithms are skipped.
+content_verify_result verify_contents(const std::filesystem::path& apk_file_path, const apk_sections& sections,
+                                      const v2_signed_data& signed_data, const content_verify_options& opts = {});
+content_verify_result verify_contents(const std::filesystem::path& apk_file_path, const apk_sections& sections,
+                                      const v3_signed_data& signed_data, const content_verify_options& opts = {});
+
+}  // namespace apksig
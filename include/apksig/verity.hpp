@@ -0,0 +1,32 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace apksig {
+
+constexpr size_t verity_block_size = 4096;  // 4KiB
+
+struct verity_options {
+  // Prepended to every block before hashing.
+  std::vector<uint8_t> salt;
+  // 0 uses every hardware thread.
+  unsigned threads = 0;
+};
+
+// fs-verity style SHA-256 Merkle tree. Levels are stored top-down with every level padded to a
+// whole number of blocks, which is the layout .idsig files carry.
+struct merkle_tree {
+  std::vector<uint8_t> tree;
+  std::array<uint8_t, 32> root_hash{};
+  uint64_t data_size = 0;
+};
+
+// Builds the tree over a whole file. The leaf level is hashed from the file in parallel, upper
+// levels in memory, each level split across threads.
+merkle_tree build_merkle_tree(const std::filesystem::path& file, const verity_options& opts = {});
+
+}  // namespace apksig
@@ -3,9 +3,15 @@
 #include <fmt/ranges.h>
 #include <mbedtls/sha256.h>
 
+#include <cstdlib>
 #include <filesystem>
+#include <iostream>
+#include <string_view>
 
 #include "apksig/apksig.hpp"
+#include "apksig/cert_cache.hpp"
+#include "apksig/stream.hpp"
+#include "apksig/trace.hpp"
 
 namespace {
 
@@ -27,14 +33,26 @@ std::string hexstr(const uint8_t *p, size_t size) {
   }
   return out;
 }
+
+// "-" reads the APK from stdin, so the tool can sit at the end of a pipeline.
+apksig::siginfo open_siginfo(const char *fpath) {
+  if (std::string_view(fpath) == "-") {
+    // Only the signing block is printed, so skip the content digests.
+    apksig::stream_options opts;
+    opts.digest_algos.clear();
+    return apksig::parse_stream(std::cin, opts).info;
+  }
+  apksig::siginfo siginfo{std::filesystem::path(fpath)};
+  siginfo.parse();
+  return siginfo;
+}
 }  // namespace
 
 int main(int argc, const char *argv[]) {
   assert(argc == 2);
 
   const char *fpath = argv[1];
-  apksig::siginfo siginfo{std::filesystem::path(fpath)};
-  siginfo.parse();
+  const auto siginfo = open_siginfo(fpath);
   fmt::println("has v2 block: {}", siginfo.has_v2_block());
   fmt::println("has v3 block: {}", siginfo.has_v3_block());
 
@@ -44,12 +62,15 @@ int main(int argc, const char *argv[]) {
   for (const auto &signer : v2_block.signers) {
     const auto certificates = signer.signed_data.certificates;
     for (const auto &certificate : certificates) {
-      const auto cert_hash = sha256(certificate.data(), certificate.size());
+      const auto &cert_hash = apksig::intern_certificate(certificate)->sha256();
       fmt::println("cert hash: {}", hexstr(cert_hash.data(), cert_hash.size()));
     }
     const auto pk_hash = sha256(signer.public_key.data(), signer.public_key.size());
     fmt::println("pk sha256: {}", hexstr(pk_hash.data(), pk_hash.size()));
   }
 
+  if (const char *trace_file = std::getenv("APKSIG_TRACE_FILE"); trace_file != nullptr && apksig::tracing_enabled()) {
+    apksig::write_chrome_trace(std::filesystem::path(trace_file));
+  }
   return 0;
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "apksig/apksig.hpp"
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
@@ -8,201 +9,444 @@
 #include <ios>
 #include <istream>
 #include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <stdexcept>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
-namespace {
-
-template <class ForwardIt>
-std::streampos reverse_find_bytes(std::istream& is, ForwardIt pat_first, ForwardIt pat_last,
-                                  std::streampos start = -1) {
-  using value_type = typename std::iterator_traits<ForwardIt>::value_type;
-  static_assert(sizeof(value_type) == 1,
-                "The value type of ForwardIt should be byte like (std::byte, char, uint8_t etc.)");
-
-  if (start == -1) {
-    is.seekg(0, std::ios_base::end);
-  } else {
-    is.seekg(start);
-  }
+#include "read_utils.hpp"
+#include "signing_block_format.hpp"
+#include "trace.hpp"
+#include "zip_format.hpp"
 
-  const auto pat_size = std::distance(pat_first, pat_last);
-  if (pat_size == 0) return -1;
-  if (pat_size < 0) throw std::runtime_error("pat_first comes after pat_last");
+namespace {
 
-  constexpr size_t default_window_size = 4 * 1024;  // 4KiB
-  size_t window_size = std::max(default_window_size, static_cast<size_t>(pat_size));
-  std::vector<std::uint8_t> window_buffer(window_size);
-  std::vector<std::uint8_t> carry_buffer(static_cast<size_t>(pat_size) - 1);
+using apksig::detail::read_into_vector;
+using apksig::detail::read_le;
 
-  std::streampos current_pos = is.tellg();
+// Thrown when decoding would exceed the parse_limits, so try_decode() can tell it from malformed
+// input.
+class limit_error : public apksig::parse_error {
+  using apksig::parse_error::parse_error;
+};
 
-  while (current_pos > 0) {
-    const std::streampos pos = std::max(std::streampos(0), current_pos - static_cast<std::streamoff>(window_size));
-    window_buffer.resize(static_cast<size_t>(current_pos - pos));
-    is.seekg(pos);
-    is.read(reinterpret_cast<char*>(window_buffer.data()), static_cast<std::streamsize>(window_buffer.size()));
-    window_buffer.insert(window_buffer.end(), carry_buffer.cbegin(), carry_buffer.cend());
+// What the lazy block decodes of one siginfo have allocated, against its parse_limits.
+struct decode_budget {
+  const apksig::parse_limits& limits;
+  uint64_t& allocated;
 
-    for (auto it = window_buffer.crbegin() + pat_size; it != window_buffer.crend(); it++) {
-      if (std::equal(pat_first, pat_last, it.base() - 1)) {
-        return pos + static_cast<std::streamoff>(std::distance(window_buffer.cbegin(), it.base() - 1));
-      }
+  void charge(uint64_t n) {
+    if (n > limits.max_total_allocation - allocated) {
+      throw limit_error("Decoding the signing block exceeds the allocation limit");
     }
+    allocated += n;
+  }
+};
+
+// Reads one length-delimited element of a block. Every read is checked against what is left of the
+// element, so no nested length reaches past its enclosing element, and every allocation is charged
+// to the budget before it is made.
+class element_reader {
+ public:
+  element_reader(std::istream& is, uint64_t size, decode_budget& budget)
+      : is_(is), start_(is.tellg()), size_(size), left_(size), budget_(budget) {}
+
+  uint64_t left() const noexcept { return left_; }
+  decode_budget& budget() noexcept { return budget_; }
+
+  uint32_t u32() {
+    take(sizeof(uint32_t));
+    return read_le<uint32_t>(is_);
+  }
 
-    carry_buffer.assign(window_buffer.cbegin(), window_buffer.cbegin() + pat_size - 1);
-    current_pos = pos;
+  std::vector<uint8_t> bytes(uint64_t n) {
+    take(n);
+    budget_.charge(n);
+    return read_into_vector(is_, static_cast<size_t>(n));
   }
 
-  return -1;
-}
+  std::vector<uint8_t> len_prefixed() { return bytes(u32()); }
 
-template <size_t N, class T = uint8_t>
-std::array<T, N> read_into_array(std::istream& is) {
-  std::array<T, N> items_read;
-  is.read(reinterpret_cast<char*>(items_read.data()), std::streamsize(N));
-  return items_read;
-}
+  // The next length-prefixed element, which the caller reads to its end.
+  element_reader sub() {
+    const auto n = u32();
+    take(n);
+    return element_reader(is_, n, budget_);
+  }
 
-template <class T>
-T le_to_host(const uint8_t* p) noexcept {
-  static_assert(std::is_unsigned_v<T> && std::is_integral_v<T>, "T must be a unsigned integral type");
-  static_assert(sizeof(T) <= 8, "Supports up to 64-bit integers");
+  // The whole element as encoded, leaving the stream at its end.
+  std::vector<uint8_t> raw() {
+    budget_.charge(size_);
+    is_.seekg(start_);
+    left_ = 0;
+    return read_into_vector(is_, static_cast<size_t>(size_));
+  }
 
-  T v = 0;
-  for (std::size_t i = 0; i < sizeof(T); i++) {
-    v |= static_cast<T>(p[i]) << (8 * i);
+  // Skips whatever the element has left, such as fields of newer scheme revisions.
+  void skip_rest() {
+    is_.seekg(static_cast<std::streamoff>(left_), std::ios_base::cur);
+    left_ = 0;
   }
-  return v;
-}
 
-template <class T>
-T read_le(std::istream& is) {
-  const auto buf = read_into_array<sizeof(T)>(is);
-  return le_to_host<T>(buf.data());
-}
+ private:
+  void take(uint64_t n) {
+    if (n > left_) throw apksig::parse_error("Length exceeds its enclosing element");
+    left_ -= n;
+  }
 
-std::vector<uint8_t> read_into_vector(std::istream& is, size_t n) {
-  std::vector<uint8_t> out(n);
-  is.read(reinterpret_cast<char*>(out.data()), static_cast<std::streamsize>(n));
-  return out;
-}
+  std::istream& is_;
+  std::streampos start_;
+  uint64_t size_;
+  uint64_t left_;
+  decode_budget& budget_;
+};
+
+constexpr size_t unbounded = std::numeric_limits<size_t>::max();
 
+// Reads a length-prefixed sequence of length-prefixed elements, of at most max_count elements.
 template <class F>
-auto parse_len_prefixed_seq(uint32_t seq_len, std::istream& is, F f) {
-  std::vector<std::invoke_result_t<F, uint32_t, std::istream&>> out;
-  uint32_t parsed_len = 0;
-  while (parsed_len < seq_len) {
-    const auto len = read_le<uint32_t>(is);
-    out.push_back(f(len, is));
-    parsed_len += sizeof(len) + len;
-    if (parsed_len > seq_len) throw std::runtime_error("Incomplete sequence");
+auto read_seq(element_reader& r, size_t max_count, F f) {
+  using value_type = std::invoke_result_t<F, element_reader&>;
+  auto seq = r.sub();
+  std::vector<value_type> out;
+  while (seq.left() > 0) {
+    if (out.size() == max_count) throw limit_error("Too many elements in a signing block sequence");
+    auto element = seq.sub();
+    seq.budget().charge(sizeof(value_type));
+    out.push_back(f(element));
+    element.skip_rest();
   }
   return out;
 }
 
-apksig::digest parse_digest(uint32_t len, std::istream& is) {
-  const auto sig_algo_id = read_le<uint32_t>(is);
-  const auto digest_data_len = read_le<uint32_t>(is);
-  const auto digest_data = read_into_vector(is, digest_data_len);
+apksig::digest parse_digest(element_reader& r) {
+  const auto sig_algo_id = r.u32();
+  const auto digest_data = r.len_prefixed();
   return {sig_algo_id, digest_data};
 }
 
-apksig::certificate parse_certificate(uint32_t len, std::istream& is) { return read_into_vector(is, len); }
+apksig::certificate parse_certificate(element_reader& r) { return r.bytes(r.left()); }
 
-apksig::add_attr parse_add_attr(uint32_t len, std::istream& is) {
-  const auto id = read_le<uint32_t>(is);
-  const auto value_len = read_le<uint32_t>(is);
-  const auto value = read_into_vector(is, value_len);
+// The value takes up the rest of the attribute, it carries no length of its own.
+apksig::add_attr parse_add_attr(element_reader& r) {
+  const auto id = r.u32();
+  const auto value = r.bytes(r.left());
   return {id, value};
 }
 
-apksig::v2_signed_data parse_v2_signed_data(uint32_t len, std::istream& is) {
-  const auto digests_seq_len = read_le<uint32_t>(is);
-  const auto digests = parse_len_prefixed_seq(digests_seq_len, is, parse_digest);
-  const auto certificates_seq_len = read_le<uint32_t>(is);
-  const auto certificates = parse_len_prefixed_seq(certificates_seq_len, is, parse_certificate);
-  const auto add_attrs_seq_len = read_le<uint32_t>(is);
-  const auto add_attrs = parse_len_prefixed_seq(add_attrs_seq_len, is, parse_add_attr);
-  const auto x = read_le<uint32_t>(is);
+apksig::signature parse_signature(element_reader& r) {
+  const auto sig_algo_id = r.u32();
+  const auto sig_data = r.len_prefixed();
+  return {sig_algo_id, sig_data};
+}
+
+apksig::v2_signed_data parse_v2_signed_data(element_reader& r) {
+  const auto digests = read_seq(r, unbounded, parse_digest);
+  const auto certificates = read_seq(r, r.budget().limits.max_certificates, parse_certificate);
+  const auto add_attrs = read_seq(r, unbounded, parse_add_attr);
   return {digests, certificates, add_attrs};
 }
 
-apksig::signature parse_signature(uint32_t len, std::istream& is) {
-  const auto sig_algo_id = read_le<uint32_t>(is);
-  const auto sig_data_len = read_le<uint32_t>(is);
-  const auto sig_data = read_into_vector(is, sig_data_len);
-  return {sig_algo_id, sig_data};
+apksig::v2_signer parse_v2_signer(element_reader& r) {
+  auto signed_data_reader = r.sub();
+  const auto signed_data = parse_v2_signed_data(signed_data_reader);
+  const auto signed_data_bytes = signed_data_reader.raw();
+  const auto signatures = read_seq(r, unbounded, parse_signature);
+  const auto public_key = r.len_prefixed();
+  return {signed_data, signatures, public_key, signed_data_bytes};
 }
 
-apksig::public_key parse_public_key(uint32_t len, std::istream& is) { return read_into_vector(is, len); }
+apksig::v2_block parse_v2_block(element_reader& r) {
+  const auto signers = read_seq(r, r.budget().limits.max_signers, parse_v2_signer);
+  return {signers};
+}
+
+apksig::v3_signed_data parse_v3_signed_data(element_reader& r) {
+  const auto digests = read_seq(r, unbounded, parse_digest);
+  const auto certificates = read_seq(r, r.budget().limits.max_certificates, parse_certificate);
+  const auto min_sdk = r.u32();
+  const auto max_sdk = r.u32();
+  const auto add_attrs = read_seq(r, unbounded, parse_add_attr);
+  return {digests, certificates, min_sdk, max_sdk, add_attrs};
+}
 
-apksig::v2_signer parse_v2_signer(uint32_t len, std::istream& is) {
-  const auto signed_data_len = read_le<uint32_t>(is);
-  const auto signed_data = parse_v2_signed_data(signed_data_len, is);
-  const auto signatures_seq_len = read_le<uint32_t>(is);
-  const auto signatures = parse_len_prefixed_seq(signatures_seq_len, is, parse_signature);
-  const auto public_key_len = read_le<uint32_t>(is);
-  const auto public_key = parse_public_key(public_key_len, is);
-  return {signed_data, signatures, public_key};
+apksig::v3_signer parse_v3_signer(element_reader& r) {
+  auto signed_data_reader = r.sub();
+  const auto signed_data = parse_v3_signed_data(signed_data_reader);
+  const auto signed_data_bytes = signed_data_reader.raw();
+  const auto min_sdk = r.u32();
+  const auto max_sdk = r.u32();
+  const auto signatures = read_seq(r, unbounded, parse_signature);
+  const auto public_key = r.len_prefixed();
+  return {signed_data, min_sdk, max_sdk, signatures, public_key, signed_data_bytes};
 }
 
-apksig::v2_block parse_v2_block(uint32_t len, std::istream& is) {
-  const auto signers = parse_len_prefixed_seq(len, is, parse_v2_signer);
+apksig::v3_block parse_v3_block(element_reader& r) {
+  const auto signers = read_seq(r, r.budget().limits.max_signers, parse_v3_signer);
   return {signers};
 }
 
+apksig::source_stamp_signed_digest parse_source_stamp_signed_digest(element_reader& r) {
+  const auto scheme_id = r.u32();
+  const auto signatures = read_seq(r, unbounded, parse_signature);
+  return {scheme_id, signatures};
+}
+
+// The stamp is a single length-prefixed signer block.
+apksig::source_stamp parse_source_stamp(element_reader& r) {
+  auto signer = r.sub();
+  const auto stamp_certificate = signer.len_prefixed();
+  const auto signed_digests = read_seq(signer, unbounded, parse_source_stamp_signed_digest);
+  const auto signed_stamp_attributes = signer.len_prefixed();
+  const auto attr_signatures = read_seq(signer, unbounded, parse_signature);
+  return {stamp_certificate, signed_digests, signed_stamp_attributes, attr_signatures};
+}
+
+// Reads exactly n bytes at pos through the stream buffer, without involving the stream's state
+// or exception mask.
+bool read_at(std::streambuf& buf, uint64_t pos, uint8_t* out, size_t n) noexcept {
+  try {
+    const std::streampos target = static_cast<std::streamoff>(pos);
+    return buf.pubseekpos(target, std::ios_base::in) == target &&
+           buf.sgetn(reinterpret_cast<char*>(out), static_cast<std::streamsize>(n)) == static_cast<std::streamsize>(n);
+  } catch (...) {
+    return false;
+  }
+}
+
+// Decodes the value of pair, or returns an empty block when the pair is absent.
+template <class Block, class F>
+Block decode_block(std::istream& is, const apksig::id_value_pair* pair, decode_budget budget, F parse_block) {
+  if (pair == nullptr) return {};
+  is.seekg(static_cast<std::streamoff>(pair->value_offset));
+  element_reader r(is, pair->value_size, budget);
+  return parse_block(r);
+}
+
 }  // namespace
 
 namespace apksig {
 
-siginfo::siginfo(const std::filesystem::path& apk_fpath) : ifs_(apk_fpath, std::ios_base::in | std::ios_base::binary) {
-  ifs_.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+const char* parse_status::message() const noexcept {
+  switch (code) {
+    case parse_errc::ok:
+      return "No error";
+    case parse_errc::io_error:
+      return "Could not read the APK";
+    case parse_errc::not_a_zip:
+      return "Not a zip file, could not find EOCD Magic";
+    case parse_errc::central_directory_out_of_range:
+      return "Central directory offset past the EOCD record";
+    case parse_errc::no_signing_block:
+      return "APK signing block magic not found where expected";
+    case parse_errc::bad_signing_block_size:
+      return "APK signing block size out of range or inconsistent";
+    case parse_errc::bad_id_value_pair:
+      return "ID-value pair runs past the APK signing block";
+    case parse_errc::limit_exceeded:
+      return "APK signing block exceeds the parse_limits";
+    case parse_errc::bad_block:
+      return "APK signing block pair does not decode";
+    case parse_errc::out_of_memory:
+      return "Out of memory while parsing the APK signing block";
+  }
+  return "Unknown error";
+}
+
+struct siginfo::lazy_blocks {
+  std::mutex stream_mutex;
+  std::once_flag v2_once;
+  std::once_flag v3_once;
+  std::once_flag v3_1_once;
+  v2_block v2;
+  v3_block v3;
+  v3_block v3_1;
+  std::once_flag stamp_once;
+  source_stamp stamp;
+  // Charged against parse_limits::max_total_allocation by all decodes.
+  uint64_t allocated = 0;
+};
+
+siginfo::siginfo(const std::filesystem::path& apk_fpath, const parse_limits& limits)
+    : siginfo(std::make_unique<std::ifstream>(apk_fpath, std::ios_base::in | std::ios_base::binary), limits) {}
+
+siginfo::siginfo(std::unique_ptr<std::istream> is, const parse_limits& limits)
+    : is_(std::move(is)), limits_(limits), lazy_(std::make_unique<lazy_blocks>()) {
+  // Setting the mask on a stream that already failed, e.g. a file that doesn't exist, would throw.
+  if (*is_) is_->exceptions(std::ios_base::failbit | std::ios_base::badbit);
 }
 
+siginfo::siginfo(siginfo&&) noexcept = default;
+siginfo& siginfo::operator=(siginfo&&) noexcept = default;
+siginfo::~siginfo() = default;
+
 void siginfo::parse() {
-  const auto eocd_magic_pos = reverse_find_bytes(ifs_, eocd_magic.cbegin(), eocd_magic.cend());
-  if (eocd_magic_pos == -1) {
-    throw parse_error("Not a zip file, could not find EOCD Magic");
-  }
+  const auto status = try_parse();
+  if (!status) throw parse_error(status.message());
+}
 
-  const auto offset_of_start_of_cd_pos = eocd_magic_pos + static_cast<std::streamoff>(16);
-  ifs_.seekg(offset_of_start_of_cd_pos);
-  const auto offset_of_start_of_cd = read_le<uint32_t>(ifs_);
-  ifs_.seekg(offset_of_start_of_cd, std::ios_base::beg);
-
-  const auto start_of_cd_pos = ifs_.tellg();
-  const auto apk_sig_magic_pos = start_of_cd_pos - static_cast<std::streamoff>(16);
-  ifs_.seekg(apk_sig_magic_pos);
-  const auto magic = read_into_array<16>(ifs_);
-  if (!std::equal(magic.cbegin(), magic.cend(), apk_magic.cbegin(), apk_magic.cend())) {
-    throw parse_error("APK signing block magic not found where expected");
+parse_status siginfo::try_parse() noexcept {
+  try {
+    return locate_pairs();
+  } catch (const std::bad_alloc&) {
+    v2_block_pos_ = v3_block_pos_ = v3_1_block_pos_ = -1;
+    pairs_.clear();
+    return {parse_errc::out_of_memory, 0};
   }
+}
 
-  const auto apk_sig_size_of_block_pos = apk_sig_magic_pos - static_cast<std::streampos>(8);
-  ifs_.seekg(apk_sig_size_of_block_pos);
-  const auto apk_sig_size_of_block = read_le<uint64_t>(ifs_);
-
-  const auto apk_sig_id_val_pairs_pos = start_of_cd_pos - static_cast<std::streamoff>(apk_sig_size_of_block);
-
-  for (auto i = apk_sig_id_val_pairs_pos; i < apk_sig_size_of_block_pos;) {
-    ifs_.seekg(i);
-    const auto pair_len = read_le<uint64_t>(ifs_);
-    const auto id = read_le<uint32_t>(ifs_);
-    // REFACTOR Remove duplciation of reading bytes into v2/v3 vector
-    if (id == v2_id) {
-      v2_block_pos_ = ifs_.tellg();
-      const auto v2_block_len = read_le<uint32_t>(ifs_);
-      v2_block_ = parse_v2_block(v2_block_len, ifs_);
-    } else if (id == v3_id) {
-      v3_block_pos_ = ifs_.tellg();
-    } else if (id == v3_1_id) {
-      v3_1_block_pos_ = ifs_.tellg();
+parse_status siginfo::try_decode() noexcept {
+  const auto decode = [this](uint32_t id, auto get) -> parse_status {
+    const auto* pair = find_pair(id);
+    const auto offset = pair != nullptr ? pair->value_offset : 0;
+    try {
+      get();
+      return {};
+    } catch (const limit_error&) {
+      return {parse_errc::limit_exceeded, offset};
+    } catch (const parse_error&) {
+      return {parse_errc::bad_block, offset};
+    } catch (const std::ios_base::failure&) {
+      return {parse_errc::io_error, offset};
+    } catch (const std::bad_alloc&) {
+      return {parse_errc::out_of_memory, offset};
+    } catch (...) {
+      return {parse_errc::bad_block, offset};
     }
+  };
+  for (const auto& status : {decode(detail::v2_block_id, [this] { get_v2_block(); }),
+                             decode(detail::v3_block_id, [this] { get_v3_block(); }),
+                             decode(detail::v3_1_block_id, [this] { get_v3_1_block(); }),
+                             decode(detail::source_stamp_block_id, [this] { get_source_stamp(); })}) {
+    if (!status) return status;
+  }
+  return {};
+}
+
+parse_status siginfo::locate_pairs() {
+  using namespace detail;
+
+  lazy_ = std::make_unique<lazy_blocks>();
+  v2_block_pos_ = v3_block_pos_ = v3_1_block_pos_ = -1;
+  pairs_.clear();
+  auto& buf = *is_->rdbuf();
+
+  const auto end_pos = buf.pubseekoff(0, std::ios_base::end, std::ios_base::in);
+  if (end_pos == std::streampos(-1)) return {parse_errc::io_error, 0};
+  const auto file_size = static_cast<uint64_t>(std::streamoff(end_pos));
+  if (file_size < eocd_min_size) return {parse_errc::not_a_zip, 0};
+
+  const auto window_size = static_cast<size_t>(std::min<uint64_t>(file_size, eocd_max_distance));
+  const auto window_offset = file_size - window_size;
+  std::vector<uint8_t> window(window_size);
+  std::optional<size_t> found;
+  {
+    const scoped_trace trace(trace_phase::eocd_search, window_size);
+    if (!read_at(buf, window_offset, window.data(), window.size())) return {parse_errc::io_error, window_offset};
+    found = find_eocd(window.data(), window.size());
+  }
+  if (!found) return {parse_errc::not_a_zip, window_offset};
+  const auto eocd = *found;
+
+  sections_.file_size = file_size;
+  sections_.eocd_offset = window_offset + eocd;
+  const uint64_t cd_offset = le_to_host<uint32_t>(window.data() + eocd + eocd_cd_offset_offset);
+  sections_.cd_offset = cd_offset;
+  if (cd_offset > sections_.eocd_offset) {
+    return {parse_errc::central_directory_out_of_range, sections_.eocd_offset + eocd_cd_offset_offset};
+  }
+  if (cd_offset < signing_block_min_size) return {parse_errc::no_signing_block, cd_offset};
 
-    i += static_cast<std::streamoff>(pair_len + 8);
+  std::array<uint8_t, signing_block_footer_size> footer;
+  const auto footer_offset = cd_offset - footer.size();
+  {
+    const scoped_trace trace(trace_phase::footer_read, footer.size());
+    if (!read_at(buf, footer_offset, footer.data(), footer.size())) return {parse_errc::io_error, footer_offset};
   }
+  uint64_t block_offset = 0;
+  if (const auto status = check_signing_block_footer(footer.data(), cd_offset, block_offset); !status) return status;
+  if (cd_offset - block_offset > limits_.max_block_size) return {parse_errc::limit_exceeded, footer_offset};
+  sections_.signing_block_offset = block_offset;
+
+  const scoped_trace trace(trace_phase::pair_iteration, footer_offset - block_offset);
+  const auto read = [&](uint64_t pos, uint8_t* out, size_t n) { return read_at(buf, pos, out, n); };
+  const auto add_pair = [&](uint32_t id, uint64_t value_offset, uint64_t value_size) {
+    pairs_.push_back({id, value_offset, value_size});
+    const std::streampos value_pos = static_cast<std::streamoff>(value_offset);
+    if (id == v2_block_id) {
+      v2_block_pos_ = value_pos;
+    } else if (id == v3_block_id) {
+      v3_block_pos_ = value_pos;
+    } else if (id == v3_1_block_id) {
+      v3_1_block_pos_ = value_pos;
+    }
+  };
+  return walk_pairs(block_offset, footer.data(), footer_offset, read, add_pair);
+}
+
+const v2_block& siginfo::get_v2_block() const {
+  std::call_once(lazy_->v2_once, [this] {
+    const std::lock_guard lock(lazy_->stream_mutex);
+    const auto* pair = find_pair(detail::v2_block_id);
+    const detail::scoped_trace trace(trace_phase::v2_decode, pair != nullptr ? pair->value_size : 0);
+    lazy_->v2 = decode_block<v2_block>(*is_, pair, {limits_, lazy_->allocated}, parse_v2_block);
+  });
+  return lazy_->v2;
+}
+
+const v3_block& siginfo::get_v3_block() const {
+  std::call_once(lazy_->v3_once, [this] {
+    const std::lock_guard lock(lazy_->stream_mutex);
+    lazy_->v3 =
+        decode_block<v3_block>(*is_, find_pair(detail::v3_block_id), {limits_, lazy_->allocated}, parse_v3_block);
+  });
+  return lazy_->v3;
+}
+
+const v3_block& siginfo::get_v3_1_block() const {
+  std::call_once(lazy_->v3_1_once, [this] {
+    const std::lock_guard lock(lazy_->stream_mutex);
+    lazy_->v3_1 =
+        decode_block<v3_block>(*is_, find_pair(detail::v3_1_block_id), {limits_, lazy_->allocated}, parse_v3_block);
+  });
+  return lazy_->v3_1;
+}
+
+const source_stamp& siginfo::get_source_stamp() const {
+  std::call_once(lazy_->stamp_once, [this] {
+    const std::lock_guard lock(lazy_->stream_mutex);
+    lazy_->stamp = decode_block<source_stamp>(*is_, find_pair(detail::source_stamp_block_id),
+                                              {limits_, lazy_->allocated}, parse_source_stamp);
+  });
+  return lazy_->stamp;
+}
+
+const id_value_pair* siginfo::find_pair(uint32_t id) const noexcept {
+  const auto it = std::find_if(pairs_.cbegin(), pairs_.cend(), [id](const auto& p) { return p.id == id; });
+  return it == pairs_.cend() ? nullptr : &*it;
+}
+
+bool siginfo::has_source_stamp() const noexcept { return find_pair(detail::source_stamp_block_id) != nullptr; }
+
+std::vector<uint8_t> siginfo::read_pair_value(const id_value_pair& pair) {
+  const std::lock_guard lock(lazy_->stream_mutex);
+  is_->seekg(static_cast<std::streamoff>(pair.value_offset));
+  return read_into_vector(*is_, static_cast<size_t>(pair.value_size));
+}
+
+central_directory siginfo::read_central_directory() {
+  const std::lock_guard lock(lazy_->stream_mutex);
+  return central_directory::read(*is_, sections_.cd_offset, sections_.eocd_offset - sections_.cd_offset, limits_);
+}
+
+manifest_info siginfo::read_manifest() {
+  const auto dir = read_central_directory();
+  const std::lock_guard lock(lazy_->stream_mutex);
+  return ::apksig::read_manifest(*is_, dir, limits_);
 }
 
 }  // namespace apksig
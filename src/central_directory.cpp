@@ -0,0 +1,185 @@
+#include "apksig/central_directory.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <optional>
+#include <string>
+
+#include "apksig/apksig.hpp"
+#include "inflate.hpp"
+#include "read_utils.hpp"
+#include "trace.hpp"
+#include "zip_format.hpp"
+
+namespace {
+
+using apksig::detail::le_to_host;
+
+uint64_t hash_name(std::string_view name) noexcept {
+  // FNV-1a
+  uint64_t h = 0xcbf29ce484222325;
+  for (const auto c : name) {
+    h ^= static_cast<uint8_t>(c);
+    h *= 0x100000001b3;
+  }
+  return h;
+}
+
+// Replaces the 32-bit fields set to zip64_marker with their values from a ZIP64 extra field.
+void apply_zip64_extra(const uint8_t* extra, size_t extra_len, apksig::cd_entry& entry) {
+  using namespace apksig::detail;
+  for (size_t pos = 0; pos + 4 <= extra_len;) {
+    const auto id = le_to_host<uint16_t>(extra + pos);
+    const auto len = le_to_host<uint16_t>(extra + pos + 2);
+    const auto* data = extra + pos + 4;
+    const auto data_end = pos + 4 + len;
+    if (data_end > extra_len) throw apksig::parse_error("Extra field runs past the entry");
+    if (id == zip64_extra_id) {
+      size_t at = 0;
+      for (auto* field : {&entry.uncompressed_size, &entry.compressed_size, &entry.local_header_offset}) {
+        if (*field != zip64_marker) continue;
+        if (at + 8 > len) throw apksig::parse_error("Truncated ZIP64 extra field");
+        *field = le_to_host<uint64_t>(data + at);
+        at += 8;
+      }
+      return;
+    }
+    pos = data_end;
+  }
+}
+
+}  // namespace
+
+namespace apksig {
+
+central_directory central_directory::read(std::istream& is, uint64_t cd_offset, uint64_t cd_size,
+                                          const parse_limits& limits) {
+  using namespace detail;
+
+  if (cd_size > limits.max_central_directory_size) {
+    throw parse_error("Central directory larger than parse_limits::max_central_directory_size");
+  }
+  is.seekg(static_cast<std::streamoff>(cd_offset));
+  const auto cd = read_into_vector(is, static_cast<size_t>(cd_size));
+
+  central_directory dir;
+  dir.offset_ = cd_offset;
+  // Names take up less than the directory itself, so the arena never reallocates and the views
+  // into it stay valid.
+  dir.arena_.reserve(cd.size());
+  for (size_t pos = 0; pos + cd_entry_size <= cd.size();) {
+    const auto* e = cd.data() + pos;
+    if (le_to_host<uint32_t>(e) != cd_entry_magic) throw parse_error("Bad central directory entry magic");
+    const auto name_len = le_to_host<uint16_t>(e + cd_entry_name_len_offset);
+    const auto extra_len = le_to_host<uint16_t>(e + cd_entry_extra_len_offset);
+    const size_t entry_len = cd_entry_size + name_len + extra_len + le_to_host<uint16_t>(e + cd_entry_comment_len_offset);
+    if (pos + entry_len > cd.size()) throw parse_error("Central directory entry runs past the directory");
+
+    cd_entry entry;
+    const auto* name = reinterpret_cast<const char*>(e + cd_entry_size);
+    const auto* name_in_arena = dir.arena_.data() + dir.arena_.size();
+    dir.arena_.insert(dir.arena_.end(), name, name + name_len);
+    entry.name = std::string_view(name_in_arena, name_len);
+    entry.method = le_to_host<uint16_t>(e + cd_entry_method_offset);
+    entry.crc32 = le_to_host<uint32_t>(e + cd_entry_crc_offset);
+    entry.compressed_size = le_to_host<uint32_t>(e + cd_entry_compressed_size_offset);
+    entry.uncompressed_size = le_to_host<uint32_t>(e + cd_entry_size_offset);
+    entry.local_header_offset = le_to_host<uint32_t>(e + cd_entry_local_header_offset);
+    apply_zip64_extra(e + cd_entry_size + name_len, extra_len, entry);
+    dir.entries_.push_back(entry);
+
+    pos += entry_len;
+  }
+  dir.build_table();
+  return dir;
+}
+
+central_directory central_directory::read(const std::filesystem::path& zip_fpath, const parse_limits& limits) {
+  using namespace detail;
+
+  std::ifstream ifs(zip_fpath, std::ios_base::in | std::ios_base::binary);
+  ifs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+  const auto file_size = std::filesystem::file_size(zip_fpath);
+  const auto window_size = static_cast<size_t>(std::min<uint64_t>(file_size, eocd_max_distance));
+  const auto window_offset = file_size - window_size;
+  std::vector<uint8_t> window;
+  std::optional<size_t> found;
+  {
+    const scoped_trace trace(trace_phase::eocd_search, window_size);
+    ifs.seekg(static_cast<std::streamoff>(window_offset));
+    window = read_into_vector(ifs, window_size);
+    found = find_eocd(window.data(), window.size());
+  }
+  if (!found) throw parse_error("Not a zip file, could not find EOCD Magic");
+  const auto* eocd = window.data() + *found;
+  const auto cd_size = le_to_host<uint32_t>(eocd + eocd_cd_size_offset);
+  const auto cd_offset = le_to_host<uint32_t>(eocd + eocd_cd_offset_offset);
+  if (uint64_t(cd_offset) + cd_size > window_offset + *found) {
+    throw parse_error("Central directory runs past the EOCD record");
+  }
+  return read(ifs, cd_offset, cd_size, limits);
+}
+
+void central_directory::build_table() {
+  size_t capacity = 16;
+  while (capacity < entries_.size() * 2) capacity *= 2;
+  slots_.assign(capacity, 0);
+
+  const auto mask = capacity - 1;
+  for (size_t i = 0; i < entries_.size(); i++) {
+    auto slot = static_cast<size_t>(hash_name(entries_[i].name)) & mask;
+    // Duplicate names keep the first entry, like the platform's ZIP reader.
+    while (slots_[slot] != 0 && entries_[slots_[slot] - 1].name != entries_[i].name) slot = (slot + 1) & mask;
+    if (slots_[slot] == 0) slots_[slot] = static_cast<uint32_t>(i + 1);
+  }
+}
+
+const cd_entry* central_directory::find(std::string_view name) const noexcept {
+  if (slots_.empty()) return nullptr;
+  const auto mask = slots_.size() - 1;
+  for (auto slot = static_cast<size_t>(hash_name(name)) & mask; slots_[slot] != 0; slot = (slot + 1) & mask) {
+    const auto& entry = entries_[slots_[slot] - 1];
+    if (entry.name == name) return &entry;
+  }
+  return nullptr;
+}
+
+uint64_t entry_data_offset(std::istream& is, const cd_entry& entry) {
+  using namespace detail;
+
+  is.seekg(static_cast<std::streamoff>(entry.local_header_offset));
+  const auto local = read_into_array<local_header_size>(is);
+  if (le_to_host<uint32_t>(local.data()) != local_header_magic) throw parse_error("Bad local header magic");
+  return entry.local_header_offset + local_header_size +
+         le_to_host<uint16_t>(local.data() + local_header_name_len_offset) +
+         le_to_host<uint16_t>(local.data() + local_header_extra_len_offset);
+}
+
+std::vector<uint8_t> read_entry(std::istream& is, const cd_entry& entry, uint64_t data_end, uint64_t max_size) {
+  using namespace detail;
+
+  if (entry.method != method_stored && entry.method != method_deflated) {
+    throw parse_error("Unsupported compression method " + std::to_string(entry.method));
+  }
+  if (entry.compressed_size > max_size || entry.uncompressed_size > max_size) {
+    throw parse_error("Entry " + std::string(entry.name) + " is larger than the limit");
+  }
+  if (entry.local_header_offset > data_end || entry.compressed_size > data_end - entry.local_header_offset) {
+    throw parse_error("Entry " + std::string(entry.name) + " runs past the entry data");
+  }
+  const auto data_offset = entry_data_offset(is, entry);
+  if (data_offset > data_end || entry.compressed_size > data_end - data_offset) {
+    throw parse_error("Entry " + std::string(entry.name) + " runs past the entry data");
+  }
+  is.seekg(static_cast<std::streamoff>(data_offset));
+  auto data = read_into_vector(is, static_cast<size_t>(entry.compressed_size));
+  if (entry.method == method_deflated) {
+    data = inflate(data.data(), data.size(), static_cast<size_t>(entry.uncompressed_size));
+  }
+  if (data.size() != entry.uncompressed_size || crc32(data.data(), data.size()) != entry.crc32) {
+    throw parse_error("Corrupt entry " + std::string(entry.name));
+  }
+  return data;
+}
+
+}  // namespace apksig
@@ -0,0 +1,112 @@
+#include "apksig/cert_cache.hpp"
+
+#include <mbedtls/sha1.h>
+#include <mbedtls/sha256.h>
+#include <mbedtls/x509_crt.h>
+
+#include <string>
+
+#include "trace.hpp"
+
+namespace {
+
+std::string_view bytes_view(const apksig::certificate& der) {
+  return {reinterpret_cast<const char*>(der.data()), der.size()};
+}
+
+}  // namespace
+
+namespace apksig {
+
+struct interned_certificate::impl {
+  certificate der;
+  std::array<uint8_t, 32> sha256{};
+  std::array<uint8_t, 20> sha1{};
+  // Filled by parse().
+  std::once_flag parsed;
+  int parse_ret = 0;
+  ::apksig::public_key public_key;
+  mbedtls_x509_crt crt;
+
+  void parse() {
+    std::call_once(parsed, [this] {
+      parse_ret = mbedtls_x509_crt_parse_der(&crt, der.data(), der.size());
+      if (parse_ret == 0) public_key.assign(crt.pk_raw.p, crt.pk_raw.p + crt.pk_raw.len);
+    });
+  }
+
+  void check_parsed() {
+    parse();
+    if (parse_ret != 0) throw parse_error("Invalid certificate: mbedtls error " + std::to_string(parse_ret));
+  }
+
+  impl() { mbedtls_x509_crt_init(&crt); }
+  impl(const impl&) = delete;
+  impl& operator=(const impl&) = delete;
+  ~impl() { mbedtls_x509_crt_free(&crt); }
+};
+
+interned_certificate::interned_certificate(const certificate& der) : impl_(std::make_unique<impl>()) {
+  const detail::scoped_trace trace(trace_phase::cert_hashing, der.size());
+  impl_->der = der;
+  mbedtls_sha256(impl_->der.data(), impl_->der.size(), impl_->sha256.data(), 0);
+  mbedtls_sha1(impl_->der.data(), impl_->der.size(), impl_->sha1.data());
+}
+
+interned_certificate::~interned_certificate() = default;
+
+const certificate& interned_certificate::der() const noexcept { return impl_->der; }
+
+const std::array<uint8_t, 32>& interned_certificate::sha256() const noexcept { return impl_->sha256; }
+
+const std::array<uint8_t, 20>& interned_certificate::sha1() const noexcept { return impl_->sha1; }
+
+bool interned_certificate::has_x509() const {
+  impl_->parse();
+  return impl_->parse_ret == 0;
+}
+
+const ::apksig::public_key& interned_certificate::public_key() const {
+  impl_->check_parsed();
+  return impl_->public_key;
+}
+
+const mbedtls_x509_crt& interned_certificate::x509() const {
+  impl_->check_parsed();
+  return impl_->crt;
+}
+
+certificate_cache& certificate_cache::global() {
+  static certificate_cache cache;
+  return cache;
+}
+
+std::shared_ptr<const interned_certificate> certificate_cache::intern(const certificate& der) {
+  {
+    std::lock_guard lock(mutex_);
+    const auto it = entries_.find(bytes_view(der));
+    if (it != entries_.end()) return it->second;
+  }
+
+  // Hashed outside the lock, so threads interning different certificates don't wait on each other.
+  // Threads racing on the same new certificate each hash it and the first insert wins.
+  auto cert = std::make_shared<const interned_certificate>(der);
+  std::lock_guard lock(mutex_);
+  return entries_.emplace(bytes_view(cert->der()), cert).first->second;
+}
+
+size_t certificate_cache::size() const {
+  std::lock_guard lock(mutex_);
+  return entries_.size();
+}
+
+void certificate_cache::clear() {
+  std::lock_guard lock(mutex_);
+  entries_.clear();
+}
+
+std::shared_ptr<const interned_certificate> intern_certificate(const certificate& der) {
+  return certificate_cache::global().intern(der);
+}
+
+}  // namespace apksig
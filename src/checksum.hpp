@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "read_utils.hpp"
+
+namespace apksig::detail {
+
+// XXH64: a fast non-cryptographic checksum, used to tell whether a chunk changed since its
+// digests were recorded. It offers no protection against deliberate collisions.
+inline uint64_t checksum64(const uint8_t* p, size_t n, uint64_t seed = 0) noexcept {
+  constexpr uint64_t p1 = 0x9E3779B185EBCA87ULL;
+  constexpr uint64_t p2 = 0xC2B2AE3D27D4EB4FULL;
+  constexpr uint64_t p3 = 0x165667B19E3779F9ULL;
+  constexpr uint64_t p4 = 0x85EBCA77C2B2AE63ULL;
+  constexpr uint64_t p5 = 0x27D4EB2F165667C5ULL;
+
+  const auto rotl = [](uint64_t x, int r) { return (x << r) | (x >> (64 - r)); };
+  const auto load64 = [](const uint8_t* q) { return le_to_host<uint64_t>(q); };
+  const auto load32 = [](const uint8_t* q) { return uint64_t(le_to_host<uint32_t>(q)); };
+  const auto round = [&](uint64_t acc, uint64_t input) { return rotl(acc + input * p2, 31) * p1; };
+  const auto merge = [&](uint64_t acc, uint64_t v) { return (acc ^ round(0, v)) * p1 + p4; };
+
+  const uint8_t* const end = p + n;
+  uint64_t h;
+  if (n >= 32) {
+    uint64_t v1 = seed + p1 + p2, v2 = seed + p2, v3 = seed, v4 = seed - p1;
+    for (; p + 32 <= end; p += 32) {
+      v1 = round(v1, load64(p));
+      v2 = round(v2, load64(p + 8));
+      v3 = round(v3, load64(p + 16));
+      v4 = round(v4, load64(p + 24));
+    }
+    h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+    h = merge(merge(merge(merge(h, v1), v2), v3), v4);
+  } else {
+    h = seed + p5;
+  }
+  h += n;
+
+  for (; p + 8 <= end; p += 8) h = rotl(h ^ round(0, load64(p)), 27) * p1 + p4;
+  if (p + 4 <= end) {
+    h = rotl(h ^ (load32(p) * p1), 23) * p2 + p3;
+    p += 4;
+  }
+  for (; p < end; p++) h = rotl(h ^ (*p * p5), 11) * p1;
+
+  h ^= h >> 33;
+  h *= p2;
+  h ^= h >> 29;
+  h *= p3;
+  h ^= h >> 32;
+  return h;
+}
+
+}  // namespace apksig::detail
@@ -0,0 +1,83 @@
+#include "apksig/chunk_cache.hpp"
+
+#include <fstream>
+#include <string_view>
+
+#include "read_utils.hpp"
+#include "write_utils.hpp"
+
+namespace {
+
+using apksig::detail::append_le;
+using apksig::detail::read_le;
+
+constexpr std::string_view cache_magic{"APKSIGCC"};
+constexpr uint32_t cache_version = 1;
+
+}  // namespace
+
+namespace apksig {
+
+void save_chunk_cache(const std::filesystem::path& cache_fpath, const chunk_digest_cache& cache) {
+  std::vector<uint8_t> out(cache_magic.cbegin(), cache_magic.cend());
+  append_le(out, cache_version);
+  append_le(out, cache.sections.signing_block_offset);
+  append_le(out, cache.sections.cd_offset);
+  append_le(out, cache.sections.eocd_offset);
+  append_le(out, cache.sections.file_size);
+  append_le(out, static_cast<uint32_t>(cache.algos.size()));
+  for (const auto algo : cache.algos) append_le(out, static_cast<uint32_t>(algo));
+  append_le(out, static_cast<uint64_t>(cache.chunks.size()));
+  for (const auto& chunk : cache.chunks) {
+    append_le(out, chunk.offset);
+    append_le(out, chunk.size);
+    append_le(out, chunk.checksum);
+  }
+  for (const auto& digests : cache.chunk_digests) detail::append_bytes(out, digests);
+
+  std::ofstream ofs(cache_fpath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+  ofs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+  detail::write_bytes(ofs, out);
+}
+
+chunk_digest_cache load_chunk_cache(const std::filesystem::path& cache_fpath) {
+  std::ifstream ifs(cache_fpath, std::ios_base::in | std::ios_base::binary);
+  ifs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+
+  const auto magic = detail::read_into_array<8>(ifs);
+  if (!std::equal(magic.cbegin(), magic.cend(), cache_magic.cbegin(), cache_magic.cend()) ||
+      read_le<uint32_t>(ifs) != cache_version) {
+    throw parse_error("Not a chunk digest cache of a supported version");
+  }
+
+  chunk_digest_cache cache;
+  cache.sections.signing_block_offset = read_le<uint64_t>(ifs);
+  cache.sections.cd_offset = read_le<uint64_t>(ifs);
+  cache.sections.eocd_offset = read_le<uint64_t>(ifs);
+  cache.sections.file_size = read_le<uint64_t>(ifs);
+
+  const auto algo_count = read_le<uint32_t>(ifs);
+  for (uint32_t i = 0; i < algo_count; i++) {
+    const auto algo = static_cast<content_digest_algo>(read_le<uint32_t>(ifs));
+    if (algo != content_digest_algo::chunked_sha256 && algo != content_digest_algo::chunked_sha512) {
+      throw parse_error("Unexpected algorithm in chunk digest cache");
+    }
+    cache.algos.push_back(algo);
+  }
+
+  const auto chunk_count = read_le<uint64_t>(ifs);
+  const auto remaining = std::filesystem::file_size(cache_fpath) - static_cast<uint64_t>(ifs.tellg());
+  if (chunk_count > remaining / (8 + 4 + 8)) throw parse_error("Truncated chunk digest cache");
+  cache.chunks.resize(static_cast<size_t>(chunk_count));
+  for (auto& chunk : cache.chunks) {
+    chunk.offset = read_le<uint64_t>(ifs);
+    chunk.size = read_le<uint32_t>(ifs);
+    chunk.checksum = read_le<uint64_t>(ifs);
+  }
+  for (const auto algo : cache.algos) {
+    cache.chunk_digests.push_back(detail::read_into_vector(ifs, cache.chunks.size() * digest_size(algo)));
+  }
+  return cache;
+}
+
+}  // namespace apksig
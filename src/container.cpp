@@ -0,0 +1,69 @@
+#include "apksig/container.hpp"
+
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <string_view>
+
+#include "apksig/central_directory.hpp"
+#include "apksig/io.hpp"
+#include "parallel.hpp"
+#include "zip_format.hpp"
+
+namespace {
+
+bool ends_with(std::string_view s, std::string_view suffix) {
+  return s.size() >= suffix.size() && s.substr(s.size() - suffix.size()) == suffix;
+}
+
+bool is_nested_apk_name(std::string_view name) { return ends_with(name, ".apk") || ends_with(name, ".apex"); }
+
+}  // namespace
+
+namespace apksig {
+
+std::vector<nested_apk> find_nested_apks(const std::filesystem::path& container_fpath) {
+  const auto dir = central_directory::read(container_fpath);
+  const auto file_size = std::filesystem::file_size(container_fpath);
+  std::ifstream ifs(container_fpath, std::ios_base::in | std::ios_base::binary);
+  ifs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+
+  std::vector<nested_apk> out;
+  for (const auto& e : dir.entries()) {
+    if (!is_nested_apk_name(e.name)) continue;
+    nested_apk apk;
+    apk.name = std::string(e.name);
+    apk.offset = entry_data_offset(ifs, e);
+    apk.size = e.compressed_size;
+    apk.stored = e.method == detail::method_stored;
+    if (apk.offset + apk.size > file_size) throw parse_error("Entry data past end of file");
+    out.push_back(std::move(apk));
+  }
+  return out;
+}
+
+std::vector<nested_apk_result> scan_container(const std::filesystem::path& container_fpath, unsigned threads) {
+  const auto entries = find_nested_apks(container_fpath);
+  std::vector<nested_apk_result> results(entries.size());
+
+  detail::parallel_for(entries.size(), threads, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      auto& r = results[i];
+      r.entry = entries[i];
+      if (!r.entry.stored) {
+        r.error = "Entry is compressed";
+        continue;
+      }
+      try {
+        siginfo info(std::make_unique<file_range_istream>(container_fpath, r.entry.offset, r.entry.size));
+        info.parse();
+        r.info = std::move(info);
+      } catch (const std::exception& e) {
+        r.error = e.what();
+      }
+    }
+  });
+  return results;
+}
+
+}  // namespace apksig
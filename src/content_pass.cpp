@@ -0,0 +1,358 @@
+#include "content_pass.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <future>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "apksig/verity.hpp"
+#include "checksum.hpp"
+#include "parallel.hpp"
+#include "sha.hpp"
+#include "trace.hpp"
+#include "verity_tree.hpp"
+#include "write_utils.hpp"
+#include "zip_format.hpp"
+
+namespace {
+
+using apksig::content_digest_algo;
+
+constexpr auto chunk_size = apksig::chunked_digester::chunk_size;
+constexpr auto no_chunk = static_cast<size_t>(-1);
+
+enum class piece_kind { content, skipped, eocd };
+
+// One read of the sequential pass. Content pieces are chunks of the digested sections; skipped
+// pieces (the signing block) are only read for the whole-file hash.
+struct piece {
+  piece_kind kind;
+  uint64_t offset;
+  size_t size;
+  size_t chunk_index;
+  // Position within the data the verity tree covers.
+  uint64_t verity_pos;
+  // Index of the same chunk in the previous cache, if its digests may be reused.
+  size_t previous_index = no_chunk;
+  // Unchanged according to the caller's dirty ranges, so not read at all.
+  bool clean = false;
+};
+
+std::vector<piece> plan_pieces(const apksig::apk_sections& sections, bool whole_file) {
+  std::vector<piece> pieces;
+  size_t chunk_index = 0;
+  const auto add_range = [&](piece_kind kind, uint64_t first, uint64_t last, uint64_t verity_first) {
+    for (auto off = first; off < last; off += chunk_size) {
+      const auto size = static_cast<size_t>(std::min<uint64_t>(chunk_size, last - off));
+      pieces.push_back({kind, off, size, kind == piece_kind::skipped ? 0 : chunk_index++, verity_first + (off - first)});
+    }
+  };
+
+  add_range(piece_kind::content, 0, sections.signing_block_offset, 0);
+  if (whole_file) {
+    add_range(piece_kind::skipped, sections.signing_block_offset, sections.cd_offset, 0);
+  }
+  add_range(piece_kind::content, sections.cd_offset, sections.eocd_offset, sections.signing_block_offset);
+  pieces.push_back({piece_kind::eocd, sections.eocd_offset, static_cast<size_t>(sections.file_size - sections.eocd_offset),
+                    chunk_index, sections.signing_block_offset + (sections.eocd_offset - sections.cd_offset)});
+  return pieces;
+}
+
+bool overlaps(const std::vector<apksig::byte_range>& ranges, uint64_t offset, uint64_t size) {
+  return std::any_of(ranges.cbegin(), ranges.cend(),
+                     [&](const auto& r) { return r.offset < offset + size && offset < r.offset + r.size; });
+}
+
+class content_pass {
+ public:
+  content_pass(const apksig::apk_sections& sections, const apksig::content_digest_options& opts)
+      : sections_(sections), opts_(opts), pieces_(plan_pieces(sections, opts.whole_file_sha256)) {
+    for (const auto& p : pieces_) {
+      if (p.kind != piece_kind::skipped) chunk_count_++;
+    }
+    for (const auto algo : opts_.algos) {
+      if (algo == content_digest_algo::verity_chunked_sha256) {
+        if (sections_.signing_block_offset % apksig::verity_block_size != 0) {
+          throw apksig::parse_error("APK Signing Block is not block aligned, VERITY digest does not apply");
+        }
+        if (!verity_) {
+          const auto data_size = sections_.signing_block_offset + (sections_.file_size - sections_.cd_offset);
+          verity_.emplace(data_size, apksig::verity_options{std::vector<uint8_t>(8, 0), opts_.threads});
+        }
+      } else if (std::find(chunked_algos_.cbegin(), chunked_algos_.cend(), algo) == chunked_algos_.cend()) {
+        chunked_algos_.push_back(algo);
+        chunk_digests_.emplace_back(chunk_count_ * apksig::digest_size(algo));
+      }
+    }
+    checksums_.resize(chunk_count_);
+    if (opts_.sample_ratio < 1.0) {
+      plan_sample();
+    } else {
+      match_previous();
+    }
+  }
+
+  apksig::content_digest_set run(const std::filesystem::path& apk_fpath) {
+    std::ifstream ifs(apk_fpath, std::ios_base::in | std::ios_base::binary);
+    ifs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+    std::ifstream reference;
+    if (opts_.previous != nullptr && opts_.detection.mode == apksig::change_detection::reference_copy) {
+      reference.open(opts_.detection.reference_copy, std::ios_base::in | std::ios_base::binary);
+      if (!reference) throw std::runtime_error("Failed to open the reference copy");
+    }
+
+    std::optional<apksig::detail::sha_context> whole_file;
+    if (opts_.whole_file_sha256) whole_file.emplace(apksig::detail::sha_kind::sha256);
+
+    // Two batches of buffers: one is hashed by the workers while the other is read.
+    const size_t batch_size = std::min<size_t>(64, 2 * apksig::detail::resolve_threads(opts_.threads));
+    std::array<std::vector<std::vector<uint8_t>>, 2> buffers;
+    std::array<std::vector<std::vector<uint8_t>>, 2> reference_buffers;
+    std::future<void> pending;
+
+    for (size_t first = 0, batch = 0; first < pieces_.size(); first += batch_size, batch ^= 1) {
+      const auto last = std::min(first + batch_size, pieces_.size());
+      auto& bufs = buffers[batch];
+      auto& ref_bufs = reference_buffers[batch];
+      bufs.resize(last - first);
+      ref_bufs.resize(last - first);
+      {
+        apksig::detail::scoped_trace read_trace(apksig::trace_phase::content_read);
+        for (size_t i = first; i < last; i++) {
+          const auto& p = pieces_[i];
+          auto& buf = bufs[i - first];
+          if (p.clean) continue;
+
+          buf.resize(p.size);
+          ifs.seekg(static_cast<std::streamoff>(p.offset));
+          ifs.read(reinterpret_cast<char*>(buf.data()), static_cast<std::streamsize>(buf.size()));
+          read_trace.add_bytes(buf.size());
+          if (whole_file) whole_file->update(buf.data(), buf.size());
+          if (p.kind == piece_kind::eocd) {
+            apksig::detail::patch_eocd_cd_offset(buf.data(), sections_.signing_block_offset);
+          }
+          if (reference.is_open() && p.previous_index != no_chunk) {
+            read_reference(reference, p, ref_bufs[i - first]);
+          }
+        }
+      }
+
+      if (pending.valid()) pending.get();
+      pending = std::async(std::launch::async, [this, &bufs, &ref_bufs, first, last] {
+        apksig::detail::parallel_for(last - first, opts_.threads, [&](size_t begin, size_t end) {
+          for (size_t i = begin; i < end; i++) process_piece(pieces_[first + i], bufs[i], ref_bufs[i]);
+        });
+      });
+    }
+    if (pending.valid()) pending.get();
+
+    if (whole_file) {
+      whole_file_.emplace(32);
+      whole_file->finish(whole_file_->data());
+    }
+    return finish();
+  }
+
+ private:
+  // Pairs chunks with the previous cache by offset and size. Chunks that moved, for instance
+  // after the central directory shifted, are simply rehashed.
+  void match_previous() {
+    const auto* previous = opts_.previous;
+    if (previous == nullptr || chunked_algos_.empty()) return;
+    for (const auto algo : chunked_algos_) {
+      if (std::find(previous->algos.cbegin(), previous->algos.cend(), algo) == previous->algos.cend()) return;
+    }
+
+    std::unordered_map<uint64_t, size_t> by_offset;
+    // The EOCD record depends on the signing block offset and is always rehashed.
+    for (size_t i = 0; i + 1 < previous->chunks.size(); i++) by_offset.emplace(previous->chunks[i].offset, i);
+
+    // Skipping reads is only possible when nothing else needs the bytes.
+    const bool can_skip_reads = opts_.detection.mode == apksig::change_detection::dirty_ranges && !verity_ &&
+                                !opts_.whole_file_sha256;
+    for (auto& p : pieces_) {
+      if (p.kind != piece_kind::content) continue;
+      const auto it = by_offset.find(p.offset);
+      if (it == by_offset.end() || previous->chunks[it->second].size != p.size) continue;
+      p.previous_index = it->second;
+      p.clean = can_skip_reads && !overlaps(opts_.detection.dirty_ranges, p.offset, p.size);
+    }
+  }
+
+  // Spot-check mode: ZIP entry chunks outside the sample keep their previous digests and are not
+  // read. Sampled chunks, the central directory and the EOCD record are always hashed afresh.
+  void plan_sample() {
+    const auto* previous = opts_.previous;
+    if (previous == nullptr || verity_ || opts_.whole_file_sha256) {
+      throw std::invalid_argument("Sampling needs a previous chunk digest cache and chunked algorithms only");
+    }
+    const auto& s = previous->sections;
+    if (s.signing_block_offset != sections_.signing_block_offset || s.cd_offset != sections_.cd_offset ||
+        s.eocd_offset != sections_.eocd_offset || s.file_size != sections_.file_size ||
+        previous->chunks.size() != chunk_count_) {
+      throw std::invalid_argument("Sampling needs a chunk digest cache of the same file layout");
+    }
+    for (const auto algo : chunked_algos_) {
+      if (std::find(previous->algos.cbegin(), previous->algos.cend(), algo) == previous->algos.cend()) {
+        throw std::invalid_argument("Chunk digest cache lacks a requested algorithm");
+      }
+    }
+
+    std::mt19937_64 rng(opts_.sample_seed);
+    std::bernoulli_distribution pick(std::max(0.0, opts_.sample_ratio));
+    for (auto& p : pieces_) {
+      if (p.kind == piece_kind::content && p.offset < sections_.signing_block_offset && !pick(rng)) {
+        p.previous_index = p.chunk_index;
+        p.clean = true;
+      }
+    }
+  }
+
+  void read_reference(std::ifstream& reference, const piece& p, std::vector<uint8_t>& out) {
+    out.resize(p.size);
+    reference.clear();
+    reference.seekg(static_cast<std::streamoff>(p.offset));
+    reference.read(reinterpret_cast<char*>(out.data()), static_cast<std::streamsize>(out.size()));
+    // A short read means the copy is smaller; such a chunk counts as changed.
+    if (static_cast<size_t>(reference.gcount()) != out.size()) out.clear();
+  }
+
+  bool unchanged(const piece& p, const std::vector<uint8_t>& buf, const std::vector<uint8_t>& ref_buf) {
+    if (p.previous_index == no_chunk) return false;
+    switch (opts_.detection.mode) {
+      case apksig::change_detection::checksum:
+        return checksums_[p.chunk_index] == opts_.previous->chunks[p.previous_index].checksum;
+      case apksig::change_detection::reference_copy:
+        return ref_buf == buf;
+      case apksig::change_detection::dirty_ranges:
+        return !overlaps(opts_.detection.dirty_ranges, p.offset, p.size);
+    }
+    return false;
+  }
+
+  void reuse_chunk(const piece& p) {
+    const auto* previous = opts_.previous;
+    for (size_t a = 0; a < chunked_algos_.size(); a++) {
+      const auto algo_index = static_cast<size_t>(
+          std::find(previous->algos.cbegin(), previous->algos.cend(), chunked_algos_[a]) - previous->algos.cbegin());
+      const auto dsize = apksig::digest_size(chunked_algos_[a]);
+      const auto* src = previous->chunk_digests[algo_index].data() + p.previous_index * dsize;
+      std::copy(src, src + dsize, chunk_digests_[a].data() + p.chunk_index * dsize);
+    }
+    reused_chunks_++;
+  }
+
+  void process_piece(const piece& p, const std::vector<uint8_t>& buf, const std::vector<uint8_t>& ref_buf) {
+    if (p.kind == piece_kind::skipped) return;
+    const apksig::detail::scoped_trace trace(apksig::trace_phase::content_digest, p.clean ? 0 : buf.size());
+    if (p.clean) {
+      checksums_[p.chunk_index] = opts_.previous->chunks[p.previous_index].checksum;
+      reuse_chunk(p);
+      return;
+    }
+
+    const bool need_checksum = opts_.record != nullptr ||
+                               (p.previous_index != no_chunk && opts_.detection.mode == apksig::change_detection::checksum);
+    if (need_checksum) checksums_[p.chunk_index] = apksig::detail::checksum64(buf.data(), buf.size());
+
+    if (unchanged(p, buf, ref_buf)) {
+      reuse_chunk(p);
+    } else {
+      for (size_t a = 0; a < chunked_algos_.size(); a++) {
+        const auto dsize = apksig::digest_size(chunked_algos_[a]);
+        apksig::chunked_digester::digest_chunk(chunked_algos_[a], buf.data(), buf.size(),
+                                               chunk_digests_[a].data() + p.chunk_index * dsize);
+      }
+      hashed_chunks_++;
+    }
+
+    if (verity_) hash_verity(p, buf);
+  }
+
+  void hash_verity(const piece& p, const std::vector<uint8_t>& buf) {
+    if (p.kind == piece_kind::eocd) {
+      eocd_ = buf;
+      return;
+    }
+    // Chunks start on block boundaries; only the end of the central directory can leave a partial
+    // block, which continues into the EOCD record.
+    const auto whole_blocks = buf.size() / apksig::verity_block_size;
+    verity_->hash_leaf_blocks(static_cast<size_t>(p.verity_pos / apksig::verity_block_size), buf.data(), whole_blocks);
+    if (buf.size() % apksig::verity_block_size != 0) {
+      verity_tail_.assign(buf.cbegin() + static_cast<std::ptrdiff_t>(whole_blocks * apksig::verity_block_size), buf.cend());
+    }
+  }
+
+  void finish_verity_tail() {
+    auto blocks = verity_tail_;
+    blocks.insert(blocks.end(), eocd_.cbegin(), eocd_.cend());
+    const auto first_pos = sections_.signing_block_offset + (sections_.eocd_offset - sections_.cd_offset) - verity_tail_.size();
+    const auto count = (blocks.size() + apksig::verity_block_size - 1) / apksig::verity_block_size;
+    blocks.resize(count * apksig::verity_block_size, 0);
+    verity_->hash_leaf_blocks(static_cast<size_t>(first_pos / apksig::verity_block_size), blocks.data(), count);
+  }
+
+  apksig::content_digest_set finish() {
+    apksig::content_digest_set out;
+    for (size_t a = 0; a < chunked_algos_.size(); a++) {
+      apksig::chunked_digester digester(chunked_algos_[a]);
+      digester.add_chunk_digests(chunk_digests_[a].data(), static_cast<uint32_t>(chunk_count_));
+      out.digests.push_back({chunked_algos_[a], digester.finish()});
+    }
+    if (verity_) {
+      finish_verity_tail();
+      const auto tree = verity_->finish();
+      std::vector<uint8_t> digest(tree.root_hash.cbegin(), tree.root_hash.cend());
+      apksig::detail::append_le(digest, tree.data_size);
+      out.digests.push_back({content_digest_algo::verity_chunked_sha256, std::move(digest)});
+    }
+    if (whole_file_) {
+      out.whole_file_sha256 = *whole_file_;
+    }
+    out.hashed_chunks = hashed_chunks_;
+    out.reused_chunks = reused_chunks_;
+
+    if (auto* record = opts_.record) {
+      record->sections = sections_;
+      record->algos = chunked_algos_;
+      record->chunks.clear();
+      for (const auto& p : pieces_) {
+        if (p.kind != piece_kind::skipped) {
+          record->chunks.push_back({p.offset, static_cast<uint32_t>(p.size), checksums_[p.chunk_index]});
+        }
+      }
+      record->chunk_digests = chunk_digests_;
+    }
+    return out;
+  }
+
+  const apksig::apk_sections& sections_;
+  const apksig::content_digest_options& opts_;
+  std::vector<piece> pieces_;
+  size_t chunk_count_ = 0;
+  std::vector<content_digest_algo> chunked_algos_;
+  std::vector<std::vector<uint8_t>> chunk_digests_;
+  std::vector<uint64_t> checksums_;
+  std::optional<apksig::detail::merkle_tree_builder> verity_;
+  std::vector<uint8_t> verity_tail_;
+  std::vector<uint8_t> eocd_;
+  std::optional<std::vector<uint8_t>> whole_file_;
+  std::atomic<size_t> hashed_chunks_ = 0;
+  std::atomic<size_t> reused_chunks_ = 0;
+};
+
+}  // namespace
+
+namespace apksig::detail {
+
+content_digest_set run_content_pass(const std::filesystem::path& apk_fpath, const apk_sections& sections,
+                                    const content_digest_options& opts) {
+  return content_pass(sections, opts).run(apk_fpath);
+}
+
+}  // namespace apksig::detail
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <filesystem>
+
+#include "apksig/verify.hpp"
+
+namespace apksig::detail {
+
+// Engine behind compute_content_digests: one sequential read of the file, chunks fanned out to
+// every requested hasher on worker threads, optionally reusing and recording chunk digests.
+content_digest_set run_content_pass(const std::filesystem::path& apk_file_path, const apk_sections& sections,
+                                    const content_digest_options& opts);
+
+}  // namespace apksig::detail
@@ -0,0 +1,114 @@
+#include "apksig/digest.hpp"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+#include "sha.hpp"
+
+namespace {
+
+apksig::detail::sha_kind sha_kind_of(apksig::content_digest_algo algo) {
+  switch (algo) {
+    case apksig::content_digest_algo::chunked_sha256:
+      return apksig::detail::sha_kind::sha256;
+    case apksig::content_digest_algo::chunked_sha512:
+      return apksig::detail::sha_kind::sha512;
+    default:
+      throw std::invalid_argument("Not a chunked content digest algorithm");
+  }
+}
+
+std::array<uint8_t, 5> length_prefix(uint8_t marker, uint32_t len) {
+  return {marker, static_cast<uint8_t>(len), static_cast<uint8_t>(len >> 8), static_cast<uint8_t>(len >> 16),
+          static_cast<uint8_t>(len >> 24)};
+}
+
+}  // namespace
+
+namespace apksig {
+
+std::optional<content_digest_algo> content_digest_algo_of(uint32_t sig_algo_id) noexcept {
+  switch (sig_algo_id) {
+    case 0x0101:  // RSASSA-PSS with SHA2-256
+    case 0x0103:  // RSASSA-PKCS1-v1_5 with SHA2-256
+    case 0x0201:  // ECDSA with SHA2-256
+    case 0x0301:  // DSA with SHA2-256
+      return content_digest_algo::chunked_sha256;
+    case 0x0102:  // RSASSA-PSS with SHA2-512
+    case 0x0104:  // RSASSA-PKCS1-v1_5 with SHA2-512
+    case 0x0202:  // ECDSA with SHA2-512
+      return content_digest_algo::chunked_sha512;
+    case 0x0421:  // RSASSA-PKCS1-v1_5 with SHA2-256, verity
+    case 0x0423:  // ECDSA with SHA2-256, verity
+    case 0x0425:  // DSA with SHA2-256, verity
+      return content_digest_algo::verity_chunked_sha256;
+    default:
+      return std::nullopt;
+  }
+}
+
+size_t digest_size(content_digest_algo algo) noexcept {
+  switch (algo) {
+    case content_digest_algo::chunked_sha512:
+      return 64;
+    case content_digest_algo::verity_chunked_sha256:
+      return 32 + 8;  // root hash followed by the 64-bit size of the digested data
+    default:
+      return 32;
+  }
+}
+
+int content_digest_preference(content_digest_algo algo) noexcept {
+  switch (algo) {
+    case content_digest_algo::chunked_sha512:
+      return 0;
+    case content_digest_algo::chunked_sha256:
+      return 1;
+    default:
+      return 2;
+  }
+}
+
+chunked_digester::chunked_digester(content_digest_algo algo) : algo_(algo) { sha_kind_of(algo_); }
+
+void chunked_digester::digest_chunk(content_digest_algo algo, const uint8_t* data, size_t size, uint8_t* out) {
+  if (size > chunk_size) throw std::invalid_argument("Chunk larger than chunk_size");
+
+  detail::sha_context ctx(sha_kind_of(algo));
+  const auto prefix = length_prefix(0xa5, static_cast<uint32_t>(size));
+  ctx.update(prefix.data(), prefix.size());
+  ctx.update(data, size);
+  ctx.finish(out);
+}
+
+void chunked_digester::add_chunk(const uint8_t* data, size_t size) {
+  const auto offset = chunk_digests_.size();
+  chunk_digests_.resize(offset + digest_size(algo_));
+  digest_chunk(algo_, data, size, chunk_digests_.data() + offset);
+  chunk_count_++;
+}
+
+void chunked_digester::add_chunk_digests(const uint8_t* digests, uint32_t count) {
+  chunk_digests_.insert(chunk_digests_.end(), digests, digests + size_t(count) * digest_size(algo_));
+  chunk_count_ += count;
+}
+
+void chunked_digester::add_section(const uint8_t* data, size_t size) {
+  for (size_t offset = 0; offset < size; offset += chunk_size) {
+    add_chunk(data + offset, std::min(chunk_size, size - offset));
+  }
+}
+
+std::vector<uint8_t> chunked_digester::finish() const {
+  detail::sha_context ctx(sha_kind_of(algo_));
+  const auto prefix = length_prefix(0x5a, chunk_count_);
+  ctx.update(prefix.data(), prefix.size());
+  ctx.update(chunk_digests_.data(), chunk_digests_.size());
+
+  std::vector<uint8_t> out(detail::sha_size(ctx.kind()));
+  ctx.finish(out.data());
+  return out;
+}
+
+}  // namespace apksig
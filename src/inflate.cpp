@@ -0,0 +1,291 @@
+#include "inflate.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <utility>
+
+#include "apksig/apksig.hpp"
+
+// A canonical-Huffman inflater in the spirit of zlib's puff, but table driven: codes of up to
+// fast_bits bits, which are nearly all of them, are decoded with one lookup on a 64-bit bit buffer
+// and only longer ones fall back to walking the code a bit at a time. verify_v1 runs every entry
+// of an APK through it, dex files of several MiB included.
+
+namespace {
+
+constexpr int max_bits = 15;
+constexpr int max_lit_codes = 286;
+constexpr int max_dist_codes = 30;
+constexpr int fixed_lit_codes = 288;
+constexpr int fast_bits = 10;
+
+class bit_reader {
+ public:
+  bit_reader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+  // The next n bits without consuming them. Past the end of the stream they read as zeros, which
+  // consume() then rejects.
+  uint32_t peek(int n) noexcept {
+    if (bit_count_ < n) refill();
+    return static_cast<uint32_t>(bit_buf_) & ((1u << n) - 1);
+  }
+
+  void consume(int n) {
+    if (n > bit_count_) throw apksig::parse_error("Truncated deflate stream");
+    bit_buf_ >>= n;
+    bit_count_ -= n;
+  }
+
+  uint32_t bits(int n) {
+    const auto val = peek(n);
+    consume(n);
+    return val;
+  }
+
+  // Drops the bits left in the current byte and hands the whole bytes still buffered back, stored
+  // blocks start byte aligned.
+  void align() noexcept {
+    pos_ -= static_cast<size_t>(bit_count_ / 8);
+    bit_buf_ = 0;
+    bit_count_ = 0;
+  }
+
+  const uint8_t* take(size_t n) {
+    if (size_ - pos_ < n) throw apksig::parse_error("Truncated deflate stream");
+    const auto* p = data_ + pos_;
+    pos_ += n;
+    return p;
+  }
+
+ private:
+  void refill() noexcept {
+    while (bit_count_ <= 56 && pos_ < size_) {
+      bit_buf_ |= uint64_t(data_[pos_++]) << bit_count_;
+      bit_count_ += 8;
+    }
+  }
+
+  const uint8_t* data_;
+  size_t size_;
+  size_t pos_ = 0;
+  uint64_t bit_buf_ = 0;
+  int bit_count_ = 0;
+};
+
+struct huffman {
+  std::array<uint16_t, max_bits + 1> count{};
+  std::array<uint16_t, fixed_lit_codes> symbol{};
+  // Indexed by the next fast_bits input bits: symbol << 4 | length for codes of at most fast_bits
+  // bits, 0 where a longer code starts.
+  std::array<uint16_t, 1 << fast_bits> fast{};
+
+  // Builds the canonical code from per-symbol code lengths. Incomplete codes are allowed, as the
+  // format permits them for single distance codes; over-subscribed ones are rejected.
+  huffman(const uint8_t* lengths, int n) {
+    for (int s = 0; s < n; s++) count[lengths[s]]++;
+    if (count[0] == n) return;
+
+    int left = 1;
+    for (size_t len = 1; len <= max_bits; len++) {
+      left <<= 1;
+      left -= count[len];
+      if (left < 0) throw apksig::parse_error("Over-subscribed Huffman code");
+    }
+
+    std::array<uint16_t, max_bits + 1> offs{};
+    for (size_t len = 1; len < max_bits; len++) offs[len + 1] = static_cast<uint16_t>(offs[len] + count[len]);
+    for (int s = 0; s < n; s++) {
+      if (lengths[s] != 0) symbol[offs[lengths[s]]++] = static_cast<uint16_t>(s);
+    }
+
+    // Codes are assigned in symbol order within each length and read starting from their first
+    // bit, which is the lowest bit of the buffer, hence the reversal.
+    uint32_t code = 0;
+    size_t index = 0;
+    for (int len = 1; len <= fast_bits; len++) {
+      for (int i = 0; i < count[static_cast<size_t>(len)]; i++, code++, index++) {
+        uint32_t reversed = 0;
+        for (int b = 0; b < len; b++) reversed |= ((code >> b) & 1) << (len - 1 - b);
+        const auto entry = static_cast<uint16_t>(symbol[index] << 4 | len);
+        for (auto slot = reversed; slot < fast.size(); slot += 1u << len) fast[slot] = entry;
+      }
+      code <<= 1;
+    }
+  }
+
+  int decode(bit_reader& in) const {
+    if (const auto entry = fast[in.peek(fast_bits)]; entry != 0) {
+      in.consume(entry & 0xf);
+      return entry >> 4;
+    }
+    int code = 0;
+    int first = 0;
+    int index = 0;
+    for (size_t len = 1; len <= max_bits; len++) {
+      code |= static_cast<int>(in.bits(1));
+      const int n = count[len];
+      if (code - n < first) return symbol[static_cast<size_t>(index + (code - first))];
+      index += n;
+      first += n;
+      first <<= 1;
+      code <<= 1;
+    }
+    throw apksig::parse_error("Invalid Huffman code");
+  }
+};
+
+constexpr std::array<uint16_t, 29> length_base{3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                               31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr std::array<uint8_t, 29> length_extra{0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                               2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr std::array<uint16_t, 30> dist_base{1,   2,   3,   4,   5,   7,    9,    13,   17,   25,
+                                             33,  49,  65,  97,  129, 193,  257,  385,  513,  769,
+                                             1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+constexpr std::array<uint8_t, 30> dist_extra{0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                             6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+void inflate_codes(bit_reader& in, std::vector<uint8_t>& out, size_t max_size, const huffman& lit,
+                   const huffman& dist) {
+  while (true) {
+    const auto sym = lit.decode(in);
+    if (sym < 256) {
+      if (out.size() == max_size) throw apksig::parse_error("Inflated data exceeds the expected size");
+      out.push_back(static_cast<uint8_t>(sym));
+      continue;
+    }
+    if (sym == 256) return;
+
+    const auto len_sym = static_cast<size_t>(sym - 257);
+    if (len_sym >= length_base.size()) throw apksig::parse_error("Invalid length code");
+    const size_t len = length_base[len_sym] + in.bits(length_extra[len_sym]);
+    const auto dist_sym = static_cast<size_t>(dist.decode(in));
+    if (dist_sym >= dist_base.size()) throw apksig::parse_error("Invalid distance code");
+    const size_t distance = dist_base[dist_sym] + in.bits(dist_extra[dist_sym]);
+    if (distance > out.size()) throw apksig::parse_error("Distance too far back");
+    if (max_size - out.size() < len) throw apksig::parse_error("Inflated data exceeds the expected size");
+    const auto start = out.size();
+    out.resize(start + len);
+    auto* dst = out.data() + start;
+    const auto* src = dst - distance;
+    if (distance >= len) {
+      std::memcpy(dst, src, len);
+    } else {
+      // Byte by byte, the source overlaps what is being written.
+      for (size_t i = 0; i < len; i++) dst[i] = src[i];
+    }
+  }
+}
+
+void inflate_fixed(bit_reader& in, std::vector<uint8_t>& out, size_t max_size) {
+  static const auto tables = [] {
+    std::array<uint8_t, fixed_lit_codes + max_dist_codes> lengths{};
+    size_t s = 0;
+    for (; s < 144; s++) lengths[s] = 8;
+    for (; s < 256; s++) lengths[s] = 9;
+    for (; s < 280; s++) lengths[s] = 7;
+    for (; s < fixed_lit_codes; s++) lengths[s] = 8;
+    for (; s < lengths.size(); s++) lengths[s] = 5;
+    return std::pair<huffman, huffman>{huffman(lengths.data(), fixed_lit_codes),
+                                       huffman(lengths.data() + fixed_lit_codes, max_dist_codes)};
+  }();
+  inflate_codes(in, out, max_size, tables.first, tables.second);
+}
+
+void inflate_dynamic(bit_reader& in, std::vector<uint8_t>& out, size_t max_size) {
+  static constexpr std::array<uint8_t, 19> order{16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+  const auto nlen = static_cast<int>(in.bits(5)) + 257;
+  const auto ndist = static_cast<int>(in.bits(5)) + 1;
+  const auto ncode = static_cast<int>(in.bits(4)) + 4;
+  if (nlen > max_lit_codes || ndist > max_dist_codes) throw apksig::parse_error("Bad dynamic block counts");
+
+  std::array<uint8_t, max_lit_codes + max_dist_codes> lengths{};
+  for (int i = 0; i < ncode; i++) lengths[order[static_cast<size_t>(i)]] = static_cast<uint8_t>(in.bits(3));
+  const huffman code_lengths(lengths.data(), 19);
+
+  int index = 0;
+  while (index < nlen + ndist) {
+    auto sym = code_lengths.decode(in);
+    if (sym < 16) {
+      lengths[static_cast<size_t>(index++)] = static_cast<uint8_t>(sym);
+      continue;
+    }
+    uint8_t len = 0;
+    int repeat;
+    if (sym == 16) {
+      if (index == 0) throw apksig::parse_error("Repeat with no previous length");
+      len = lengths[static_cast<size_t>(index - 1)];
+      repeat = 3 + static_cast<int>(in.bits(2));
+    } else if (sym == 17) {
+      repeat = 3 + static_cast<int>(in.bits(3));
+    } else {
+      repeat = 11 + static_cast<int>(in.bits(7));
+    }
+    if (index + repeat > nlen + ndist) throw apksig::parse_error("Too many code lengths");
+    while (repeat-- > 0) lengths[static_cast<size_t>(index++)] = len;
+  }
+  if (lengths[256] == 0) throw apksig::parse_error("No end-of-block code");
+
+  const huffman lit(lengths.data(), nlen);
+  const huffman dist(lengths.data() + nlen, ndist);
+  inflate_codes(in, out, max_size, lit, dist);
+}
+
+}  // namespace
+
+namespace apksig::detail {
+
+std::vector<uint8_t> inflate(const uint8_t* data, size_t size, size_t max_size) {
+  bit_reader in(data, size);
+  std::vector<uint8_t> out;
+  // max_size usually comes from the archive itself, so it is not trusted for the reservation.
+  out.reserve(std::min<size_t>(max_size, 16 * 1024 * 1024));
+
+  bool last;
+  do {
+    last = in.bits(1) != 0;
+    switch (in.bits(2)) {
+      case 0: {
+        in.align();
+        const auto* header = in.take(4);
+        const auto len = static_cast<size_t>(header[0] | header[1] << 8);
+        const auto nlen = static_cast<size_t>(header[2] | header[3] << 8);
+        if (len != (~nlen & 0xffff)) throw parse_error("Stored block length mismatch");
+        if (max_size - out.size() < len) throw parse_error("Inflated data exceeds the expected size");
+        const auto* p = in.take(len);
+        out.insert(out.end(), p, p + len);
+        break;
+      }
+      case 1:
+        inflate_fixed(in, out, max_size);
+        break;
+      case 2:
+        inflate_dynamic(in, out, max_size);
+        break;
+      default:
+        throw parse_error("Invalid deflate block type");
+    }
+  } while (!last);
+  return out;
+}
+
+uint32_t crc32(const uint8_t* data, size_t size) noexcept { return crc32_update(0, data, size); }
+
+uint32_t crc32_update(uint32_t crc, const uint8_t* data, size_t size) noexcept {
+  static const auto table = [] {
+    std::array<uint32_t, 256> t{};
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++) c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+      t[i] = c;
+    }
+    return t;
+  }();
+
+  crc = ~crc;
+  for (size_t i = 0; i < size; i++) crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+  return ~crc;
+}
+
+}  // namespace apksig::detail
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace apksig::detail {
+
+// Decompresses a raw DEFLATE stream (RFC 1951), as stored in ZIP entries. Throws parse_error on
+// malformed input or when the output would exceed max_size.
+std::vector<uint8_t> inflate(const uint8_t* data, size_t size, size_t max_size);
+
+// CRC-32 as used by ZIP.
+uint32_t crc32(const uint8_t* data, size_t size) noexcept;
+// Continues crc, the CRC-32 of the data before, over [data, data + size). Starts from 0.
+uint32_t crc32_update(uint32_t crc, const uint8_t* data, size_t size) noexcept;
+
+}  // namespace apksig::detail
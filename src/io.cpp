@@ -0,0 +1,131 @@
+#include "apksig/io.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace apksig {
+
+memory_streambuf::memory_streambuf(std::shared_ptr<const std::vector<uint8_t>> bytes, uint64_t base_offset)
+    : bytes_(std::move(bytes)), base_offset_(base_offset) {
+  // The get area is never written through, std::streambuf just has no const flavour of it.
+  auto* first = const_cast<char*>(reinterpret_cast<const char*>(bytes_->data()));
+  setg(first, first, first + bytes_->size());
+}
+
+memory_streambuf::pos_type memory_streambuf::seekoff(off_type off, std::ios_base::seekdir dir,
+                                                     std::ios_base::openmode which) {
+  off_type base = 0;
+  if (dir == std::ios_base::beg) {
+    base = 0;
+  } else if (dir == std::ios_base::cur) {
+    base = static_cast<off_type>(base_offset_) + (gptr() - eback());
+  } else {
+    base = static_cast<off_type>(base_offset_ + bytes_->size());
+  }
+  return seekpos(pos_type(base + off), which);
+}
+
+memory_streambuf::pos_type memory_streambuf::seekpos(pos_type pos, std::ios_base::openmode which) {
+  const auto abs_pos = static_cast<off_type>(pos);
+  if (!(which & std::ios_base::in) || abs_pos < static_cast<off_type>(base_offset_) ||
+      abs_pos > static_cast<off_type>(base_offset_ + bytes_->size())) {
+    return pos_type(off_type(-1));
+  }
+  setg(eback(), eback() + (abs_pos - static_cast<off_type>(base_offset_)), egptr());
+  return pos;
+}
+
+memory_istream::memory_istream(std::shared_ptr<const std::vector<uint8_t>> bytes, uint64_t base_offset)
+    : std::istream(nullptr), buf_(std::move(bytes), base_offset) {
+  rdbuf(&buf_);
+}
+
+file_range_streambuf::file_range_streambuf(const std::filesystem::path& file, uint64_t offset, uint64_t size)
+    : offset_(offset), size_(size), buf_(64 * 1024) {
+  if (file_.open(file, std::ios_base::in | std::ios_base::binary) == nullptr) {
+    throw std::runtime_error("Could not open " + file.string());
+  }
+  setg(buf_.data(), buf_.data(), buf_.data());
+}
+
+uint64_t file_range_streambuf::position() const noexcept {
+  return buf_pos_ + static_cast<uint64_t>(gptr() - eback());
+}
+
+size_t file_range_streambuf::read_at(uint64_t pos, char* out, size_t n) {
+  n = static_cast<size_t>(std::min<uint64_t>(n, size_ - pos));
+  if (n == 0) return 0;
+  if (file_.pubseekpos(static_cast<off_type>(offset_ + pos), std::ios_base::in) == pos_type(off_type(-1))) return 0;
+  return static_cast<size_t>(file_.sgetn(out, static_cast<std::streamsize>(n)));
+}
+
+file_range_streambuf::int_type file_range_streambuf::underflow() {
+  if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+  const auto pos = position();
+  if (pos >= size_) return traits_type::eof();
+  const auto n = read_at(pos, buf_.data(), buf_.size());
+  buf_pos_ = pos;
+  setg(buf_.data(), buf_.data(), buf_.data() + n);
+  return n == 0 ? traits_type::eof() : traits_type::to_int_type(*gptr());
+}
+
+std::streamsize file_range_streambuf::xsgetn(char_type* s, std::streamsize n) {
+  std::streamsize done = 0;
+  while (done < n) {
+    if (gptr() == egptr()) {
+      const auto remaining = static_cast<size_t>(n - done);
+      // Large reads go straight to the file instead of through the buffer.
+      if (remaining >= buf_.size()) {
+        const auto pos = position();
+        const auto got = read_at(pos, s + done, remaining);
+        buf_pos_ = pos + got;
+        setg(buf_.data(), buf_.data(), buf_.data());
+        done += static_cast<std::streamsize>(got);
+        if (got < remaining) break;
+        continue;
+      }
+      if (traits_type::eq_int_type(underflow(), traits_type::eof())) break;
+    }
+    const auto avail = std::min<std::streamsize>(egptr() - gptr(), n - done);
+    std::memcpy(s + done, gptr(), static_cast<size_t>(avail));
+    gbump(static_cast<int>(avail));
+    done += avail;
+  }
+  return done;
+}
+
+file_range_streambuf::pos_type file_range_streambuf::seekoff(off_type off, std::ios_base::seekdir dir,
+                                                             std::ios_base::openmode which) {
+  off_type base = 0;
+  if (dir == std::ios_base::cur) {
+    base = static_cast<off_type>(position());
+  } else if (dir == std::ios_base::end) {
+    base = static_cast<off_type>(size_);
+  }
+  return seekpos(pos_type(base + off), which);
+}
+
+file_range_streambuf::pos_type file_range_streambuf::seekpos(pos_type pos, std::ios_base::openmode which) {
+  const auto target = static_cast<off_type>(pos);
+  if (!(which & std::ios_base::in) || target < 0 || target > static_cast<off_type>(size_)) {
+    return pos_type(off_type(-1));
+  }
+  const auto upos = static_cast<uint64_t>(target);
+  // Keep the buffer when the target lies inside it.
+  if (upos >= buf_pos_ && upos <= buf_pos_ + static_cast<uint64_t>(egptr() - eback())) {
+    setg(eback(), eback() + (upos - buf_pos_), egptr());
+  } else {
+    buf_pos_ = upos;
+    setg(buf_.data(), buf_.data(), buf_.data());
+  }
+  return pos;
+}
+
+file_range_istream::file_range_istream(const std::filesystem::path& file, uint64_t offset, uint64_t size)
+    : std::istream(nullptr), buf_(file, offset, size) {
+  rdbuf(&buf_);
+}
+
+}  // namespace apksig
@@ -0,0 +1,63 @@
+#include "jar_manifest.hpp"
+
+#include "apksig/apksig.hpp"
+
+namespace apksig::detail {
+
+const std::string* jar_section::get(std::string_view key) const noexcept {
+  for (const auto& [k, v] : attributes) {
+    if (k == key) return &v;
+  }
+  return nullptr;
+}
+
+const jar_section* jar_manifest::find(const std::string& name) const noexcept {
+  const auto it = by_name.find(name);
+  return it == by_name.end() ? nullptr : &sections[it->second];
+}
+
+jar_manifest parse_jar_manifest(const uint8_t* data, size_t size) {
+  jar_manifest manifest;
+  const std::string_view text(reinterpret_cast<const char*>(data), size);
+
+  jar_section current;
+  const auto close_section = [&](size_t end) {
+    current.end = end;
+    if (const auto* name = current.get("Name")) current.name = *name;
+    // Duplicate names keep the first section.
+    if (!current.name.empty()) manifest.by_name.emplace(current.name, manifest.sections.size());
+    manifest.sections.push_back(std::move(current));
+    current = jar_section{};
+    current.begin = end;
+  };
+
+  size_t pos = 0;
+  while (pos < size) {
+    const auto eol = text.find_first_of("\r\n", pos);
+    const auto line = text.substr(pos, eol == std::string_view::npos ? std::string_view::npos : eol - pos);
+    pos = eol == std::string_view::npos ? size : eol + 1;
+    if (eol != std::string_view::npos && text[eol] == '\r' && pos < size && text[pos] == '\n') pos++;
+
+    if (line.empty()) {
+      // The main section always exists; further blank lines between sections are skipped.
+      if (!current.attributes.empty() || manifest.sections.empty()) {
+        close_section(pos);
+      } else {
+        current.begin = pos;
+      }
+      continue;
+    }
+    if (line.front() == ' ') {
+      if (current.attributes.empty()) throw parse_error("Continuation line without an attribute");
+      current.attributes.back().second.append(line.substr(1));
+      continue;
+    }
+    const auto colon = line.find(": ");
+    if (colon == std::string_view::npos || colon == 0) throw parse_error("Malformed manifest line");
+    current.attributes.emplace_back(std::string(line.substr(0, colon)), std::string(line.substr(colon + 2)));
+  }
+  if (!current.attributes.empty() || manifest.sections.empty()) close_section(size);
+  return manifest;
+}
+
+}  // namespace apksig::detail
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace apksig::detail {
+
+// One section of a JAR manifest or signature file.
+struct jar_section {
+  // The Name attribute, empty for the main section.
+  std::string name;
+  // Byte range of the section, including the blank line that ends it, which is what *.SF files
+  // digest.
+  size_t begin = 0;
+  size_t end = 0;
+  // In file order, continuation lines already joined.
+  std::vector<std::pair<std::string, std::string>> attributes;
+
+  const std::string* get(std::string_view key) const noexcept;
+};
+
+struct jar_manifest {
+  // sections[0] is the main section.
+  std::vector<jar_section> sections;
+  // Name to index into sections.
+  std::unordered_map<std::string, size_t> by_name;
+
+  const jar_section* find(const std::string& name) const noexcept;
+};
+
+// Parses line by line in a single pass. Lines may end in CRLF, LF or CR; a line starting with a
+// space continues the previous value. Throws parse_error on malformed lines.
+jar_manifest parse_jar_manifest(const uint8_t* data, size_t size);
+
+}  // namespace apksig::detail
@@ -0,0 +1,145 @@
+#include "apksig/key.hpp"
+
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/pk.h>
+#include <mbedtls/x509_crt.h>
+
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+#include "read_utils.hpp"
+#include "sha.hpp"
+#include "sig_algo.hpp"
+
+namespace {
+
+void check(int ret, const char* what) {
+  if (ret != 0) throw std::runtime_error(std::string(what) + " failed: mbedtls error " + std::to_string(ret));
+}
+
+// mbedtls only accepts PEM input that includes the terminating NUL.
+std::vector<uint8_t> nul_terminated_if_pem(const std::vector<uint8_t>& data) {
+  constexpr std::string_view pem_begin{"-----BEGIN"};
+  std::vector<uint8_t> out(data);
+  if (std::search(out.cbegin(), out.cend(), pem_begin.cbegin(), pem_begin.cend()) != out.cend()) {
+    out.push_back(0);
+  }
+  return out;
+}
+
+}  // namespace
+
+namespace apksig {
+
+struct signing_key::impl {
+  mbedtls_pk_context pk;
+  mbedtls_entropy_context entropy;
+  mbedtls_ctr_drbg_context ctr_drbg;
+  std::mutex mutex;
+  std::vector<certificate> certificates;
+  ::apksig::public_key public_key;
+
+  impl() {
+    mbedtls_pk_init(&pk);
+    mbedtls_entropy_init(&entropy);
+    mbedtls_ctr_drbg_init(&ctr_drbg);
+  }
+  impl(const impl&) = delete;
+  impl& operator=(const impl&) = delete;
+  ~impl() {
+    mbedtls_ctr_drbg_free(&ctr_drbg);
+    mbedtls_entropy_free(&entropy);
+    mbedtls_pk_free(&pk);
+  }
+};
+
+signing_key::signing_key(const std::vector<uint8_t>& key_data, const std::vector<uint8_t>& cert_data,
+                         std::string_view password)
+    : impl_(std::make_unique<impl>()) {
+  check(mbedtls_ctr_drbg_seed(&impl_->ctr_drbg, mbedtls_entropy_func, &impl_->entropy, nullptr, 0),
+        "Seeding the DRBG");
+
+  const auto key = nul_terminated_if_pem(key_data);
+  check(mbedtls_pk_parse_key(&impl_->pk, key.data(), key.size(), reinterpret_cast<const unsigned char*>(password.data()),
+                             password.size(), mbedtls_ctr_drbg_random, &impl_->ctr_drbg),
+        "Parsing the private key");
+
+  mbedtls_x509_crt chain;
+  mbedtls_x509_crt_init(&chain);
+  const auto certs = nul_terminated_if_pem(cert_data);
+  const auto ret = mbedtls_x509_crt_parse(&chain, certs.data(), certs.size());
+  if (ret == 0) {
+    for (const auto* crt = &chain; crt != nullptr && crt->raw.len > 0; crt = crt->next) {
+      impl_->certificates.emplace_back(crt->raw.p, crt->raw.p + crt->raw.len);
+    }
+  }
+  mbedtls_x509_crt_free(&chain);
+  check(ret, "Parsing the certificate chain");
+
+  std::vector<uint8_t> buf(4096);
+  const auto len = mbedtls_pk_write_pubkey_der(&impl_->pk, buf.data(), buf.size());
+  if (len < 0) check(len, "Encoding the public key");
+  // mbedtls writes DER structures at the end of the buffer.
+  impl_->public_key.assign(buf.cend() - len, buf.cend());
+}
+
+signing_key::signing_key(signing_key&&) noexcept = default;
+signing_key& signing_key::operator=(signing_key&&) noexcept = default;
+signing_key::~signing_key() = default;
+
+signing_key signing_key::load(const std::filesystem::path& key_file, const std::filesystem::path& cert_file,
+                              std::string_view password) {
+  return signing_key(detail::read_file(key_file), detail::read_file(cert_file), password);
+}
+
+const std::vector<certificate>& signing_key::certificates() const noexcept { return impl_->certificates; }
+
+const ::apksig::public_key& signing_key::public_key() const noexcept { return impl_->public_key; }
+
+uint32_t signing_key::default_sig_algo_id() const {
+  switch (mbedtls_pk_get_type(&impl_->pk)) {
+    case MBEDTLS_PK_RSA:
+      return 0x0103;  // RSASSA-PKCS1-v1_5 with SHA2-256
+    case MBEDTLS_PK_ECKEY:
+    case MBEDTLS_PK_ECDSA:
+      return 0x0201;  // ECDSA with SHA2-256
+    default:
+      throw std::runtime_error("Unsupported signing key type");
+  }
+}
+
+std::vector<uint8_t> signing_key::sign(uint32_t sig_algo_id, const uint8_t* data, size_t size) const {
+  const auto algo = detail::sig_algo_info_of(sig_algo_id);
+  if (!algo || algo->scheme == detail::sig_scheme::dsa) {
+    throw std::runtime_error("Unsupported signature algorithm " + std::to_string(sig_algo_id));
+  }
+
+  std::vector<uint8_t> hash(detail::sha_size(algo->md));
+  detail::sha_context ctx(algo->md);
+  ctx.update(data, size);
+  ctx.finish(hash.data());
+
+  std::lock_guard lock(impl_->mutex);
+  auto* pk = &impl_->pk;
+  const auto is_rsa = mbedtls_pk_get_type(pk) == MBEDTLS_PK_RSA;
+  if (is_rsa != (algo->scheme != detail::sig_scheme::ecdsa)) {
+    throw std::runtime_error("Signature algorithm does not match the key type");
+  }
+  if (is_rsa) {
+    const auto padding = algo->scheme == detail::sig_scheme::rsa_pss ? MBEDTLS_RSA_PKCS_V21 : MBEDTLS_RSA_PKCS_V15;
+    check(mbedtls_rsa_set_padding(mbedtls_pk_rsa(*pk), padding, detail::md_type_of(algo->md)), "Setting RSA padding");
+  }
+
+  std::vector<uint8_t> sig(MBEDTLS_PK_SIGNATURE_MAX_SIZE);
+  size_t sig_len = 0;
+  check(mbedtls_pk_sign(pk, detail::md_type_of(algo->md), hash.data(), hash.size(), sig.data(), sig.size(), &sig_len,
+                        mbedtls_ctr_drbg_random, &impl_->ctr_drbg),
+        "Signing");
+  sig.resize(sig_len);
+  return sig;
+}
+
+}  // namespace apksig
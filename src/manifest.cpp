@@ -0,0 +1,236 @@
+#include "apksig/manifest.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <string_view>
+#include <vector>
+
+#include "apksig/apksig.hpp"
+#include "read_utils.hpp"
+
+namespace {
+
+using apksig::parse_error;
+using apksig::detail::le_to_host;
+
+// Chunk types and attribute resource IDs from the platform's ResourceTypes.h and R.attr.
+constexpr uint16_t res_xml_type = 0x0003;
+constexpr uint16_t res_string_pool_type = 0x0001;
+constexpr uint16_t res_xml_resource_map_type = 0x0180;
+constexpr uint16_t res_xml_start_element_type = 0x0102;
+constexpr size_t chunk_header_size = 8;
+constexpr uint32_t string_pool_utf8_flag = 1 << 8;
+constexpr uint32_t no_string = 0xffffffff;
+
+constexpr uint8_t type_reference = 0x01;
+constexpr uint8_t type_string = 0x03;
+constexpr uint8_t type_int_dec = 0x10;
+constexpr uint8_t type_int_hex = 0x11;
+
+constexpr uint32_t attr_version_code = 0x0101021b;
+constexpr uint32_t attr_version_name = 0x0101021c;
+constexpr uint32_t attr_min_sdk_version = 0x0101020c;
+constexpr uint32_t attr_target_sdk_version = 0x01010270;
+
+// Bounds-checked view of the manifest bytes.
+class byte_view {
+ public:
+  byte_view(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+  template <class T>
+  T get(size_t pos) const {
+    check(pos, sizeof(T));
+    return le_to_host<T>(data_ + pos);
+  }
+  void check(size_t pos, size_t n) const {
+    if (pos > size_ || size_ - pos < n) throw parse_error("Truncated binary XML");
+  }
+  const uint8_t* at(size_t pos) const noexcept { return data_ + pos; }
+  size_t size() const noexcept { return size_; }
+
+ private:
+  const uint8_t* data_;
+  size_t size_;
+};
+
+void append_utf8(std::string& out, uint32_t cp) {
+  if (cp < 0x80) {
+    out.push_back(static_cast<char>(cp));
+  } else if (cp < 0x800) {
+    out.push_back(static_cast<char>(0xc0 | (cp >> 6)));
+    out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+  } else if (cp < 0x10000) {
+    out.push_back(static_cast<char>(0xe0 | (cp >> 12)));
+    out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+    out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+  } else {
+    out.push_back(static_cast<char>(0xf0 | (cp >> 18)));
+    out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3f)));
+    out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+    out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+  }
+}
+
+// A string pool chunk, decoded one string at a time on request.
+class string_pool {
+ public:
+  string_pool() = default;
+  string_pool(const byte_view& bytes, size_t chunk) : bytes_(&bytes) {
+    count_ = bytes.get<uint32_t>(chunk + 8);
+    utf8_ = (bytes.get<uint32_t>(chunk + 16) & string_pool_utf8_flag) != 0;
+    strings_ = chunk + bytes.get<uint32_t>(chunk + 20);
+    offsets_ = chunk + bytes.get<uint16_t>(chunk + 2);
+    bytes.check(offsets_, size_t(count_) * 4);
+  }
+
+  std::string get(uint32_t index) const {
+    if (bytes_ == nullptr || index >= count_) throw parse_error("String index out of range");
+    auto pos = strings_ + bytes_->get<uint32_t>(offsets_ + size_t(index) * 4);
+    return utf8_ ? get_utf8(pos) : get_utf16(pos);
+  }
+
+ private:
+  // One or two bytes, the high bit of the first flagging the two byte form.
+  size_t read_len8(size_t& pos) const {
+    size_t len = bytes_->get<uint8_t>(pos++);
+    if (len & 0x80) len = ((len & 0x7f) << 8) | bytes_->get<uint8_t>(pos++);
+    return len;
+  }
+
+  std::string get_utf8(size_t pos) const {
+    // The length in UTF-16 code units comes first, then the byte count.
+    read_len8(pos);
+    const auto len = read_len8(pos);
+    bytes_->check(pos, len);
+    return std::string(reinterpret_cast<const char*>(bytes_->at(pos)), len);
+  }
+
+  std::string get_utf16(size_t pos) const {
+    size_t len = bytes_->get<uint16_t>(pos);
+    pos += 2;
+    if (len & 0x8000) {
+      len = ((len & 0x7fff) << 16) | bytes_->get<uint16_t>(pos);
+      pos += 2;
+    }
+    bytes_->check(pos, len * 2);
+    std::string out;
+    out.reserve(len);
+    for (size_t i = 0; i < len; i++) {
+      uint32_t cp = bytes_->get<uint16_t>(pos + i * 2);
+      if (cp >= 0xd800 && cp < 0xdc00 && i + 1 < len) {
+        const uint32_t low = bytes_->get<uint16_t>(pos + (i + 1) * 2);
+        if (low >= 0xdc00 && low < 0xe000) {
+          cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+          i++;
+        }
+      }
+      append_utf8(out, cp);
+    }
+    return out;
+  }
+
+  const byte_view* bytes_ = nullptr;
+  uint32_t count_ = 0;
+  bool utf8_ = false;
+  size_t strings_ = 0;
+  size_t offsets_ = 0;
+};
+
+std::optional<int32_t> int_value(uint8_t type, uint32_t data) {
+  if (type == type_int_dec || type == type_int_hex) return static_cast<int32_t>(data);
+  return std::nullopt;
+}
+
+}  // namespace
+
+namespace apksig {
+
+manifest_info parse_binary_manifest(const uint8_t* data, size_t size) {
+  const byte_view bytes(data, size);
+  if (bytes.get<uint16_t>(0) != res_xml_type) throw parse_error("Not a binary XML document");
+
+  manifest_info info;
+  string_pool strings;
+  bool have_strings = false;
+  // Attribute resource IDs, indexed like the string pool.
+  const uint8_t* res_ids = nullptr;
+  size_t res_id_count = 0;
+  bool seen_manifest = false;
+  bool seen_uses_sdk = false;
+
+  const auto end = std::min<size_t>(size, bytes.get<uint32_t>(4));
+  for (size_t chunk = bytes.get<uint16_t>(2); chunk + chunk_header_size <= end && !(seen_manifest && seen_uses_sdk);) {
+    const auto type = bytes.get<uint16_t>(chunk);
+    const auto header_size = bytes.get<uint16_t>(chunk + 2);
+    const auto chunk_size = bytes.get<uint32_t>(chunk + 4);
+    if (chunk_size < chunk_header_size || chunk_size > end - chunk) throw parse_error("Bad binary XML chunk size");
+
+    if (type == res_string_pool_type && !have_strings) {
+      strings = string_pool(bytes, chunk);
+      have_strings = true;
+    } else if (type == res_xml_resource_map_type) {
+      res_ids = bytes.at(chunk + header_size);
+      res_id_count = (chunk_size - std::min<size_t>(header_size, chunk_size)) / 4;
+    } else if (type == res_xml_start_element_type) {
+      // The element extension follows the node header: ns, name, attributeStart, attributeSize,
+      // attributeCount.
+      const auto ext = chunk + header_size;
+      const auto name = strings.get(bytes.get<uint32_t>(ext + 4));
+      const bool is_manifest = name == "manifest";
+      const bool is_uses_sdk = name == "uses-sdk";
+      if (is_manifest || is_uses_sdk) {
+        const auto attr_start = ext + bytes.get<uint16_t>(ext + 8);
+        const auto attr_size = bytes.get<uint16_t>(ext + 10);
+        const auto attr_count = bytes.get<uint16_t>(ext + 12);
+        for (size_t i = 0; i < attr_count; i++) {
+          const auto attr = attr_start + i * attr_size;
+          const auto name_index = bytes.get<uint32_t>(attr + 4);
+          const auto raw_value = bytes.get<uint32_t>(attr + 8);
+          const auto value_type = bytes.get<uint8_t>(attr + 15);
+          const auto value = bytes.get<uint32_t>(attr + 16);
+          // Resource IDs identify framework attributes even when their names were obfuscated.
+          const auto res_id = name_index < res_id_count ? le_to_host<uint32_t>(res_ids + size_t(name_index) * 4) : 0;
+          const auto string_value = [&] {
+            const auto index = value_type == type_string ? value : raw_value;
+            return index == no_string || value_type == type_reference ? std::string() : strings.get(index);
+          };
+
+          if (is_manifest) {
+            if (res_id == 0 && strings.get(name_index) == "package") {
+              info.package = string_value();
+            } else if (res_id == attr_version_code) {
+              if (const auto v = int_value(value_type, value)) info.version_code = static_cast<uint32_t>(*v);
+            } else if (res_id == attr_version_name) {
+              info.version_name = string_value();
+            }
+          } else if (res_id == attr_min_sdk_version) {
+            info.min_sdk_version = int_value(value_type, value);
+          } else if (res_id == attr_target_sdk_version) {
+            info.target_sdk_version = int_value(value_type, value);
+          }
+        }
+        seen_manifest = seen_manifest || is_manifest;
+        seen_uses_sdk = seen_uses_sdk || is_uses_sdk;
+      }
+    }
+    chunk += chunk_size;
+  }
+
+  if (!seen_manifest) throw parse_error("No <manifest> element");
+  return info;
+}
+
+manifest_info read_manifest(std::istream& apk, const central_directory& dir, const parse_limits& limits) {
+  const auto* entry = dir.find("AndroidManifest.xml");
+  if (entry == nullptr) throw parse_error("No AndroidManifest.xml");
+  const auto data = read_entry(apk, *entry, dir.offset(), limits.max_entry_size);
+  return parse_binary_manifest(data.data(), data.size());
+}
+
+manifest_info read_manifest(const std::filesystem::path& apk_fpath, const parse_limits& limits) {
+  std::ifstream ifs(apk_fpath, std::ios_base::in | std::ios_base::binary);
+  ifs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+  return read_manifest(ifs, central_directory::read(apk_fpath, limits), limits);
+}
+
+}  // namespace apksig
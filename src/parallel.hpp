@@ -0,0 +1,47 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace apksig::detail {
+
+// 0 means one thread per hardware thread.
+inline unsigned resolve_threads(unsigned requested) noexcept {
+  if (requested != 0) return requested;
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Splits [0, n) into at most `threads` contiguous ranges and calls f(begin, end) for each of them
+// on its own thread. The first exception thrown by any range is rethrown once all threads joined.
+template <class F>
+void parallel_for(size_t n, unsigned threads, F f) {
+  const size_t workers = std::min<size_t>(resolve_threads(threads), n);
+  if (workers <= 1) {
+    if (n > 0) f(size_t(0), n);
+    return;
+  }
+
+  std::vector<std::exception_ptr> errors(workers);
+  std::vector<std::thread> pool;
+  pool.reserve(workers);
+  for (size_t w = 0; w < workers; w++) {
+    const size_t begin = n * w / workers;
+    const size_t end = n * (w + 1) / workers;
+    pool.emplace_back([&f, &errors, w, begin, end] {
+      try {
+        f(begin, end);
+      } catch (...) {
+        errors[w] = std::current_exception();
+      }
+    });
+  }
+  for (auto& t : pool) t.join();
+  for (const auto& e : errors) {
+    if (e) std::rethrow_exception(e);
+  }
+}
+
+}  // namespace apksig::detail
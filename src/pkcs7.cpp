@@ -0,0 +1,196 @@
+#include "pkcs7.hpp"
+
+#include <mbedtls/asn1.h>
+#include <mbedtls/pk.h>
+#include <mbedtls/x509_crt.h>
+
+#include <algorithm>
+#include <optional>
+#include <string_view>
+
+#include "apksig/cert_cache.hpp"
+#include "sha.hpp"
+#include "sig_algo.hpp"
+
+namespace {
+
+using apksig::detail::sha_kind;
+
+constexpr uint8_t oid_signed_data[] = {0x2a, 0x86, 0x48, 0x86, 0xf7, 0x0d, 0x01, 0x07, 0x02};
+constexpr uint8_t oid_message_digest[] = {0x2a, 0x86, 0x48, 0x86, 0xf7, 0x0d, 0x01, 0x09, 0x04};
+constexpr uint8_t oid_sha1[] = {0x2b, 0x0e, 0x03, 0x02, 0x1a};
+constexpr uint8_t oid_sha256[] = {0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x01};
+constexpr uint8_t oid_sha384[] = {0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x02};
+constexpr uint8_t oid_sha512[] = {0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x03};
+
+constexpr int seq_tag = MBEDTLS_ASN1_CONSTRUCTED | MBEDTLS_ASN1_SEQUENCE;
+constexpr int set_tag = MBEDTLS_ASN1_CONSTRUCTED | MBEDTLS_ASN1_SET;
+constexpr int context_tag_0 = MBEDTLS_ASN1_CONTEXT_SPECIFIC | MBEDTLS_ASN1_CONSTRUCTED | 0;
+constexpr int context_tag_1 = MBEDTLS_ASN1_CONTEXT_SPECIFIC | MBEDTLS_ASN1_CONSTRUCTED | 1;
+
+// A DER element: its full encoding and its contents.
+struct der {
+  const uint8_t* tlv = nullptr;
+  size_t tlv_size = 0;
+  uint8_t* content = nullptr;
+  size_t size = 0;
+
+  uint8_t* end() const noexcept { return content + size; }
+};
+
+bool peek(const uint8_t* p, const uint8_t* end, int tag) noexcept { return p < end && *p == tag; }
+
+der expect(uint8_t*& p, const uint8_t* end, int tag) {
+  der d;
+  d.tlv = p;
+  size_t len = 0;
+  if (mbedtls_asn1_get_tag(&p, end, &len, tag) != 0) throw apksig::parse_error("Malformed PKCS #7 signature block");
+  d.content = p;
+  d.size = len;
+  p += len;
+  d.tlv_size = static_cast<size_t>(p - d.tlv);
+  return d;
+}
+
+template <size_t N>
+bool equals(const der& d, const uint8_t (&bytes)[N]) noexcept {
+  return d.size == N && std::equal(d.content, d.end(), bytes);
+}
+
+// Reads an AlgorithmIdentifier naming a digest.
+std::optional<sha_kind> digest_algorithm(const der& alg_id) {
+  auto* p = alg_id.content;
+  const auto oid = expect(p, alg_id.end(), MBEDTLS_ASN1_OID);
+  if (equals(oid, oid_sha1)) return sha_kind::sha1;
+  if (equals(oid, oid_sha256)) return sha_kind::sha256;
+  if (equals(oid, oid_sha384)) return sha_kind::sha384;
+  if (equals(oid, oid_sha512)) return sha_kind::sha512;
+  return std::nullopt;
+}
+
+// The value of the messageDigest signed attribute, or an empty element.
+der message_digest_attribute(const der& signed_attrs) {
+  for (auto* p = signed_attrs.content; p < signed_attrs.end();) {
+    const auto attr = expect(p, signed_attrs.end(), seq_tag);
+    auto* q = attr.content;
+    const auto type = expect(q, attr.end(), MBEDTLS_ASN1_OID);
+    const auto values = expect(q, attr.end(), set_tag);
+    if (equals(type, oid_message_digest)) {
+      auto* v = values.content;
+      return expect(v, values.end(), MBEDTLS_ASN1_OCTET_STRING);
+    }
+  }
+  return {};
+}
+
+}  // namespace
+
+namespace apksig::detail {
+
+pkcs7_result pkcs7_verify(const std::vector<uint8_t>& block, const uint8_t* content, size_t content_size) {
+  pkcs7_result result;
+  // mbedtls' DER reader takes non-const pointers, though it never writes.
+  std::vector<uint8_t> buf(block);
+  uint8_t* p = buf.data();
+  const uint8_t* end = buf.data() + buf.size();
+
+  // ContentInfo
+  const auto content_info = expect(p, end, seq_tag);
+  p = content_info.content;
+  if (!equals(expect(p, content_info.end(), MBEDTLS_ASN1_OID), oid_signed_data)) {
+    throw parse_error("PKCS #7 block is not SignedData");
+  }
+  const auto explicit_0 = expect(p, content_info.end(), context_tag_0);
+  p = explicit_0.content;
+
+  // SignedData
+  const auto signed_data = expect(p, explicit_0.end(), seq_tag);
+  p = signed_data.content;
+  expect(p, signed_data.end(), MBEDTLS_ASN1_INTEGER);
+  expect(p, signed_data.end(), set_tag);
+  expect(p, signed_data.end(), seq_tag);
+  std::vector<der> certificates;
+  if (peek(p, signed_data.end(), context_tag_0)) {
+    const auto certs = expect(p, signed_data.end(), context_tag_0);
+    for (auto* c = certs.content; c < certs.end();) certificates.push_back(expect(c, certs.end(), seq_tag));
+  }
+  if (peek(p, signed_data.end(), context_tag_1)) expect(p, signed_data.end(), context_tag_1);
+  const auto signer_infos = expect(p, signed_data.end(), set_tag);
+
+  // SignerInfo
+  p = signer_infos.content;
+  if (p == signer_infos.end()) {
+    result.error = "No SignerInfo";
+    return result;
+  }
+  const auto signer_info = expect(p, signer_infos.end(), seq_tag);
+  p = signer_info.content;
+  expect(p, signer_info.end(), MBEDTLS_ASN1_INTEGER);
+  if (!peek(p, signer_info.end(), seq_tag)) {
+    result.error = "Signer identified by subject key identifier, only issuer and serial are supported";
+    return result;
+  }
+  const auto sid = expect(p, signer_info.end(), seq_tag);
+  auto* s = sid.content;
+  const auto issuer = expect(s, sid.end(), seq_tag);
+  const auto serial = expect(s, sid.end(), MBEDTLS_ASN1_INTEGER);
+  const auto md = digest_algorithm(expect(p, signer_info.end(), seq_tag));
+  der signed_attrs;
+  if (peek(p, signer_info.end(), context_tag_0)) signed_attrs = expect(p, signer_info.end(), context_tag_0);
+  expect(p, signer_info.end(), seq_tag);
+  const auto signature = expect(p, signer_info.end(), MBEDTLS_ASN1_OCTET_STRING);
+
+  if (!md) {
+    result.error = "Unsupported digest algorithm";
+    return result;
+  }
+
+  std::shared_ptr<const interned_certificate> signer;
+  for (const auto& c : certificates) {
+    auto cert = intern_certificate(certificate(c.tlv, c.tlv + c.tlv_size));
+    if (!cert->has_x509()) continue;
+    const auto& crt = cert->x509();
+    if (crt.issuer_raw.len == issuer.tlv_size && std::equal(issuer.tlv, issuer.tlv + issuer.tlv_size, crt.issuer_raw.p) &&
+        crt.serial.len == serial.size && std::equal(serial.content, serial.end(), crt.serial.p)) {
+      signer = std::move(cert);
+      break;
+    }
+  }
+  if (!signer) {
+    result.error = "Signer certificate not found in the signature block";
+    return result;
+  }
+  result.signer = signer->der();
+
+  // With signed attributes the signature covers their DER encoding as a SET, and the content is
+  // bound through the messageDigest attribute.
+  auto digest = sha_digest(*md, content, content_size);
+  if (signed_attrs.tlv != nullptr) {
+    const auto message_digest = message_digest_attribute(signed_attrs);
+    if (message_digest.content == nullptr ||
+        !std::equal(digest.cbegin(), digest.cend(), message_digest.content, message_digest.end())) {
+      result.error = "messageDigest attribute does not match the content";
+      return result;
+    }
+    std::vector<uint8_t> to_be_signed(signed_attrs.tlv, signed_attrs.tlv + signed_attrs.tlv_size);
+    to_be_signed[0] = set_tag;
+    digest = sha_digest(*md, to_be_signed.data(), to_be_signed.size());
+  }
+
+  // A private pk context: the interned certificate's key is shared between threads.
+  mbedtls_pk_context pk;
+  mbedtls_pk_init(&pk);
+  const auto& spki = signer->public_key();
+  auto ret = mbedtls_pk_parse_public_key(&pk, spki.data(), spki.size());
+  if (ret == 0) {
+    ret = mbedtls_pk_verify(&pk, md_type_of(*md), digest.data(), digest.size(), signature.content, signature.size);
+    result.verified = ret == 0;
+    if (!result.verified) result.error = "Signature does not verify";
+  } else {
+    result.error = "Unsupported signer public key";
+  }
+  mbedtls_pk_free(&pk);
+  return result;
+}
+
+}  // namespace apksig::detail
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "apksig/apksig.hpp"
+
+namespace apksig::detail {
+
+struct pkcs7_result {
+  bool verified = false;
+  // The certificate of the signer, when it was found among the block's certificates.
+  certificate signer;
+  std::string error;
+};
+
+// Checks a detached PKCS #7 SignedData block (a JAR *.RSA, *.EC or *.DSA file) over content. The
+// first SignerInfo is used, identified by issuer and serial number; signed attributes are
+// supported. Throws parse_error when the block is not well-formed DER.
+pkcs7_result pkcs7_verify(const std::vector<uint8_t>& block, const uint8_t* content, size_t content_size);
+
+}  // namespace apksig::detail
@@ -0,0 +1,103 @@
+#include "apksig/probe.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <ios>
+#include <system_error>
+#include <utility>
+
+#include "apksig/apksig.hpp"
+#include "read_utils.hpp"
+#include "signing_block_format.hpp"
+#include "zip_format.hpp"
+
+namespace {
+
+std::vector<uint8_t> read_range(std::istream& is, uint64_t pos, uint64_t n) {
+  is.seekg(static_cast<std::streamoff>(pos));
+  return apksig::detail::read_into_vector(is, static_cast<size_t>(n));
+}
+
+void throw_if_error(const apksig::parse_status& status) {
+  if (!status) throw apksig::parse_error(status.message());
+}
+
+}  // namespace
+
+namespace apksig {
+
+probe_result probe(const std::filesystem::path& apk_fpath, size_t tail_size, const parse_limits& limits) {
+  using namespace detail;
+
+  probe_result result;
+  auto idsig_fpath = apk_fpath;
+  idsig_fpath += ".idsig";
+  std::error_code ec;
+  result.has_v4 = std::filesystem::is_regular_file(idsig_fpath, ec);
+
+  const auto file_size = std::filesystem::file_size(apk_fpath);
+  std::ifstream ifs(apk_fpath, std::ios_base::in | std::ios_base::binary);
+  ifs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+
+  // The EOCD record is nearly always in the tail; only a long archive comment needs the rest of
+  // the search window.
+  auto tail_offset = file_size - std::min<uint64_t>(file_size, tail_size);
+  auto tail = read_range(ifs, tail_offset, file_size - tail_offset);
+  auto eocd = find_eocd(tail.data(), tail.size());
+  const auto window_offset = file_size - std::min<uint64_t>(file_size, eocd_max_distance);
+  if (!eocd && tail_offset > window_offset) {
+    auto window = read_range(ifs, window_offset, tail_offset - window_offset);
+    window.insert(window.end(), tail.cbegin(), tail.cend());
+    tail = std::move(window);
+    tail_offset = window_offset;
+    eocd = find_eocd(tail.data(), tail.size());
+  }
+  if (!eocd) throw_if_error({parse_errc::not_a_zip, tail_offset});
+  const auto eocd_pos = tail_offset + *eocd;
+  const uint64_t cd_offset = le_to_host<uint32_t>(tail.data() + *eocd + eocd_cd_offset_offset);
+  if (cd_offset > eocd_pos) throw_if_error({parse_errc::central_directory_out_of_range, eocd_pos});
+  if (cd_offset < signing_block_min_size) return result;
+
+  // Whatever isn't in the tail takes one positional read of the footer and one of the block.
+  const auto footer_pos = cd_offset - signing_block_footer_size;
+  std::array<uint8_t, signing_block_footer_size> footer;
+  if (footer_pos >= tail_offset) {
+    std::copy_n(tail.data() + (footer_pos - tail_offset), footer.size(), footer.data());
+  } else {
+    ifs.seekg(static_cast<std::streamoff>(footer_pos));
+    footer = read_into_array<signing_block_footer_size>(ifs);
+  }
+  uint64_t block_offset = 0;
+  const auto status = check_signing_block_footer(footer.data(), cd_offset, block_offset);
+  if (status.code == parse_errc::no_signing_block) return result;
+  throw_if_error(status);
+  if (cd_offset - block_offset > limits.max_block_size) throw_if_error({parse_errc::limit_exceeded, footer_pos});
+
+  std::vector<uint8_t> block_bytes;
+  const uint8_t* block = nullptr;
+  if (block_offset >= tail_offset) {
+    block = tail.data() + (block_offset - tail_offset);
+  } else {
+    block_bytes = read_range(ifs, block_offset, footer_pos - block_offset);
+    block = block_bytes.data();
+  }
+  result.has_signing_block = true;
+  result.signing_block_offset = block_offset;
+  result.signing_block_size = cd_offset - block_offset;
+
+  throw_if_error(walk_pairs(
+      block_offset, footer.data(), footer_pos,
+      [&](uint64_t pos, uint8_t* out, size_t n) {
+        std::copy_n(block + (pos - block_offset), n, out);
+        return true;
+      },
+      [&](uint32_t id, uint64_t, uint64_t) {
+        result.pair_ids.push_back(id);
+        result.has_v2 = result.has_v2 || id == v2_block_id;
+        result.has_v3 = result.has_v3 || id == v3_block_id;
+        result.has_v3_1 = result.has_v3_1 || id == v3_1_block_id;
+      }));
+  return result;
+}
+
+}  // namespace apksig
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <ios>
+#include <istream>
+#include <type_traits>
+#include <vector>
+
+namespace apksig::detail {
+
+template <size_t N, class T = uint8_t>
+std::array<T, N> read_into_array(std::istream& is) {
+  std::array<T, N> items_read;
+  is.read(reinterpret_cast<char*>(items_read.data()), std::streamsize(N));
+  return items_read;
+}
+
+template <class T>
+T le_to_host(const uint8_t* p) noexcept {
+  static_assert(std::is_unsigned_v<T> && std::is_integral_v<T>, "T must be a unsigned integral type");
+  static_assert(sizeof(T) <= 8, "Supports up to 64-bit integers");
+
+  T v = 0;
+  for (std::size_t i = 0; i < sizeof(T); i++) {
+    v |= static_cast<T>(p[i]) << (8 * i);
+  }
+  return v;
+}
+
+template <class T>
+T read_le(std::istream& is) {
+  const auto buf = read_into_array<sizeof(T)>(is);
+  return le_to_host<T>(buf.data());
+}
+
+inline std::vector<uint8_t> read_into_vector(std::istream& is, size_t n) {
+  std::vector<uint8_t> out(n);
+  is.read(reinterpret_cast<char*>(out.data()), static_cast<std::streamsize>(n));
+  return out;
+}
+
+inline std::vector<uint8_t> read_file(const std::filesystem::path& fpath) {
+  std::ifstream ifs(fpath, std::ios_base::in | std::ios_base::binary);
+  ifs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+  return read_into_vector(ifs, static_cast<size_t>(std::filesystem::file_size(fpath)));
+}
+
+}  // namespace apksig::detail
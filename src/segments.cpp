@@ -0,0 +1,38 @@
+#include "segments.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace apksig::detail {
+
+segment_reader::segment_reader(const std::filesystem::path& file, const std::vector<segment>& segments)
+    : ifs_(file, std::ios_base::in | std::ios_base::binary), segments_(segments) {
+  ifs_.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+  for (const auto& s : segments_) size_ += s.size;
+}
+
+void segment_reader::read(uint64_t pos, uint8_t* out, size_t n) {
+  if (pos + n > size_) throw std::out_of_range("Read past the end of the segments");
+
+  uint64_t segment_start = 0;
+  for (const auto& s : segments_) {
+    if (n == 0) break;
+    if (pos < segment_start + s.size) {
+      const auto in_segment = pos - segment_start;
+      const auto len = static_cast<size_t>(std::min<uint64_t>(n, s.size - in_segment));
+      if (s.bytes != nullptr) {
+        std::memcpy(out, s.bytes + in_segment, len);
+      } else {
+        ifs_.seekg(static_cast<std::streamoff>(s.offset + in_segment));
+        ifs_.read(reinterpret_cast<char*>(out), static_cast<std::streamsize>(len));
+      }
+      out += len;
+      pos += len;
+      n -= len;
+    }
+    segment_start += s.size;
+  }
+}
+
+}  // namespace apksig::detail
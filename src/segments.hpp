@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace apksig::detail {
+
+// A piece of the byte sequence a digest is computed over: a range of the file, or bytes held in
+// memory when `bytes` is set (e.g. the EOCD record with a patched central directory offset).
+struct segment {
+  uint64_t offset = 0;
+  uint64_t size = 0;
+  const uint8_t* bytes = nullptr;
+};
+
+// Positional reads over the concatenation of segments. Every reader owns its file handle, so one
+// reader per thread allows concurrent reads of the same file.
+class segment_reader {
+ public:
+  segment_reader(const std::filesystem::path& file, const std::vector<segment>& segments);
+
+  void read(uint64_t pos, uint8_t* out, size_t n);
+  uint64_t size() const noexcept { return size_; }
+
+ private:
+  std::ifstream ifs_;
+  const std::vector<segment>& segments_;
+  uint64_t size_ = 0;
+};
+
+}  // namespace apksig::detail
@@ -0,0 +1,177 @@
+#include "apksig/serialize.hpp"
+
+#include <algorithm>
+#include <string_view>
+#include <type_traits>
+
+#include "read_utils.hpp"
+#include "signing_block_format.hpp"
+#include "write_utils.hpp"
+
+namespace {
+
+using apksig::byte_view;
+using apksig::detail::append_le;
+using apksig::detail::le_to_host;
+
+constexpr std::string_view serialized_magic{"APKSIGSI"};
+constexpr uint32_t serialized_version = 1;
+constexpr size_t header_size = 8 + 4 + 4 + 4 * 8;
+constexpr size_t pair_record_size = 4 + 4 + 8 + 8 + 8;
+constexpr uint32_t flag_embedded = 1;
+
+bool embedded_id(uint32_t id) noexcept {
+  using namespace apksig::detail;
+  return id == v2_block_id || id == v3_block_id || id == v3_1_block_id || id == source_stamp_block_id;
+}
+
+// Bounds-checked reads over a byte_view.
+class cursor {
+ public:
+  explicit cursor(byte_view v) noexcept : p_(v.begin()), end_(v.end()) {}
+
+  bool done() const noexcept { return p_ == end_; }
+
+  byte_view bytes(size_t n) {
+    if (static_cast<size_t>(end_ - p_) < n) throw apksig::parse_error("Truncated block in serialized siginfo");
+    const byte_view v{p_, n};
+    p_ += n;
+    return v;
+  }
+  uint32_t u32() { return le_to_host<uint32_t>(bytes(4).data); }
+  uint64_t u64() { return le_to_host<uint64_t>(bytes(8).data); }
+  byte_view len_prefixed() { return bytes(u32()); }
+  byte_view rest() noexcept { return bytes(static_cast<size_t>(end_ - p_)); }
+
+ private:
+  const uint8_t* p_;
+  const uint8_t* end_;
+};
+
+// Applies f to a cursor over each element of a sequence of length-prefixed elements.
+template <class F>
+auto map_seq(byte_view seq, F f) {
+  std::vector<std::invoke_result_t<F, cursor&>> out;
+  for (cursor c(seq); !c.done();) {
+    cursor element(c.len_prefixed());
+    out.push_back(f(element));
+  }
+  return out;
+}
+
+apksig::id_bytes_view id_and_len_prefixed(cursor& c) {
+  const auto id = c.u32();
+  return {id, c.len_prefixed()};
+}
+
+apksig::id_bytes_view id_and_rest(cursor& c) {
+  const auto id = c.u32();
+  return {id, c.rest()};
+}
+
+apksig::signer_view signer(cursor& c, bool v3) {
+  apksig::signer_view s;
+  s.signed_data = c.len_prefixed();
+  cursor sd(s.signed_data);
+  s.digests = map_seq(sd.len_prefixed(), id_and_len_prefixed);
+  s.certificates = map_seq(sd.len_prefixed(), [](cursor& e) { return e.rest(); });
+  if (v3) {
+    // The signed copy of the SDK range, repeated below outside the signed data.
+    sd.u32();
+    sd.u32();
+  }
+  s.add_attrs = map_seq(sd.len_prefixed(), id_and_rest);
+  if (v3) {
+    s.min_sdk = c.u32();
+    s.max_sdk = c.u32();
+  }
+  s.signatures = map_seq(c.len_prefixed(), id_and_len_prefixed);
+  s.public_key = c.len_prefixed();
+  return s;
+}
+
+std::vector<apksig::signer_view> signers(byte_view block, bool v3) {
+  if (block.empty()) return {};
+  cursor c(block);
+  return map_seq(c.len_prefixed(), [v3](cursor& e) { return signer(e, v3); });
+}
+
+}  // namespace
+
+namespace apksig {
+
+std::vector<uint8_t> serialize_siginfo(siginfo& info) {
+  const auto& pairs = info.get_pairs();
+  std::vector<uint8_t> out(serialized_magic.cbegin(), serialized_magic.cend());
+  append_le(out, serialized_version);
+  append_le(out, static_cast<uint32_t>(pairs.size()));
+  const auto& sections = info.get_sections();
+  append_le(out, sections.signing_block_offset);
+  append_le(out, sections.cd_offset);
+  append_le(out, sections.eocd_offset);
+  append_le(out, sections.file_size);
+
+  uint64_t value_pos = header_size + pairs.size() * pair_record_size;
+  for (const auto& pair : pairs) {
+    const bool embedded = embedded_id(pair.id);
+    append_le(out, pair.id);
+    append_le(out, embedded ? flag_embedded : uint32_t(0));
+    append_le(out, pair.value_offset);
+    append_le(out, pair.value_size);
+    append_le(out, embedded ? value_pos : uint64_t(0));
+    if (embedded) value_pos += pair.value_size;
+  }
+  out.reserve(static_cast<size_t>(value_pos));
+  for (const auto& pair : pairs) {
+    if (embedded_id(pair.id)) detail::append_bytes(out, info.read_pair_value(pair));
+  }
+  return out;
+}
+
+siginfo_view::siginfo_view(const uint8_t* data, size_t size) {
+  if (size < header_size || !std::equal(serialized_magic.cbegin(), serialized_magic.cend(), data)) {
+    throw parse_error("Not serialized siginfo");
+  }
+  if (le_to_host<uint32_t>(data + 8) != serialized_version) throw parse_error("Unsupported serialized siginfo version");
+  const auto pair_count = le_to_host<uint32_t>(data + 12);
+  sections_.signing_block_offset = le_to_host<uint64_t>(data + 16);
+  sections_.cd_offset = le_to_host<uint64_t>(data + 24);
+  sections_.eocd_offset = le_to_host<uint64_t>(data + 32);
+  sections_.file_size = le_to_host<uint64_t>(data + 40);
+  if (pair_count > (size - header_size) / pair_record_size) throw parse_error("Truncated serialized siginfo");
+
+  pairs_.reserve(pair_count);
+  values_.reserve(pair_count);
+  for (const auto* r = data + header_size; r != data + header_size + pair_count * pair_record_size;
+       r += pair_record_size) {
+    const auto id = le_to_host<uint32_t>(r);
+    const auto flags = le_to_host<uint32_t>(r + 4);
+    const auto value_size = le_to_host<uint64_t>(r + 16);
+    const auto value_pos = le_to_host<uint64_t>(r + 24);
+    pairs_.push_back({id, le_to_host<uint64_t>(r + 8), value_size});
+    if ((flags & flag_embedded) == 0) {
+      values_.emplace_back();
+      continue;
+    }
+    if (value_pos > size || value_size > size - value_pos) throw parse_error("Embedded value runs past the buffer");
+    values_.push_back({data + value_pos, static_cast<size_t>(value_size)});
+  }
+}
+
+byte_view siginfo_view::pair_value(uint32_t id) const noexcept {
+  const auto it = std::find_if(pairs_.cbegin(), pairs_.cend(), [id](const auto& p) { return p.id == id; });
+  return it == pairs_.cend() ? byte_view{} : values_[static_cast<size_t>(it - pairs_.cbegin())];
+}
+
+bool siginfo_view::has_v2_block() const noexcept { return !pair_value(detail::v2_block_id).empty(); }
+bool siginfo_view::has_v3_block() const noexcept { return !pair_value(detail::v3_block_id).empty(); }
+bool siginfo_view::has_v3_1_block() const noexcept { return !pair_value(detail::v3_1_block_id).empty(); }
+bool siginfo_view::has_source_stamp() const noexcept { return !pair_value(detail::source_stamp_block_id).empty(); }
+
+std::vector<signer_view> siginfo_view::v2_signers() const { return signers(pair_value(detail::v2_block_id), false); }
+std::vector<signer_view> siginfo_view::v3_signers() const { return signers(pair_value(detail::v3_block_id), true); }
+std::vector<signer_view> siginfo_view::v3_1_signers() const {
+  return signers(pair_value(detail::v3_1_block_id), true);
+}
+
+}  // namespace apksig
@@ -0,0 +1,87 @@
+#include "sha.hpp"
+
+#include <stdexcept>
+
+namespace apksig::detail {
+
+namespace {
+
+void check(int ret) {
+  if (ret != 0) throw std::runtime_error("mbedtls hash operation failed");
+}
+
+}  // namespace
+
+sha_context::sha_context(sha_kind kind) : kind_(kind) {
+  if (kind_ == sha_kind::sha1) {
+    mbedtls_sha1_init(&sha1_);
+  } else if (kind_ == sha_kind::sha256) {
+    mbedtls_sha256_init(&sha256_);
+  } else {
+    mbedtls_sha512_init(&sha512_);
+  }
+  restart();
+}
+
+sha_context::sha_context(const sha_context& other) : kind_(other.kind_) {
+  if (kind_ == sha_kind::sha1) {
+    mbedtls_sha1_init(&sha1_);
+    mbedtls_sha1_clone(&sha1_, &other.sha1_);
+  } else if (kind_ == sha_kind::sha256) {
+    mbedtls_sha256_init(&sha256_);
+    mbedtls_sha256_clone(&sha256_, &other.sha256_);
+  } else {
+    mbedtls_sha512_init(&sha512_);
+    mbedtls_sha512_clone(&sha512_, &other.sha512_);
+  }
+}
+
+sha_context::~sha_context() {
+  if (kind_ == sha_kind::sha1) {
+    mbedtls_sha1_free(&sha1_);
+  } else if (kind_ == sha_kind::sha256) {
+    mbedtls_sha256_free(&sha256_);
+  } else {
+    mbedtls_sha512_free(&sha512_);
+  }
+}
+
+void sha_context::restart() {
+  if (kind_ == sha_kind::sha1) {
+    check(mbedtls_sha1_starts(&sha1_));
+  } else if (kind_ == sha_kind::sha256) {
+    check(mbedtls_sha256_starts(&sha256_, 0));
+  } else {
+    check(mbedtls_sha512_starts(&sha512_, kind_ == sha_kind::sha384 ? 1 : 0));
+  }
+}
+
+void sha_context::update(const uint8_t* data, size_t size) {
+  if (kind_ == sha_kind::sha1) {
+    check(mbedtls_sha1_update(&sha1_, data, size));
+  } else if (kind_ == sha_kind::sha256) {
+    check(mbedtls_sha256_update(&sha256_, data, size));
+  } else {
+    check(mbedtls_sha512_update(&sha512_, data, size));
+  }
+}
+
+void sha_context::finish(uint8_t* out) {
+  if (kind_ == sha_kind::sha1) {
+    check(mbedtls_sha1_finish(&sha1_, out));
+  } else if (kind_ == sha_kind::sha256) {
+    check(mbedtls_sha256_finish(&sha256_, out));
+  } else {
+    check(mbedtls_sha512_finish(&sha512_, out));
+  }
+}
+
+std::vector<uint8_t> sha_digest(sha_kind kind, const uint8_t* data, size_t size) {
+  std::vector<uint8_t> out(sha_size(kind));
+  sha_context ctx(kind);
+  ctx.update(data, size);
+  ctx.finish(out.data());
+  return out;
+}
+
+}  // namespace apksig::detail
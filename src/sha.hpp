@@ -0,0 +1,57 @@
+#pragma once
+
+#include <mbedtls/sha1.h>
+#include <mbedtls/sha256.h>
+#include <mbedtls/sha512.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace apksig::detail {
+
+// The v2+ schemes use SHA-256 and SHA-512. JAR signing and PKCS #7 may also use SHA-1, still the
+// norm for legacy v1 signatures, and SHA-384.
+enum class sha_kind { sha1, sha256, sha384, sha512 };
+
+constexpr size_t sha_size(sha_kind kind) noexcept {
+  switch (kind) {
+    case sha_kind::sha1:
+      return 20;
+    case sha_kind::sha256:
+      return 32;
+    case sha_kind::sha384:
+      return 48;
+    default:
+      return 64;
+  }
+}
+
+// Thin RAII wrapper over the mbedtls SHA contexts so callers can switch between hashes at runtime.
+class sha_context {
+ public:
+  explicit sha_context(sha_kind kind);
+  sha_context(const sha_context& other);
+  sha_context& operator=(const sha_context&) = delete;
+  ~sha_context();
+
+  void update(const uint8_t* data, size_t size);
+  // Writes sha_size(kind()) bytes to out. The context must be restarted before reuse.
+  void finish(uint8_t* out);
+  void restart();
+  sha_kind kind() const noexcept { return kind_; }
+
+ private:
+  sha_kind kind_;
+  union {
+    mbedtls_sha1_context sha1_;
+    mbedtls_sha256_context sha256_;
+    // SHA-384 too.
+    mbedtls_sha512_context sha512_;
+  };
+};
+
+// The sha_size(kind) byte digest of [data, data + size).
+std::vector<uint8_t> sha_digest(sha_kind kind, const uint8_t* data, size_t size);
+
+}  // namespace apksig::detail
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <mbedtls/md.h>
+
+#include <cstdint>
+#include <optional>
+
+#include "sha.hpp"
+
+namespace apksig::detail {
+
+enum class sig_scheme { rsa_pss, rsa_pkcs1, ecdsa, dsa };
+
+struct sig_algo_info {
+  sig_scheme scheme;
+  sha_kind md;
+};
+
+inline std::optional<sig_algo_info> sig_algo_info_of(uint32_t sig_algo_id) noexcept {
+  switch (sig_algo_id) {
+    case 0x0101:
+      return sig_algo_info{sig_scheme::rsa_pss, sha_kind::sha256};
+    case 0x0102:
+      return sig_algo_info{sig_scheme::rsa_pss, sha_kind::sha512};
+    case 0x0103:
+    case 0x0421:
+      return sig_algo_info{sig_scheme::rsa_pkcs1, sha_kind::sha256};
+    case 0x0104:
+      return sig_algo_info{sig_scheme::rsa_pkcs1, sha_kind::sha512};
+    case 0x0201:
+    case 0x0423:
+      return sig_algo_info{sig_scheme::ecdsa, sha_kind::sha256};
+    case 0x0202:
+      return sig_algo_info{sig_scheme::ecdsa, sha_kind::sha512};
+    case 0x0301:
+    case 0x0425:
+      return sig_algo_info{sig_scheme::dsa, sha_kind::sha256};
+    default:
+      return std::nullopt;
+  }
+}
+
+inline mbedtls_md_type_t md_type_of(sha_kind kind) noexcept {
+  switch (kind) {
+    case sha_kind::sha1:
+      return MBEDTLS_MD_SHA1;
+    case sha_kind::sha256:
+      return MBEDTLS_MD_SHA256;
+    case sha_kind::sha384:
+      return MBEDTLS_MD_SHA384;
+    default:
+      return MBEDTLS_MD_SHA512;
+  }
+}
+
+}  // namespace apksig::detail
@@ -0,0 +1,443 @@
+#include "apksig/sign.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "apksig/verify.hpp"
+#include "parallel.hpp"
+#include "read_utils.hpp"
+#include "signing_block_format.hpp"
+#include "write_utils.hpp"
+#include "zip_format.hpp"
+
+namespace {
+
+using apksig::detail::append_bytes;
+using apksig::detail::append_le;
+using apksig::detail::append_len_prefixed;
+
+constexpr uint64_t page_size = 4096;
+// v2 signed data attribute naming the scheme that must also be present, so the v3 signature can't
+// be stripped to fall back to v2. The value is the scheme ID.
+constexpr uint32_t stripping_protection_attr_id = 0xbeeff00d;
+constexpr uint32_t v3_scheme_id = 3;
+// Local header extra field record padding stored entries to their alignment: uint16 ID, uint16
+// size, uint16 alignment and the padding.
+constexpr uint16_t alignment_extra_id = 0xd935;
+constexpr size_t alignment_record_min_size = 6;
+
+// uint32 total length followed by every element, each length prefixed.
+std::vector<uint8_t> encode_seq(const std::vector<std::vector<uint8_t>>& elements) {
+  std::vector<uint8_t> body;
+  for (const auto& e : elements) append_len_prefixed(body, e);
+  std::vector<uint8_t> out;
+  append_len_prefixed(out, body);
+  return out;
+}
+
+// Sequence of (uint32 sig_algo_id, length prefixed bytes) records.
+std::vector<uint8_t> encode_algo_seq(const std::vector<std::pair<uint32_t, std::vector<uint8_t>>>& records) {
+  std::vector<std::vector<uint8_t>> elements;
+  for (const auto& [id, bytes] : records) {
+    auto& e = elements.emplace_back();
+    append_le(e, id);
+    append_len_prefixed(e, bytes);
+  }
+  return encode_seq(elements);
+}
+
+std::vector<uint32_t> sig_algo_ids_of(const apksig::signing_key& key, const apksig::sign_options& opts) {
+  if (!opts.sig_algo_ids.empty()) return opts.sig_algo_ids;
+  return {key.default_sig_algo_id()};
+}
+
+bool any_verity(const std::vector<uint32_t>& sig_algo_ids) {
+  return std::any_of(sig_algo_ids.cbegin(), sig_algo_ids.cend(), [](uint32_t id) {
+    return apksig::content_digest_algo_of(id) == apksig::content_digest_algo::verity_chunked_sha256;
+  });
+}
+
+// Everything but the signed data is the same in v2 and v3 signers: the signed data, then (v3
+// only) the SDK range, the signatures over the signed data, and the public key.
+std::vector<uint8_t> encode_signer(const std::vector<uint8_t>& signed_data, const std::vector<uint8_t>& sdk_range,
+                                   const std::vector<uint32_t>& sig_algo_ids, const apksig::signing_key& key) {
+  std::vector<std::pair<uint32_t, std::vector<uint8_t>>> signatures;
+  for (const auto id : sig_algo_ids) signatures.emplace_back(id, key.sign(id, signed_data.data(), signed_data.size()));
+
+  std::vector<uint8_t> signer;
+  append_len_prefixed(signer, signed_data);
+  append_bytes(signer, sdk_range);
+  append_bytes(signer, encode_algo_seq(signatures));
+  append_len_prefixed(signer, key.public_key());
+  return signer;
+}
+
+std::vector<apksig::content_digest_algo> content_algos_of(const std::vector<uint32_t>& sig_algo_ids) {
+  std::vector<apksig::content_digest_algo> algos;
+  for (const auto id : sig_algo_ids) {
+    const auto algo = apksig::content_digest_algo_of(id);
+    if (!algo) throw std::invalid_argument("Unsupported signature algorithm " + std::to_string(id));
+    if (std::find(algos.cbegin(), algos.cend(), *algo) == algos.cend()) algos.push_back(*algo);
+  }
+  return algos;
+}
+
+// Sections of the input as it will be signed: without its old signing block, if any, whose place
+// the new one takes.
+apksig::apk_sections unsigned_sections(const std::filesystem::path& input, const std::filesystem::path& output) {
+  if (std::filesystem::exists(output) && std::filesystem::equivalent(input, output)) {
+    throw std::invalid_argument("Cannot sign an APK in place");
+  }
+  apksig::siginfo info{input};
+  const auto status = info.try_parse();
+  if (!status && status.code != apksig::parse_errc::no_signing_block) {
+    throw apksig::parse_error(std::string(status.message()) + " at offset " + std::to_string(status.offset));
+  }
+  auto sections = info.get_sections();
+  if (!status) sections.signing_block_offset = sections.cd_offset;
+  return sections;
+}
+
+uint32_t zip32_offset(uint64_t offset) {
+  if (offset > std::numeric_limits<uint32_t>::max()) {
+    throw std::runtime_error("Signed APK would need ZIP64, which is not supported");
+  }
+  return static_cast<uint32_t>(offset);
+}
+
+std::vector<uint8_t> read_range(std::istream& is, uint64_t offset, uint64_t size) {
+  is.seekg(static_cast<std::streamoff>(offset));
+  return apksig::detail::read_into_vector(is, static_cast<size_t>(size));
+}
+
+// Writes the ZIP entries section while computing its chunked content digests. Chunks are batched,
+// one per thread, and each batch is hashed across threads before it is written out.
+class hashing_writer {
+ public:
+  hashing_writer(std::ostream& os, const std::vector<apksig::content_digest_algo>& algos, unsigned threads)
+      : os_(os), threads_(apksig::detail::resolve_threads(threads)), batch_limit_(threads_ * chunk_size) {
+    for (const auto algo : algos) digesters_.emplace_back(algo);
+    batch_.reserve(batch_limit_);
+  }
+
+  void write(const uint8_t* p, size_t n) {
+    while (n > 0) {
+      const auto take = std::min(n, batch_limit_ - batch_.size());
+      batch_.insert(batch_.end(), p, p + take);
+      p += take;
+      n -= take;
+      if (batch_.size() == batch_limit_) flush();
+    }
+  }
+
+  uint64_t position() const noexcept { return written_ + batch_.size(); }
+
+  // Hashes and writes what is left. The digesters then take the remaining sections.
+  std::vector<apksig::chunked_digester> finish() {
+    flush();
+    return std::move(digesters_);
+  }
+
+ private:
+  static constexpr size_t chunk_size = apksig::chunked_digester::chunk_size;
+
+  void flush() {
+    if (batch_.empty()) return;
+    const auto chunks = (batch_.size() + chunk_size - 1) / chunk_size;
+    std::vector<std::vector<uint8_t>> chunk_digests;
+    for (const auto& d : digesters_) chunk_digests.emplace_back(chunks * apksig::digest_size(d.algo()));
+    apksig::detail::parallel_for(chunks, threads_, [&](size_t begin, size_t end) {
+      for (size_t c = begin; c < end; c++) {
+        const auto size = std::min(chunk_size, batch_.size() - c * chunk_size);
+        for (size_t a = 0; a < digesters_.size(); a++) {
+          const auto algo = digesters_[a].algo();
+          apksig::chunked_digester::digest_chunk(algo, batch_.data() + c * chunk_size, size,
+                                                 chunk_digests[a].data() + c * apksig::digest_size(algo));
+        }
+      }
+    });
+    for (size_t a = 0; a < digesters_.size(); a++) {
+      digesters_[a].add_chunk_digests(chunk_digests[a].data(), static_cast<uint32_t>(chunks));
+    }
+    apksig::detail::write_bytes(os_, batch_);
+    written_ += batch_.size();
+    batch_.clear();
+  }
+
+  std::ostream& os_;
+  unsigned threads_;
+  // Whole chunks only, so every chunk but the section's last is full. capacity() may be larger.
+  size_t batch_limit_;
+  std::vector<apksig::chunked_digester> digesters_;
+  std::vector<uint8_t> batch_;
+  uint64_t written_ = 0;
+};
+
+template <class Sink>
+void copy_range(std::istream& is, Sink& out, uint64_t offset, uint64_t size) {
+  std::vector<char> buf(static_cast<size_t>(std::min<uint64_t>(size, apksig::chunked_digester::chunk_size)));
+  is.seekg(static_cast<std::streamoff>(offset));
+  while (size > 0) {
+    const auto n = static_cast<std::streamsize>(std::min<uint64_t>(size, buf.size()));
+    is.read(buf.data(), n);
+    if constexpr (std::is_base_of_v<std::ostream, Sink>) {
+      out.write(buf.data(), n);
+    } else {
+      out.write(reinterpret_cast<const uint8_t*>(buf.data()), static_cast<size_t>(n));
+    }
+    size -= static_cast<uint64_t>(n);
+  }
+}
+
+// Replaces the alignment record of a local header extra field with one whose padding puts the
+// entry data, which starts at data_offset plus the extra field, at a multiple of alignment. The
+// record is the one the reference implementation writes: ID 0xd935, the uint16 alignment, zeros.
+void align_extra_field(std::vector<uint8_t>& extra, uint64_t data_offset, uint32_t alignment) {
+  using apksig::detail::le_to_host;
+
+  std::vector<uint8_t> kept;
+  size_t pos = 0;
+  while (pos + 4 <= extra.size()) {
+    const auto id = le_to_host<uint16_t>(extra.data() + pos);
+    const size_t end = pos + 4 + le_to_host<uint16_t>(extra.data() + pos + 2);
+    if (end > extra.size()) break;
+    if (id != alignment_extra_id) {
+      kept.insert(kept.end(), extra.cbegin() + static_cast<std::ptrdiff_t>(pos),
+                  extra.cbegin() + static_cast<std::ptrdiff_t>(end));
+    }
+    pos = end;
+  }
+  // Bytes that aren't a well-formed record, e.g. the zero padding of older tools, stay as they are.
+  kept.insert(kept.end(), extra.cbegin() + static_cast<std::ptrdiff_t>(pos), extra.cend());
+  extra = std::move(kept);
+
+  if (alignment <= 1) return;
+  const auto padding = (alignment - (data_offset + extra.size() + alignment_record_min_size) % alignment) % alignment;
+  if (extra.size() + alignment_record_min_size + padding > std::numeric_limits<uint16_t>::max()) {
+    throw std::runtime_error("Extra field too large to align the entry");
+  }
+  append_le(extra, alignment_extra_id);
+  append_le(extra, static_cast<uint16_t>(2 + padding));
+  append_le(extra, static_cast<uint16_t>(std::min<uint32_t>(alignment, std::numeric_limits<uint16_t>::max())));
+  extra.resize(extra.size() + padding);
+}
+
+}  // namespace
+
+namespace apksig {
+
+std::vector<uint8_t> encode_signing_block(const std::vector<signing_block_pair>& pairs, bool verity_padding) {
+  using namespace detail;
+
+  std::vector<uint8_t> body;
+  for (const auto& p : pairs) {
+    append_le(body, static_cast<uint64_t>(sizeof(p.id) + p.value.size()));
+    append_le(body, p.id);
+    append_bytes(body, p.value);
+  }
+  if (verity_padding) {
+    const auto unpadded = 8 + body.size() + signing_block_footer_size;
+    if (unpadded % page_size != 0) {
+      // The padding pair itself takes 12 bytes of header.
+      auto padding = page_size - unpadded % page_size;
+      if (padding < 12) padding += page_size;
+      append_le(body, static_cast<uint64_t>(padding - 8));
+      append_le(body, verity_padding_block_id);
+      body.resize(body.size() + padding - 12);
+    }
+  }
+
+  // Both size fields count everything but the leading one.
+  const auto size = static_cast<uint64_t>(body.size() + signing_block_footer_size);
+  std::vector<uint8_t> out;
+  out.reserve(8 + size);
+  append_le(out, size);
+  append_bytes(out, body);
+  append_le(out, size);
+  out.insert(out.end(), signing_block_magic.cbegin(), signing_block_magic.cend());
+  return out;
+}
+
+std::vector<signing_block_pair> make_signature_pairs(const std::vector<content_digest>& digests,
+                                                     const signing_key& key, const sign_options& opts) {
+  if (key.certificates().empty()) throw std::runtime_error("Signing key has no certificate");
+
+  const auto sig_algo_ids = sig_algo_ids_of(key, opts);
+  std::vector<std::pair<uint32_t, std::vector<uint8_t>>> digest_records;
+  for (const auto id : sig_algo_ids) {
+    const auto algo = content_digest_algo_of(id);
+    const auto d = std::find_if(digests.cbegin(), digests.cend(), [&](const auto& c) { return algo && c.algo == *algo; });
+    if (d == digests.cend()) {
+      throw std::invalid_argument("No content digest for signature algorithm " + std::to_string(id));
+    }
+    digest_records.emplace_back(id, d->digest_data);
+  }
+  const auto encoded_digests = encode_algo_seq(digest_records);
+  const auto encoded_certs = encode_seq(key.certificates());
+
+  std::vector<signing_block_pair> pairs;
+  if (opts.v2) {
+    std::vector<std::vector<uint8_t>> attrs;
+    if (opts.v3) {
+      auto& attr = attrs.emplace_back();
+      append_le(attr, stripping_protection_attr_id);
+      append_le(attr, v3_scheme_id);
+    }
+    std::vector<uint8_t> signed_data;
+    append_bytes(signed_data, encoded_digests);
+    append_bytes(signed_data, encoded_certs);
+    append_bytes(signed_data, encode_seq(attrs));
+    // The reference implementation ends v2 signed data with an empty element.
+    append_le(signed_data, uint32_t{0});
+    pairs.push_back({detail::v2_block_id, encode_seq({encode_signer(signed_data, {}, sig_algo_ids, key)})});
+  }
+  if (opts.v3) {
+    std::vector<uint8_t> sdk_range;
+    append_le(sdk_range, opts.min_sdk);
+    append_le(sdk_range, opts.max_sdk);
+    std::vector<uint8_t> signed_data;
+    append_bytes(signed_data, encoded_digests);
+    append_bytes(signed_data, encoded_certs);
+    append_bytes(signed_data, sdk_range);
+    append_le(signed_data, uint32_t{0});  // no additional attributes
+    pairs.push_back({detail::v3_block_id, encode_seq({encode_signer(signed_data, sdk_range, sig_algo_ids, key)})});
+  }
+  return pairs;
+}
+
+void sign_apk(const std::filesystem::path& input_apk_path, const std::filesystem::path& output_apk_path,
+              const signing_key& key, const sign_options& opts) {
+  const auto sections = unsigned_sections(input_apk_path, output_apk_path);
+  const auto sig_algo_ids = sig_algo_ids_of(key, opts);
+  content_digest_options digest_opts;
+  digest_opts.algos = content_algos_of(sig_algo_ids);
+  digest_opts.threads = opts.threads;
+  const auto digest_set = compute_content_digests(input_apk_path, sections, digest_opts);
+
+  auto pairs = make_signature_pairs(digest_set.digests, key, opts);
+  pairs.insert(pairs.end(), opts.extra_pairs.cbegin(), opts.extra_pairs.cend());
+  const auto block = encode_signing_block(pairs, any_verity(sig_algo_ids));
+  const auto new_cd_offset = zip32_offset(sections.signing_block_offset + block.size());
+
+  std::ifstream ifs(input_apk_path, std::ios_base::in | std::ios_base::binary);
+  ifs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+  std::ofstream ofs(output_apk_path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+  ofs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+
+  copy_range(ifs, ofs, 0, sections.signing_block_offset);
+  detail::write_bytes(ofs, block);
+  copy_range(ifs, ofs, sections.cd_offset, sections.eocd_offset - sections.cd_offset);
+  auto eocd = read_range(ifs, sections.eocd_offset, sections.file_size - sections.eocd_offset);
+  detail::patch_eocd_cd_offset(eocd.data(), new_cd_offset);
+  detail::write_bytes(ofs, eocd);
+}
+
+void align_and_sign(const std::filesystem::path& input_apk_path, const std::filesystem::path& output_apk_path,
+                    const signing_key& key, const sign_options& sign_opts, const align_options& align_opts) {
+  using namespace detail;
+
+  const auto sections = unsigned_sections(input_apk_path, output_apk_path);
+  const auto sig_algo_ids = sig_algo_ids_of(key, sign_opts);
+  if (any_verity(sig_algo_ids)) {
+    throw std::invalid_argument("Verity signatures need the final layout up front, use sign_apk() after aligning");
+  }
+  if (align_opts.alignment == 0) throw std::invalid_argument("Alignment must not be 0");
+
+  std::ifstream ifs(input_apk_path, std::ios_base::in | std::ios_base::binary);
+  ifs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+  auto cd = read_range(ifs, sections.cd_offset, sections.eocd_offset - sections.cd_offset);
+  auto eocd = read_range(ifs, sections.eocd_offset, sections.file_size - sections.eocd_offset);
+
+  // Entries are copied in file order, each from its local header up to the next one, which takes
+  // data descriptors along.
+  struct entry_record {
+    size_t cd_pos;
+    uint64_t offset;
+    uint64_t end;
+    bool stored;
+    bool native_library;
+  };
+  std::vector<entry_record> entries;
+  for (size_t pos = 0; pos + cd_entry_size <= cd.size();) {
+    const auto* e = cd.data() + pos;
+    if (le_to_host<uint32_t>(e) != cd_entry_magic) throw parse_error("Bad central directory entry magic");
+    const auto name_len = le_to_host<uint16_t>(e + cd_entry_name_len_offset);
+    const size_t entry_len = cd_entry_size + name_len + le_to_host<uint16_t>(e + cd_entry_extra_len_offset) +
+                             le_to_host<uint16_t>(e + cd_entry_comment_len_offset);
+    if (pos + entry_len > cd.size()) throw parse_error("Central directory entry runs past the directory");
+    const auto offset = le_to_host<uint32_t>(e + cd_entry_local_header_offset);
+    if (offset == zip64_marker) throw parse_error("ZIP64 archives are not supported");
+    const std::string_view name(reinterpret_cast<const char*>(e + cd_entry_size), name_len);
+    const bool native_library = name.size() > 3 && name.substr(name.size() - 3) == ".so";
+    entries.push_back({pos, offset, 0, le_to_host<uint16_t>(e + cd_entry_method_offset) == method_stored, native_library});
+    pos += entry_len;
+  }
+  std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) { return a.offset < b.offset; });
+  for (size_t i = 0; i < entries.size(); i++) {
+    entries[i].end = i + 1 < entries.size() ? entries[i + 1].offset : sections.signing_block_offset;
+    if (entries[i].end <= entries[i].offset) throw parse_error("Overlapping ZIP entries");
+  }
+
+  std::ofstream ofs(output_apk_path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+  ofs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+  hashing_writer writer(ofs, content_algos_of(sig_algo_ids), sign_opts.threads);
+  copy_range(ifs, writer, 0, entries.empty() ? sections.signing_block_offset : entries.front().offset);
+  for (const auto& entry : entries) {
+    const auto header_end = std::min<uint64_t>(entry.end, entry.offset + local_header_size);
+    auto header = read_range(ifs, entry.offset, header_end - entry.offset);
+    if (header.size() < local_header_size || le_to_host<uint32_t>(header.data()) != local_header_magic) {
+      throw parse_error("Bad local header magic");
+    }
+    const auto name_len = le_to_host<uint16_t>(header.data() + local_header_name_len_offset);
+    const auto extra_len = le_to_host<uint16_t>(header.data() + local_header_extra_len_offset);
+    if (entry.offset + local_header_size + name_len + extra_len > entry.end) {
+      throw parse_error("Local header runs past the entry");
+    }
+    auto name_and_extra = read_range(ifs, entry.offset + local_header_size, name_len + size_t{extra_len});
+    std::vector<uint8_t> extra(name_and_extra.cbegin() + name_len, name_and_extra.cend());
+    name_and_extra.resize(name_len);
+
+    const auto new_offset = writer.position();
+    if (entry.stored) {
+      const auto alignment = entry.native_library && align_opts.native_library_alignment != 0
+                                 ? align_opts.native_library_alignment
+                                 : align_opts.alignment;
+      align_extra_field(extra, new_offset + local_header_size + name_len, alignment);
+    }
+    store_le(header.data() + local_header_extra_len_offset, static_cast<uint16_t>(extra.size()));
+    store_le(cd.data() + entry.cd_pos + cd_entry_local_header_offset, zip32_offset(new_offset));
+
+    writer.write(header.data(), header.size());
+    writer.write(name_and_extra.data(), name_and_extra.size());
+    writer.write(extra.data(), extra.size());
+    const auto data_offset = entry.offset + local_header_size + name_len + extra_len;
+    copy_range(ifs, writer, data_offset, entry.end - data_offset);
+  }
+
+  // The content digests see the EOCD record pointing at the signing block.
+  const auto signing_block_offset = writer.position();
+  patch_eocd_cd_offset(eocd.data(), zip32_offset(signing_block_offset));
+  auto digesters = writer.finish();
+  std::vector<content_digest> digests;
+  for (auto& d : digesters) {
+    d.add_section(cd.data(), cd.size());
+    d.add_section(eocd.data(), eocd.size());
+    digests.push_back({d.algo(), d.finish()});
+  }
+
+  auto pairs = make_signature_pairs(digests, key, sign_opts);
+  pairs.insert(pairs.end(), sign_opts.extra_pairs.cbegin(), sign_opts.extra_pairs.cend());
+  const auto block = encode_signing_block(pairs, false);
+  patch_eocd_cd_offset(eocd.data(), zip32_offset(signing_block_offset + block.size()));
+  write_bytes(ofs, block);
+  write_bytes(ofs, cd);
+  write_bytes(ofs, eocd);
+}
+
+}  // namespace apksig
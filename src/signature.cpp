@@ -0,0 +1,200 @@
+#include "apksig/signature.hpp"
+
+#include <mbedtls/pk.h>
+#include <mbedtls/sha256.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include "parallel.hpp"
+#include "sha.hpp"
+#include "sig_algo.hpp"
+#include "trace.hpp"
+
+namespace {
+
+using key_digest = std::array<uint8_t, 32>;
+
+struct key_digest_hash {
+  size_t operator()(const key_digest& d) const noexcept {
+    size_t h;
+    std::memcpy(&h, d.data(), sizeof(h));
+    return h;
+  }
+};
+
+key_digest digest_of(const apksig::public_key& key) {
+  key_digest d;
+  mbedtls_sha256(key.data(), key.size(), d.data(), 0);
+  return d;
+}
+
+struct key_entry {
+  key_digest digest;
+  mbedtls_pk_context pk;
+  // mbedtls caches Montgomery constants in the key on first use, so a key is never used by two
+  // threads at once.
+  std::mutex mutex;
+
+  key_entry() { mbedtls_pk_init(&pk); }
+  key_entry(const key_entry&) = delete;
+  key_entry& operator=(const key_entry&) = delete;
+  ~key_entry() { mbedtls_pk_free(&pk); }
+};
+
+// Caller holds entry.mutex.
+apksig::signature_status check(key_entry& entry, const apksig::signature_request& req) {
+  using apksig::signature_status;
+  using apksig::detail::sig_scheme;
+
+  const apksig::detail::scoped_trace trace(apksig::trace_phase::signature_verify, req.size);
+  const auto algo = apksig::detail::sig_algo_info_of(req.sig_algo_id);
+  if (!algo || algo->scheme == sig_scheme::dsa) return signature_status::unsupported_algorithm;
+
+  const auto key_type = mbedtls_pk_get_type(&entry.pk);
+  const auto is_rsa = key_type == MBEDTLS_PK_RSA;
+  const auto is_ec = key_type == MBEDTLS_PK_ECKEY || key_type == MBEDTLS_PK_ECDSA;
+  if (algo->scheme == sig_scheme::ecdsa ? !is_ec : !is_rsa) return signature_status::invalid;
+
+  std::array<uint8_t, 64> hash;
+  const auto hash_size = apksig::detail::sha_size(algo->md);
+  apksig::detail::sha_context ctx(algo->md);
+  ctx.update(req.data, req.size);
+  ctx.finish(hash.data());
+
+  const auto md = apksig::detail::md_type_of(algo->md);
+  const auto& sig = *req.signature;
+  int ret;
+  if (algo->scheme == sig_scheme::rsa_pss) {
+    // APK signatures use MGF1 with the content digest and a salt as long as the digest.
+    mbedtls_pk_rsassa_pss_options pss{md, static_cast<int>(hash_size)};
+    ret = mbedtls_pk_verify_ext(MBEDTLS_PK_RSASSA_PSS, &pss, &entry.pk, md, hash.data(), hash_size, sig.data(),
+                                sig.size());
+  } else {
+    // RSA keys parse with PKCS#1 v1.5 padding, which pk_verify then uses.
+    ret = mbedtls_pk_verify(&entry.pk, md, hash.data(), hash_size, sig.data(), sig.size());
+  }
+  return ret == 0 ? signature_status::valid : signature_status::invalid;
+}
+
+}  // namespace
+
+namespace apksig {
+
+struct signature_verifier::impl {
+  size_t capacity;
+  mutable std::mutex mutex;
+  // Most recently used first.
+  std::list<std::shared_ptr<key_entry>> lru;
+  std::unordered_map<key_digest, std::list<std::shared_ptr<key_entry>>::iterator, key_digest_hash> index;
+  std::atomic<size_t> key_setups{0};
+
+  explicit impl(size_t cap) : capacity(std::max<size_t>(cap, 1)) {}
+
+  std::shared_ptr<key_entry> find(const key_digest& digest) {
+    std::lock_guard lock(mutex);
+    const auto it = index.find(digest);
+    if (it == index.end()) return nullptr;
+    lru.splice(lru.begin(), lru, it->second);
+    return *it->second;
+  }
+
+  // Returns nullptr if the key does not parse. Parsing happens outside the lock; if two threads
+  // race on the same new key, the first one inserted wins.
+  std::shared_ptr<key_entry> acquire(const public_key& key, const key_digest& digest) {
+    if (auto entry = find(digest)) return entry;
+
+    auto entry = std::make_shared<key_entry>();
+    entry->digest = digest;
+    if (mbedtls_pk_parse_public_key(&entry->pk, key.data(), key.size()) != 0) return nullptr;
+    key_setups++;
+
+    std::lock_guard lock(mutex);
+    if (const auto it = index.find(digest); it != index.end()) {
+      lru.splice(lru.begin(), lru, it->second);
+      return *it->second;
+    }
+    lru.push_front(entry);
+    index.emplace(digest, lru.begin());
+    while (lru.size() > capacity) {
+      index.erase(lru.back()->digest);
+      lru.pop_back();
+    }
+    return entry;
+  }
+};
+
+signature_verifier::signature_verifier(size_t capacity) : impl_(std::make_unique<impl>(capacity)) {}
+
+signature_verifier::~signature_verifier() = default;
+
+signature_status signature_verifier::verify(const signature_request& request) {
+  const auto entry = impl_->acquire(*request.public_key, digest_of(*request.public_key));
+  if (!entry) return signature_status::bad_public_key;
+  std::lock_guard lock(entry->mutex);
+  return check(*entry, request);
+}
+
+std::vector<signature_status> signature_verifier::verify_batch(const std::vector<signature_request>& requests,
+                                                               unsigned threads) {
+  struct group {
+    key_digest digest;
+    std::vector<size_t> members;
+  };
+  std::vector<group> groups;
+  std::unordered_map<key_digest, size_t, key_digest_hash> group_of;
+  for (size_t i = 0; i < requests.size(); i++) {
+    const auto digest = digest_of(*requests[i].public_key);
+    const auto [it, inserted] = group_of.emplace(digest, groups.size());
+    if (inserted) groups.push_back({digest, {}});
+    groups[it->second].members.push_back(i);
+  }
+
+  std::vector<signature_status> results(requests.size());
+  detail::parallel_for(groups.size(), threads, [&](size_t begin, size_t end) {
+    for (size_t g = begin; g < end; g++) {
+      const auto& members = groups[g].members;
+      const auto entry = impl_->acquire(*requests[members.front()].public_key, groups[g].digest);
+      if (!entry) {
+        for (const auto i : members) results[i] = signature_status::bad_public_key;
+        continue;
+      }
+      std::lock_guard lock(entry->mutex);
+      for (const auto i : members) results[i] = check(*entry, requests[i]);
+    }
+  });
+  return results;
+}
+
+size_t signature_verifier::cached_keys() const {
+  std::lock_guard lock(impl_->mutex);
+  return impl_->lru.size();
+}
+
+size_t signature_verifier::key_setups() const noexcept { return impl_->key_setups; }
+
+namespace {
+
+template <class Signer>
+std::vector<signature_request> requests_of(const Signer& signer) {
+  std::vector<signature_request> requests;
+  requests.reserve(signer.signatures.size());
+  for (const auto& sig : signer.signatures) {
+    requests.push_back({&signer.public_key, sig.sig_algo_id, signer.signed_data_bytes.data(),
+                        signer.signed_data_bytes.size(), &sig.signature_data});
+  }
+  return requests;
+}
+
+}  // namespace
+
+std::vector<signature_request> signature_requests(const v2_signer& signer) { return requests_of(signer); }
+
+std::vector<signature_request> signature_requests(const v3_signer& signer) { return requests_of(signer); }
+
+}  // namespace apksig
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "apksig/apksig.hpp"
+#include "read_utils.hpp"
+
+namespace apksig::detail {
+
+// The APK Signing Block ends with its size (excluding this field) and this magic, right before
+// the central directory.
+constexpr std::string_view signing_block_magic{"APK Sig Block 42"};
+constexpr size_t signing_block_footer_size = 8 + 16;
+// Smallest possible block: the leading size, no pairs, and the footer.
+constexpr size_t signing_block_min_size = 8 + signing_block_footer_size;
+// Pair length, then ID.
+constexpr size_t pair_header_size = 8 + 4;
+
+constexpr uint32_t v2_block_id = 0x7109871a;
+constexpr uint32_t v3_block_id = 0xf05368c0;
+constexpr uint32_t v3_1_block_id = 0x1b93ad61;
+constexpr uint32_t source_stamp_block_id = 0x6dff800d;
+// Zero filled pair that brings the block to a multiple of 4 KiB, keeping the central directory
+// page aligned for verity.
+constexpr uint32_t verity_padding_block_id = 0x42726577;
+
+// Checks the footer read from the signing_block_footer_size bytes before the central directory at
+// cd_offset, and on success sets block_offset to where the block starts.
+inline parse_status check_signing_block_footer(const uint8_t* footer, uint64_t cd_offset,
+                                               uint64_t& block_offset) noexcept {
+  const auto footer_offset = cd_offset - signing_block_footer_size;
+  if (!std::equal(signing_block_magic.cbegin(), signing_block_magic.cend(), footer + 8)) {
+    return {parse_errc::no_signing_block, footer_offset + 8};
+  }
+  const auto block_size = le_to_host<uint64_t>(footer);
+  if (block_size < signing_block_footer_size || block_size > cd_offset - 8) {
+    return {parse_errc::bad_signing_block_size, footer_offset};
+  }
+  block_offset = cd_offset - block_size - 8;
+  return {};
+}
+
+// Checks that the block starting at block_offset, whose footer is at footer_offset, repeats the
+// footer's size up front, then walks its ID-value pairs. read(pos, out, n) fetches the n bytes at
+// pos and returns false if it can't; visit(id, value_offset, value_size) is called for each pair in
+// block order.
+template <class Read, class Visit>
+parse_status walk_pairs(uint64_t block_offset, const uint8_t* footer, uint64_t footer_offset, Read read, Visit visit) {
+  std::array<uint8_t, 8> leading_size;
+  if (!read(block_offset, leading_size.data(), leading_size.size())) return {parse_errc::io_error, block_offset};
+  if (le_to_host<uint64_t>(leading_size.data()) != le_to_host<uint64_t>(footer)) {
+    return {parse_errc::bad_signing_block_size, block_offset};
+  }
+
+  for (auto pos = block_offset + 8; pos < footer_offset;) {
+    std::array<uint8_t, pair_header_size> header;
+    if (footer_offset - pos < header.size()) return {parse_errc::bad_id_value_pair, pos};
+    if (!read(pos, header.data(), header.size())) return {parse_errc::io_error, pos};
+    const auto pair_len = le_to_host<uint64_t>(header.data());
+    const auto id = le_to_host<uint32_t>(header.data() + 8);
+    if (pair_len < sizeof(id) || pair_len > footer_offset - pos - 8) return {parse_errc::bad_id_value_pair, pos};
+    visit(id, pos + header.size(), pair_len - sizeof(id));
+    pos += 8 + pair_len;
+  }
+  return {};
+}
+
+}  // namespace apksig::detail
@@ -0,0 +1,125 @@
+#include "apksig/source_stamp.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "apksig/cert_cache.hpp"
+#include "write_utils.hpp"
+
+namespace {
+
+constexpr uint32_t scheme_v2 = 2;
+constexpr uint32_t scheme_v3 = 3;
+
+template <class SignedData>
+std::vector<apksig::content_digest> content_digests(const SignedData& signed_data) {
+  std::vector<apksig::content_digest> out;
+  for (const auto& d : signed_data.digests) {
+    const auto algo = apksig::content_digest_algo_of(d.sig_algo_id);
+    if (!algo) continue;
+    // Several signature algorithms can share a content digest.
+    if (std::none_of(out.cbegin(), out.cend(), [&](const auto& c) { return c.algo == *algo; })) {
+      out.push_back({*algo, d.digest_data});
+    }
+  }
+  return out;
+}
+
+// What the stamp signs for a scheme: its digests ordered by algorithm ID, each as a
+// length-prefixed (algorithm ID, length-prefixed digest) pair.
+std::vector<uint8_t> encode_digests(std::vector<apksig::content_digest> digests) {
+  using apksig::detail::append_le;
+  using apksig::detail::append_len_prefixed;
+
+  std::sort(digests.begin(), digests.end(), [](const auto& a, const auto& b) { return a.algo < b.algo; });
+  std::vector<uint8_t> out;
+  for (const auto& d : digests) {
+    append_le(out, static_cast<uint32_t>(8 + d.digest_data.size()));
+    append_le(out, static_cast<uint32_t>(d.algo));
+    append_len_prefixed(out, d.digest_data);
+  }
+  return out;
+}
+
+// At least one signature with a supported algorithm, and every such signature valid.
+bool signatures_verify(apksig::signature_verifier& verifier, const apksig::public_key& key,
+                       const std::vector<apksig::signature>& signatures, const std::vector<uint8_t>& data) {
+  std::vector<apksig::signature_request> requests;
+  for (const auto& s : signatures) {
+    requests.push_back({&key, s.sig_algo_id, data.data(), data.size(), &s.signature_data});
+  }
+  bool any = false;
+  for (const auto status : verifier.verify_batch(requests)) {
+    if (status == apksig::signature_status::unsupported_algorithm) continue;
+    if (status != apksig::signature_status::valid) return false;
+    any = true;
+  }
+  return any;
+}
+
+}  // namespace
+
+namespace apksig {
+
+std::vector<stamp_scheme_digests> stamp_digests(const siginfo& info) {
+  std::vector<stamp_scheme_digests> out;
+  if (info.has_v2_block() && !info.get_v2_block().signers.empty()) {
+    out.push_back({scheme_v2, content_digests(info.get_v2_block().signers.front().signed_data)});
+  }
+  if (info.has_v3_block() && !info.get_v3_block().signers.empty()) {
+    out.push_back({scheme_v3, content_digests(info.get_v3_block().signers.front().signed_data)});
+  }
+  return out;
+}
+
+source_stamp_result verify_source_stamp(const source_stamp& stamp, const std::vector<stamp_scheme_digests>& schemes,
+                                        signature_verifier* verifier) {
+  source_stamp_result result;
+  std::optional<signature_verifier> own_verifier;
+  if (verifier == nullptr) verifier = &own_verifier.emplace(1);
+
+  const auto cert = intern_certificate(stamp.stamp_certificate);
+  result.certificate_sha256 = cert->sha256();
+  if (!cert->has_x509()) {
+    result.error = "Stamp certificate does not parse";
+    return result;
+  }
+
+  if (schemes.empty()) {
+    result.error = "No scheme digests to check the stamp against";
+    return result;
+  }
+  for (const auto& scheme : schemes) {
+    const auto it = std::find_if(stamp.signed_digests.cbegin(), stamp.signed_digests.cend(),
+                                 [&](const auto& d) { return d.scheme_id == scheme.scheme_id; });
+    if (it == stamp.signed_digests.cend()) {
+      result.error = "Stamp has no signature for scheme " + std::to_string(scheme.scheme_id);
+      return result;
+    }
+    if (!signatures_verify(*verifier, cert->public_key(), it->signatures, encode_digests(scheme.digests))) {
+      result.error = "Stamp signature over the scheme " + std::to_string(scheme.scheme_id) + " digests does not verify";
+      return result;
+    }
+  }
+  if (!signatures_verify(*verifier, cert->public_key(), stamp.stamp_attribute_signatures,
+                         stamp.signed_stamp_attributes)) {
+    result.error = "Stamp attribute signature does not verify";
+    return result;
+  }
+  result.verified = true;
+  return result;
+}
+
+source_stamp_result verify_source_stamp(const siginfo& info, signature_verifier* verifier) {
+  if (!info.has_source_stamp()) {
+    source_stamp_result result;
+    result.error = "No source stamp";
+    return result;
+  }
+  return verify_source_stamp(info.get_source_stamp(), stamp_digests(info), verifier);
+}
+
+}  // namespace apksig
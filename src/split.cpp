@@ -0,0 +1,252 @@
+#include "apksig/split.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "apksig/cert_cache.hpp"
+#include "parallel.hpp"
+#include "read_utils.hpp"
+
+namespace {
+
+using apksig::detail::le_to_host;
+
+constexpr uint32_t proof_of_rotation_attr_id = 0x3ba06f8c;
+constexpr uint32_t lineage_version = 1;
+
+// Bounds checked reads over an attribute value.
+class byte_cursor {
+ public:
+  byte_cursor(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+  const uint8_t* data() const noexcept { return data_; }
+  size_t size() const noexcept { return size_; }
+
+  uint32_t u32() { return le_to_host<uint32_t>(take(sizeof(uint32_t))); }
+
+  byte_cursor len_prefixed() {
+    const auto n = u32();
+    return {take(n), n};
+  }
+
+ private:
+  const uint8_t* take(size_t n) {
+    if (n > size_) throw apksig::parse_error("Truncated proof-of-rotation lineage");
+    const auto* p = data_;
+    data_ += n;
+    size_ -= n;
+    return p;
+  }
+
+  const uint8_t* data_;
+  size_t size_;
+};
+
+struct rotation_node {
+  std::shared_ptr<const apksig::interned_certificate> cert;
+  uint32_t flags;
+  // The certificate and sig_algo_id as encoded, which the previous node's key signs.
+  byte_cursor signed_data;
+  uint32_t sig_algo_id;
+  std::vector<uint8_t> signature;
+};
+
+// Decodes a proof-of-rotation attribute: a version, then one length-prefixed node per certificate,
+// oldest first. The nodes point into value.
+std::vector<rotation_node> parse_lineage(const std::vector<uint8_t>& value) {
+  byte_cursor in(value.data(), value.size());
+  if (in.u32() != lineage_version) throw apksig::parse_error("Unsupported proof-of-rotation lineage version");
+
+  std::vector<rotation_node> nodes;
+  uint32_t prev_sig_algo_id = 0;
+  while (in.size() > 0) {
+    auto node = in.len_prefixed();
+    const auto signed_data = node.len_prefixed();
+    const auto flags = node.u32();
+    const auto sig_algo_id = node.u32();
+    const auto sig = node.len_prefixed();
+
+    auto fields = signed_data;
+    const auto der = fields.len_prefixed();
+    const auto signed_sig_algo_id = fields.u32();
+    if (!nodes.empty() && signed_sig_algo_id != prev_sig_algo_id) {
+      throw apksig::parse_error("Proof-of-rotation signature algorithm mismatch");
+    }
+    auto cert = apksig::intern_certificate(apksig::certificate(der.data(), der.data() + der.size()));
+    if (std::any_of(nodes.cbegin(), nodes.cend(), [&](const auto& n) { return n.cert == cert; })) {
+      throw apksig::parse_error("Duplicate certificate in proof-of-rotation lineage");
+    }
+    prev_sig_algo_id = sig_algo_id;
+    nodes.push_back({std::move(cert), flags, signed_data, signed_sig_algo_id,
+                     std::vector<uint8_t>(sig.data(), sig.data() + sig.size())});
+  }
+  return nodes;
+}
+
+// The signer of a v3 or v3.1 block whose SDK range covers sdk_version, or nullptr.
+const apksig::v3_signer* signer_for_sdk(const apksig::v3_block& block, uint32_t sdk_version) {
+  const apksig::v3_signer* found = nullptr;
+  for (const auto& signer : block.signers) {
+    if (signer.min_sdk > sdk_version || signer.max_sdk < sdk_version) continue;
+    if (found != nullptr) throw apksig::parse_error("Several signers cover SDK " + std::to_string(sdk_version));
+    found = &signer;
+  }
+  return found;
+}
+
+// At least one signature with a supported algorithm, and every such signature valid.
+bool all_valid(const std::vector<apksig::signature_status>& statuses) {
+  bool any = false;
+  for (const auto status : statuses) {
+    if (status == apksig::signature_status::unsupported_algorithm) continue;
+    if (status != apksig::signature_status::valid) return false;
+    any = true;
+  }
+  return any;
+}
+
+template <class Signer>
+bool verify_signer(apksig::split_report& report, const apksig::split_verify_options& opts,
+                   apksig::signature_verifier& verifier, unsigned hash_threads, const apksig::siginfo& info,
+                   const Signer& signer) {
+  if (signer.signed_data.certificates.empty()) throw apksig::parse_error("Signer without certificates");
+  report.signer_certificates.push_back(apksig::intern_certificate(signer.signed_data.certificates.front())->sha256());
+
+  bool verified = true;
+  if (opts.verify_signatures) {
+    const bool valid = all_valid(verifier.verify_batch(apksig::signature_requests(signer)));
+    report.signers_verified.push_back(valid);
+    verified = valid;
+  }
+  if (opts.verify_contents) {
+    apksig::content_verify_options content_opts;
+    content_opts.cheapest_only = opts.cheapest_digest_only;
+    content_opts.threads = hash_threads;
+    report.contents.push_back(apksig::verify_contents(report.path, info.get_sections(), signer.signed_data, content_opts));
+    verified = verified && report.contents.back().verified;
+  }
+  return verified;
+}
+
+// Fills report.lineage from the signer's proof-of-rotation attribute, if any. Returns false if a
+// node's signature by its predecessor doesn't verify.
+bool verify_lineage(apksig::split_report& report, const apksig::split_verify_options& opts,
+                    apksig::signature_verifier& verifier, const apksig::v3_signer& signer) {
+  const auto& attrs = signer.signed_data.add_attrs;
+  const auto attr = std::find_if(attrs.cbegin(), attrs.cend(),
+                                 [](const auto& a) { return a.id == proof_of_rotation_attr_id; });
+  if (attr == attrs.cend()) return true;
+
+  const auto nodes = parse_lineage(attr->value);
+  if (nodes.empty() || nodes.back().cert->sha256() != report.signer_certificates.front()) {
+    throw apksig::parse_error("Proof-of-rotation lineage does not end with the signing certificate");
+  }
+  for (const auto& node : nodes) report.lineage.push_back({node.cert->sha256(), node.flags});
+  if (!opts.verify_signatures) return true;
+
+  std::vector<apksig::signature_request> requests;
+  for (size_t i = 1; i < nodes.size(); i++) {
+    const auto& node = nodes[i];
+    requests.push_back({&nodes[i - 1].cert->public_key(), node.sig_algo_id, node.signed_data.data(),
+                        node.signed_data.size(), &node.signature});
+  }
+  const auto statuses = verifier.verify_batch(requests);
+  return std::all_of(statuses.cbegin(), statuses.cend(),
+                     [](const auto status) { return status == apksig::signature_status::valid; });
+}
+
+void verify_split(apksig::split_report& report, const apksig::split_verify_options& opts,
+                  apksig::signature_verifier& verifier, unsigned hash_threads) {
+  apksig::siginfo info{report.path};
+  info.parse();
+
+  const apksig::v3_signer* v3_signer = nullptr;
+  if (info.has_v3_1_block()) {
+    v3_signer = signer_for_sdk(info.get_v3_1_block(), opts.sdk_version);
+    report.scheme = 31;
+  }
+  if (v3_signer == nullptr && info.has_v3_block()) {
+    v3_signer = signer_for_sdk(info.get_v3_block(), opts.sdk_version);
+    report.scheme = 3;
+  }
+
+  bool verified = true;
+  if (v3_signer != nullptr) {
+    verified = verify_signer(report, opts, verifier, hash_threads, info, *v3_signer);
+    verified = verify_lineage(report, opts, verifier, *v3_signer) && verified;
+  } else {
+    report.scheme = 2;
+    if (!info.has_v2_block()) throw apksig::parse_error("No signer for SDK " + std::to_string(opts.sdk_version));
+    const auto& signers = info.get_v2_block().signers;
+    if (signers.empty()) throw apksig::parse_error("No signers");
+    for (const auto& signer : signers) {
+      verified = verify_signer(report, opts, verifier, hash_threads, info, signer) && verified;
+    }
+  }
+  std::sort(report.signer_certificates.begin(), report.signer_certificates.end());
+  report.verified = verified;
+}
+
+// Equal, or the shorter lineage is the tail of the longer one.
+bool lineages_compatible(const std::vector<apksig::lineage_node>& a, const std::vector<apksig::lineage_node>& b) {
+  const auto& shorter = a.size() < b.size() ? a : b;
+  const auto& longer = a.size() < b.size() ? b : a;
+  return std::equal(shorter.crbegin(), shorter.crend(), longer.crbegin(),
+                    [](const auto& x, const auto& y) { return x.certificate_sha256 == y.certificate_sha256; });
+}
+
+}  // namespace
+
+namespace apksig {
+
+split_set_report verify_split_set(const std::vector<std::filesystem::path>& apk_fpaths,
+                                  const split_verify_options& opts) {
+  split_set_report result;
+  result.splits.resize(apk_fpaths.size());
+  if (apk_fpaths.empty()) return result;
+
+  std::optional<signature_verifier> own_verifier;
+  auto* verifier = opts.verifier;
+  if (verifier == nullptr) verifier = &own_verifier.emplace();
+
+  const auto threads = detail::resolve_threads(opts.threads);
+  const auto split_threads = std::min<size_t>(threads, apk_fpaths.size());
+  const auto hash_threads = std::max(1u, static_cast<unsigned>(threads / split_threads));
+
+  detail::parallel_for(apk_fpaths.size(), static_cast<unsigned>(split_threads), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      auto& report = result.splits[i];
+      report.path = apk_fpaths[i];
+      try {
+        verify_split(report, opts, *verifier, hash_threads);
+      } catch (const std::exception& e) {
+        report.error = e.what();
+        report.verified = false;
+      }
+    }
+  });
+
+  const auto& base = result.splits.front();
+  // Every lineage compatible with the longest one is compatible with every other.
+  const auto& longest = std::max_element(result.splits.cbegin(), result.splits.cend(), [](const auto& a, const auto& b) {
+                          return a.lineage.size() < b.lineage.size();
+                        })->lineage;
+  result.lineages_compatible = true;
+  result.verified = true;
+  bool same_signers = true;
+  for (auto& split : result.splits) {
+    split.matches_base = base.error.empty() && split.error.empty() &&
+                         split.signer_certificates == base.signer_certificates;
+    same_signers = same_signers && split.matches_base;
+    result.lineages_compatible = result.lineages_compatible && lineages_compatible(split.lineage, longest);
+    result.verified = result.verified && split.verified;
+  }
+  result.consistent = same_signers && result.lineages_compatible;
+  result.verified = result.verified && result.consistent;
+  return result;
+}
+
+}  // namespace apksig
@@ -0,0 +1,91 @@
+#include "apksig/stream.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+#include "apksig/io.hpp"
+#include "zip_format.hpp"
+
+namespace apksig {
+
+stream_parser::stream_parser(stream_options opts) : opts_(std::move(opts)) {
+  for (const auto algo : opts_.digest_algos) {
+    digesters_.emplace_back(algo);
+  }
+}
+
+void stream_parser::update(const uint8_t* data, size_t size) {
+  constexpr auto chunk_size = chunked_digester::chunk_size;
+  while (size > 0) {
+    if (tail_.empty() || tail_.back().size() == chunk_size) {
+      tail_.emplace_back().reserve(chunk_size);
+    }
+    auto& back = tail_.back();
+    const auto n = std::min(size, chunk_size - back.size());
+    back.insert(back.end(), data, data + n);
+    data += n;
+    size -= n;
+    size_ += n;
+
+    // Only whole chunks leave the tail, which keeps tail_offset_ chunk aligned.
+    while (tail_.size() > 1 && size_ - tail_offset_ - chunk_size >= opts_.max_tail_size) {
+      evict_front_chunk();
+    }
+  }
+}
+
+void stream_parser::evict_front_chunk() {
+  const auto& front = tail_.front();
+  for (auto& digester : digesters_) {
+    digester.add_chunk(front.data(), front.size());
+  }
+  tail_offset_ += front.size();
+  tail_.pop_front();
+}
+
+stream_result stream_parser::finish() {
+  auto bytes = std::make_shared<std::vector<uint8_t>>();
+  bytes->reserve(static_cast<size_t>(size_ - tail_offset_));
+  for (const auto& chunk : tail_) {
+    bytes->insert(bytes->end(), chunk.cbegin(), chunk.cend());
+  }
+  tail_.clear();
+
+  siginfo info(std::make_unique<memory_istream>(bytes, tail_offset_));
+  const auto status = info.try_parse();
+  const auto& sections = info.get_sections();
+  if ((status.code == parse_errc::io_error && status.offset < tail_offset_) ||
+      (status && sections.signing_block_offset < tail_offset_)) {
+    throw parse_error("APK Signing Block starts before the retained tail, max_tail_size is too small");
+  }
+  if (!status) throw parse_error(status.message());
+
+  const auto at = [&](uint64_t offset) { return bytes->data() + (offset - tail_offset_); };
+  std::vector<uint8_t> eocd(at(sections.eocd_offset), at(sections.file_size));
+  detail::patch_eocd_cd_offset(eocd.data(), sections.signing_block_offset);
+
+  std::vector<content_digest> content_digests;
+  for (auto& digester : digesters_) {
+    digester.add_section(at(tail_offset_), static_cast<size_t>(sections.signing_block_offset - tail_offset_));
+    digester.add_section(at(sections.cd_offset), static_cast<size_t>(sections.eocd_offset - sections.cd_offset));
+    digester.add_section(eocd.data(), eocd.size());
+    content_digests.push_back({digester.algo(), digester.finish()});
+  }
+
+  return {std::move(info), std::move(content_digests), size_};
+}
+
+stream_result parse_stream(std::istream& is, stream_options opts) {
+  stream_parser parser(std::move(opts));
+  std::vector<uint8_t> buf(chunked_digester::chunk_size);
+  while (is) {
+    is.read(reinterpret_cast<char*>(buf.data()), static_cast<std::streamsize>(buf.size()));
+    parser.update(buf.data(), static_cast<size_t>(is.gcount()));
+  }
+  if (is.bad()) throw std::runtime_error("Failed to read APK stream");
+  return parser.finish();
+}
+
+}  // namespace apksig
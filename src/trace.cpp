@@ -0,0 +1,195 @@
+#include "trace.hpp"
+
+#include <fstream>
+
+#ifdef APKSIG_TRACING
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+#endif
+
+namespace {
+
+#ifdef APKSIG_TRACING
+
+struct trace_event {
+  uint64_t start_ns;
+  uint64_t duration_ns;
+  uint64_t bytes;
+  apksig::trace_phase phase;
+};
+
+// Only the owning thread appends. An event becomes visible to readers once count is published,
+// so recording never takes a lock, and full blocks are chained instead of reallocated, so events
+// never move under a reader.
+struct event_block {
+  static constexpr size_t capacity = 4096;
+
+  std::array<trace_event, capacity> events;
+  std::atomic<size_t> count = 0;
+  std::atomic<event_block*> next = nullptr;
+};
+
+struct thread_buffer {
+  explicit thread_buffer(uint32_t id) : tid(id) {}
+
+  void append(const trace_event& e) noexcept {
+    auto n = tail->count.load(std::memory_order_relaxed);
+    if (n == event_block::capacity) {
+      // Dropping the event beats throwing out of an instrumented scope.
+      try {
+        overflow.push_back(std::make_unique<event_block>());
+      } catch (...) {
+        return;
+      }
+      tail->next.store(overflow.back().get(), std::memory_order_release);
+      tail = overflow.back().get();
+      n = 0;
+    }
+    tail->events[n] = e;
+    tail->count.store(n + 1, std::memory_order_release);
+  }
+
+  // Only while the owner isn't appending.
+  void clear() noexcept {
+    head.count.store(0, std::memory_order_relaxed);
+    head.next.store(nullptr, std::memory_order_relaxed);
+    tail = &head;
+    overflow.clear();
+  }
+
+  const uint32_t tid;
+  // Readers start here and follow event_block::next. tail and overflow belong to the owner.
+  event_block head;
+  event_block* tail = &head;
+  std::vector<std::unique_ptr<event_block>> overflow;
+};
+
+// Buffers outlive their threads, so a trace written at the end still holds the events of worker
+// threads that are gone.
+struct trace_registry {
+  static trace_registry& global() {
+    static trace_registry registry;
+    return registry;
+  }
+
+  const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+  std::mutex mutex;
+  std::vector<std::unique_ptr<thread_buffer>> buffers;
+};
+
+// Registration takes the registry lock once per thread.
+thread_buffer* this_thread_buffer() noexcept {
+  thread_local thread_buffer* buffer = []() -> thread_buffer* {
+    auto& registry = trace_registry::global();
+    try {
+      std::lock_guard lock(registry.mutex);
+      registry.buffers.push_back(std::make_unique<thread_buffer>(static_cast<uint32_t>(registry.buffers.size() + 1)));
+      return registry.buffers.back().get();
+    } catch (...) {
+      return nullptr;
+    }
+  }();
+  return buffer;
+}
+
+uint64_t now_ns() noexcept {
+  const auto elapsed = std::chrono::steady_clock::now() - trace_registry::global().epoch;
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+// Chrome trace timestamps are in microseconds.
+void write_us(std::ostream& os, uint64_t ns) {
+  const auto fill = os.fill('0');
+  os << ns / 1000 << '.' << std::setw(3) << ns % 1000;
+  os.fill(fill);
+}
+
+#endif
+
+}  // namespace
+
+namespace apksig {
+
+const char* trace_phase_name(trace_phase phase) noexcept {
+  switch (phase) {
+    case trace_phase::eocd_search:
+      return "eocd_search";
+    case trace_phase::footer_read:
+      return "footer_read";
+    case trace_phase::pair_iteration:
+      return "pair_iteration";
+    case trace_phase::v2_decode:
+      return "v2_decode";
+    case trace_phase::cert_hashing:
+      return "cert_hashing";
+    case trace_phase::content_read:
+      return "content_read";
+    case trace_phase::content_digest:
+      return "content_digest";
+    case trace_phase::signature_verify:
+      return "signature_verify";
+  }
+  return "unknown";
+}
+
+void write_chrome_trace(std::ostream& os) {
+  os << "{\"traceEvents\":[";
+#ifdef APKSIG_TRACING
+  auto& registry = trace_registry::global();
+  std::lock_guard lock(registry.mutex);
+  const char* separator = "\n";
+  for (const auto& buffer : registry.buffers) {
+    for (const auto* block = &buffer->head; block != nullptr;
+         block = block->next.load(std::memory_order_acquire)) {
+      const auto count = block->count.load(std::memory_order_acquire);
+      for (size_t i = 0; i < count; i++) {
+        const auto& e = block->events[i];
+        os << separator << R"({"name":")" << trace_phase_name(e.phase) << R"(","cat":"apksig","ph":"X","pid":1,"tid":)"
+           << buffer->tid << ",\"ts\":";
+        write_us(os, e.start_ns);
+        os << ",\"dur\":";
+        write_us(os, e.duration_ns);
+        os << ",\"args\":{\"bytes\":" << e.bytes << "}}";
+        separator = ",\n";
+      }
+    }
+  }
+#endif
+  os << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+void write_chrome_trace(const std::filesystem::path& json_file_path) {
+  std::ofstream ofs(json_file_path, std::ios_base::out | std::ios_base::trunc);
+  ofs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+  write_chrome_trace(ofs);
+}
+
+void clear_trace() {
+#ifdef APKSIG_TRACING
+  auto& registry = trace_registry::global();
+  std::lock_guard lock(registry.mutex);
+  for (auto& buffer : registry.buffers) buffer->clear();
+#endif
+}
+
+}  // namespace apksig
+
+#ifdef APKSIG_TRACING
+
+namespace apksig::detail {
+
+scoped_trace::scoped_trace(trace_phase phase, uint64_t bytes) noexcept
+    : phase_(phase), bytes_(bytes), start_ns_(now_ns()) {}
+
+scoped_trace::~scoped_trace() {
+  if (auto* buffer = this_thread_buffer()) buffer->append({start_ns_, now_ns() - start_ns_, bytes_, phase_});
+}
+
+}  // namespace apksig::detail
+
+#endif
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+
+#include "apksig/trace.hpp"
+
+namespace apksig::detail {
+
+#ifdef APKSIG_TRACING
+
+// Records one event spanning its own lifetime into the calling thread's trace buffer.
+class scoped_trace {
+ public:
+  explicit scoped_trace(trace_phase phase, uint64_t bytes = 0) noexcept;
+  scoped_trace(const scoped_trace&) = delete;
+  scoped_trace& operator=(const scoped_trace&) = delete;
+  ~scoped_trace();
+
+  void add_bytes(uint64_t n) noexcept { bytes_ += n; }
+
+ private:
+  trace_phase phase_;
+  uint64_t bytes_;
+  uint64_t start_ns_;
+};
+
+#else
+
+class scoped_trace {
+ public:
+  explicit scoped_trace(trace_phase, uint64_t = 0) noexcept {}
+
+  void add_bytes(uint64_t) noexcept {}
+};
+
+#endif
+
+}  // namespace apksig::detail
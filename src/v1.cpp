@@ -0,0 +1,205 @@
+#include "apksig/v1.hpp"
+
+#include <mbedtls/base64.h>
+
+#include <exception>
+#include <fstream>
+#include <optional>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+
+#include "apksig/central_directory.hpp"
+#include "jar_manifest.hpp"
+#include "parallel.hpp"
+#include "pkcs7.hpp"
+#include "sha.hpp"
+
+namespace {
+
+using apksig::detail::jar_manifest;
+using apksig::detail::jar_section;
+using apksig::detail::sha_kind;
+
+constexpr std::string_view meta_inf = "META-INF/";
+constexpr std::string_view manifest_name = "META-INF/MANIFEST.MF";
+
+// Strongest first, the order in which entry digests are checked.
+constexpr std::pair<std::string_view, sha_kind> digest_names[] = {
+    {"SHA-512", sha_kind::sha512}, {"SHA-384", sha_kind::sha384}, {"SHA-256", sha_kind::sha256},
+    {"SHA1", sha_kind::sha1},      {"SHA-1", sha_kind::sha1},
+};
+
+bool ends_with(std::string_view s, std::string_view suffix) {
+  return s.size() >= suffix.size() && s.substr(s.size() - suffix.size()) == suffix;
+}
+
+// Files directly in META-INF/ that make up the signature rather than being signed.
+bool is_signature_file(std::string_view name) {
+  if (name.substr(0, meta_inf.size()) != meta_inf) return false;
+  const auto base = name.substr(meta_inf.size());
+  if (base.find('/') != std::string_view::npos) return false;
+  return name == manifest_name || ends_with(base, ".SF") || ends_with(base, ".RSA") || ends_with(base, ".DSA") ||
+         ends_with(base, ".EC");
+}
+
+std::optional<std::vector<uint8_t>> base64_decode(const std::string& s) {
+  std::vector<uint8_t> out(s.size() / 4 * 3 + 3);
+  size_t len = 0;
+  if (mbedtls_base64_decode(out.data(), out.size(), &len, reinterpret_cast<const unsigned char*>(s.data()),
+                            s.size()) != 0) {
+    return std::nullopt;
+  }
+  out.resize(len);
+  return out;
+}
+
+// True if some attribute "<algorithm><suffix>" of section matches the digest of data; nullopt if
+// the section has no such attribute with an algorithm we know.
+std::optional<bool> check_digest(const jar_section& section, std::string_view suffix, const uint8_t* data, size_t size) {
+  for (const auto& [algo_name, kind] : digest_names) {
+    const auto* value = section.get(std::string(algo_name).append(suffix));
+    if (value == nullptr) continue;
+    const auto expected = base64_decode(*value);
+    return expected && *expected == apksig::detail::sha_digest(kind, data, size);
+  }
+  return std::nullopt;
+}
+
+// Checks a .SF file against the manifest. Returns the names of the manifest sections it vouches
+// for, or nullopt with the whole manifest covered.
+std::optional<std::unordered_set<std::string>> check_signature_file(const jar_manifest& sf,
+                                                                    const std::vector<uint8_t>& mf_bytes,
+                                                                    const jar_manifest& mf, std::string& error) {
+  const auto& sf_main = sf.sections.front();
+  if (check_digest(sf_main, "-Digest-Manifest", mf_bytes.data(), mf_bytes.size()).value_or(false)) {
+    return std::nullopt;
+  }
+
+  // Without a matching whole-manifest digest, every individual section has to match.
+  const auto& mf_main = mf.sections.front();
+  if (check_digest(sf_main, "-Digest-Manifest-Main-Attributes", mf_bytes.data() + mf_main.begin,
+                   mf_main.end - mf_main.begin) == false) {
+    error = "Main attributes digest mismatch";
+  }
+  std::unordered_set<std::string> covered;
+  for (size_t i = 1; i < sf.sections.size(); i++) {
+    const auto& section = sf.sections[i];
+    const auto* mf_section = mf.find(section.name);
+    if (mf_section == nullptr) {
+      error = "Signature file names " + section.name + ", which is not in the manifest";
+      continue;
+    }
+    if (check_digest(section, "-Digest", mf_bytes.data() + mf_section->begin, mf_section->end - mf_section->begin)
+            .value_or(false)) {
+      covered.insert(section.name);
+    } else {
+      error = "Manifest section digest mismatch for " + section.name;
+    }
+  }
+  return covered;
+}
+
+}  // namespace
+
+namespace apksig {
+
+v1_verify_result verify_v1(const std::filesystem::path& apk_fpath, const v1_verify_options& opts) {
+  v1_verify_result result;
+  const auto dir = central_directory::read(apk_fpath, opts.limits);
+  std::ifstream ifs(apk_fpath, std::ios_base::in | std::ios_base::binary);
+  ifs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+
+  const auto* mf_entry = dir.find(manifest_name);
+  if (mf_entry == nullptr) {
+    result.error = "No META-INF/MANIFEST.MF";
+    return result;
+  }
+  result.present = true;
+  const auto mf_bytes = read_entry(ifs, *mf_entry, dir.offset(), opts.limits.max_entry_size);
+  const auto mf = detail::parse_jar_manifest(mf_bytes.data(), mf_bytes.size());
+
+  // Per signer, the manifest sections it covers; nullopt for all of them.
+  std::vector<std::optional<std::unordered_set<std::string>>> coverage;
+  bool verified = true;
+  for (const auto& e : dir.entries()) {
+    if (!is_signature_file(e.name) || !ends_with(e.name, ".SF")) continue;
+    v1_signer_result signer;
+    const auto base = e.name.substr(0, e.name.size() - 3);
+    signer.name = std::string(base.substr(meta_inf.size()));
+
+    try {
+      const cd_entry* block_entry = nullptr;
+      for (const auto* ext : {".RSA", ".EC", ".DSA"}) {
+        if ((block_entry = dir.find(std::string(base).append(ext))) != nullptr) break;
+      }
+      if (block_entry == nullptr) throw parse_error("No signature block for " + std::string(e.name));
+
+      const auto sf_bytes = read_entry(ifs, e, dir.offset(), opts.limits.max_entry_size);
+      const auto block_bytes = read_entry(ifs, *block_entry, dir.offset(), opts.limits.max_entry_size);
+      const auto pkcs7 = detail::pkcs7_verify(block_bytes, sf_bytes.data(), sf_bytes.size());
+      signer.certificate = pkcs7.signer;
+      signer.signature_verified = pkcs7.verified;
+      signer.error = pkcs7.error;
+
+      std::string sf_error;
+      const auto sf = detail::parse_jar_manifest(sf_bytes.data(), sf_bytes.size());
+      coverage.push_back(check_signature_file(sf, mf_bytes, mf, sf_error));
+      signer.manifest_verified = sf_error.empty();
+      if (signer.error.empty()) signer.error = sf_error;
+    } catch (const std::exception& ex) {
+      signer.error = ex.what();
+      coverage.emplace_back(std::unordered_set<std::string>{});
+    }
+    verified = verified && signer.signature_verified && signer.manifest_verified;
+    result.signers.push_back(std::move(signer));
+  }
+  if (result.signers.empty()) {
+    verified = false;
+    result.error = "No signature files";
+  }
+
+  std::vector<const cd_entry*> to_check;
+  for (const auto& e : dir.entries()) {
+    if (!ends_with(e.name, "/") && !is_signature_file(e.name)) to_check.push_back(&e);
+  }
+  result.entries.resize(to_check.size());
+
+  detail::parallel_for(to_check.size(), opts.threads, [&](size_t begin, size_t end) {
+    std::ifstream worker_ifs(apk_fpath, std::ios_base::in | std::ios_base::binary);
+    worker_ifs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+    for (size_t i = begin; i < end; i++) {
+      const auto& e = *to_check[i];
+      auto& r = result.entries[i];
+      r.name = std::string(e.name);
+      const auto* section = mf.find(r.name);
+      if (section == nullptr) {
+        r.error = "Not in the manifest";
+        continue;
+      }
+      for (const auto& c : coverage) {
+        if (c && c->count(r.name) == 0) r.error = "Not covered by every signer";
+      }
+      if (!r.error.empty()) continue;
+      try {
+        const auto data = read_entry(worker_ifs, e, dir.offset(), opts.limits.max_entry_size);
+        const auto matches = check_digest(*section, "-Digest", data.data(), data.size());
+        if (!matches) {
+          r.error = "No supported digest in the manifest";
+        } else if (!*matches) {
+          r.error = "Digest mismatch";
+        } else {
+          r.verified = true;
+        }
+      } catch (const std::exception& ex) {
+        r.error = ex.what();
+      }
+    }
+  });
+
+  for (const auto& r : result.entries) verified = verified && r.verified;
+  result.verified = verified;
+  return result;
+}
+
+}  // namespace apksig
@@ -0,0 +1,227 @@
+#include "apksig/v4.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <ios>
+#include <stdexcept>
+#include <utility>
+
+#include "apksig/digest.hpp"
+#include "apksig/verity.hpp"
+#include "read_utils.hpp"
+#include "write_utils.hpp"
+
+namespace {
+
+using apksig::detail::append_le;
+using apksig::detail::append_len_prefixed;
+using apksig::detail::read_into_vector;
+using apksig::detail::read_le;
+
+constexpr uint32_t v4_hash_algorithm_sha256 = 1;
+constexpr uint8_t v4_log2_blocksize = 12;
+
+std::vector<uint8_t> read_len_prefixed_bytes(std::istream& is) {
+  const auto len = read_le<uint32_t>(is);
+  return read_into_vector(is, len);
+}
+
+// Reads the length prefix of a nested structure and returns where it ends.
+std::streampos read_nested_end(std::istream& is) {
+  const auto len = read_le<uint32_t>(is);
+  return is.tellg() + static_cast<std::streamoff>(len);
+}
+
+void check_nested_end(std::istream& is, std::streampos end) {
+  if (is.tellg() > end) throw apksig::parse_error("v4 signature field overruns its enclosing structure");
+}
+
+apksig::v4_hashing_info parse_hashing_info(std::istream& is) {
+  const auto end = read_nested_end(is);
+  apksig::v4_hashing_info info;
+  info.hash_algorithm = read_le<uint32_t>(is);
+  info.log2_blocksize = read_le<uint8_t>(is);
+  info.salt = read_len_prefixed_bytes(is);
+  info.raw_root_hash = read_len_prefixed_bytes(is);
+  check_nested_end(is, end);
+  is.seekg(end);
+  return info;
+}
+
+apksig::v4_signing_info parse_signing_info(std::istream& is) {
+  apksig::v4_signing_info info;
+  info.apk_digest = read_len_prefixed_bytes(is);
+  info.certificate = read_len_prefixed_bytes(is);
+  info.additional_data = read_len_prefixed_bytes(is);
+  info.public_key = read_len_prefixed_bytes(is);
+  info.sig_algo_id = read_le<uint32_t>(is);
+  info.signature = read_len_prefixed_bytes(is);
+  return info;
+}
+
+std::vector<uint8_t> encode_hashing_info(const apksig::v4_hashing_info& info) {
+  std::vector<uint8_t> out;
+  append_le(out, info.hash_algorithm);
+  append_le(out, info.log2_blocksize);
+  append_len_prefixed(out, info.salt);
+  append_len_prefixed(out, info.raw_root_hash);
+  return out;
+}
+
+std::vector<uint8_t> encode_signing_info(const apksig::v4_signing_info& info) {
+  std::vector<uint8_t> out;
+  append_len_prefixed(out, info.apk_digest);
+  append_len_prefixed(out, info.certificate);
+  append_len_prefixed(out, info.additional_data);
+  append_len_prefixed(out, info.public_key);
+  append_le(out, info.sig_algo_id);
+  append_len_prefixed(out, info.signature);
+  return out;
+}
+
+// The preferred content digest among those a signer signed, or nullptr if none is supported.
+const apksig::digest* best_digest(const std::vector<apksig::digest>& digests) {
+  const apksig::digest* best = nullptr;
+  int best_preference = 0;
+  for (const auto& d : digests) {
+    const auto algo = apksig::content_digest_algo_of(d.sig_algo_id);
+    if (!algo) continue;
+    const auto preference = apksig::content_digest_preference(*algo);
+    if (best == nullptr || preference < best_preference) {
+      best = &d;
+      best_preference = preference;
+    }
+  }
+  return best;
+}
+
+// Like apksigner, the v4 apk_digest comes from the v3 signer when there is one and from the v2
+// signer otherwise.
+std::vector<uint8_t> best_apk_digest(const std::filesystem::path& apk_fpath) {
+  apksig::siginfo siginfo{apk_fpath};
+  siginfo.parse();
+  const std::vector<apksig::digest>* digests = nullptr;
+  if (siginfo.has_v3_block() && !siginfo.get_v3_block().signers.empty()) {
+    digests = &siginfo.get_v3_block().signers.front().signed_data.digests;
+  } else if (siginfo.has_v2_block() && !siginfo.get_v2_block().signers.empty()) {
+    digests = &siginfo.get_v2_block().signers.front().signed_data.digests;
+  } else {
+    throw apksig::parse_error("v4 signing requires an APK with a v2 or v3 signature");
+  }
+
+  const auto* best = best_digest(*digests);
+  if (best == nullptr) throw apksig::parse_error("No supported content digest in the v2 or v3 signature");
+  return best->digest_data;
+}
+
+}  // namespace
+
+namespace apksig {
+
+v4_signature parse_v4_signature(std::istream& is) {
+  v4_signature sig;
+  sig.version = read_le<uint32_t>(is);
+  if (sig.version != 2) throw parse_error("Unsupported v4 signature version");
+  sig.hashing_info = parse_hashing_info(is);
+
+  const auto signing_infos_end = read_nested_end(is);
+  sig.signing_info = parse_signing_info(is);
+  check_nested_end(is, signing_infos_end);
+  sig.signing_info_blocks = read_into_vector(is, static_cast<size_t>(signing_infos_end - is.tellg()));
+
+  // The tree is optional: a signature without one simply ends here.
+  if (is.peek() != std::istream::traits_type::eof()) {
+    sig.merkle_tree = read_len_prefixed_bytes(is);
+  }
+  return sig;
+}
+
+v4_signature parse_v4_signature(const std::filesystem::path& idsig_fpath) {
+  std::ifstream ifs(idsig_fpath, std::ios_base::in | std::ios_base::binary);
+  ifs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+  return parse_v4_signature(ifs);
+}
+
+bool verify_v4_merkle_tree(const std::filesystem::path& apk_fpath, const v4_signature& sig, unsigned threads) {
+  const auto& hashing_info = sig.hashing_info;
+  if (hashing_info.hash_algorithm != v4_hash_algorithm_sha256 || hashing_info.log2_blocksize != v4_log2_blocksize) {
+    throw parse_error("Unsupported v4 hashing parameters");
+  }
+
+  const auto tree = build_merkle_tree(apk_fpath, {hashing_info.salt, threads});
+  if (!std::equal(tree.root_hash.cbegin(), tree.root_hash.cend(), hashing_info.raw_root_hash.cbegin(),
+                  hashing_info.raw_root_hash.cend())) {
+    return false;
+  }
+  return sig.merkle_tree.empty() || sig.merkle_tree == tree.tree;
+}
+
+}  // namespace apksig
+
+namespace apksig {
+
+void write_v4_signature(std::ostream& os, const v4_signature& sig) {
+  std::vector<uint8_t> out;
+  append_le(out, sig.version);
+  append_len_prefixed(out, encode_hashing_info(sig.hashing_info));
+  auto signing_infos = encode_signing_info(sig.signing_info);
+  detail::append_bytes(signing_infos, sig.signing_info_blocks);
+  append_len_prefixed(out, signing_infos);
+  detail::write_bytes(os, out);
+
+  if (!sig.merkle_tree.empty()) {
+    std::vector<uint8_t> tree_len;
+    append_le(tree_len, static_cast<uint32_t>(sig.merkle_tree.size()));
+    detail::write_bytes(os, tree_len);
+    detail::write_bytes(os, sig.merkle_tree);
+  }
+}
+
+void write_v4_signature(const std::filesystem::path& idsig_fpath, const v4_signature& sig) {
+  std::ofstream ofs(idsig_fpath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+  ofs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+  write_v4_signature(ofs, sig);
+}
+
+std::vector<uint8_t> v4_signed_data(uint64_t apk_size, const v4_hashing_info& hashing_info,
+                                    const v4_signing_info& signing_info) {
+  std::vector<uint8_t> body;
+  append_le(body, apk_size);
+  append_le(body, hashing_info.hash_algorithm);
+  append_le(body, hashing_info.log2_blocksize);
+  append_len_prefixed(body, hashing_info.salt);
+  append_len_prefixed(body, hashing_info.raw_root_hash);
+  append_len_prefixed(body, signing_info.apk_digest);
+  append_len_prefixed(body, signing_info.certificate);
+  append_len_prefixed(body, signing_info.additional_data);
+
+  std::vector<uint8_t> out;
+  append_le(out, static_cast<uint32_t>(sizeof(uint32_t) + body.size()));
+  detail::append_bytes(out, body);
+  return out;
+}
+
+v4_signature generate_v4_signature(const std::filesystem::path& apk_fpath, const signing_key& key, unsigned threads) {
+  if (key.certificates().empty()) throw std::runtime_error("Signing key has no certificate");
+
+  v4_signature sig;
+  sig.version = 2;
+  sig.hashing_info.hash_algorithm = v4_hash_algorithm_sha256;
+  sig.hashing_info.log2_blocksize = v4_log2_blocksize;
+
+  auto tree = build_merkle_tree(apk_fpath, {{}, threads});
+  sig.hashing_info.raw_root_hash.assign(tree.root_hash.cbegin(), tree.root_hash.cend());
+  sig.merkle_tree = std::move(tree.tree);
+
+  auto& signing_info = sig.signing_info;
+  signing_info.apk_digest = best_apk_digest(apk_fpath);
+  signing_info.certificate = key.certificates().front();
+  signing_info.public_key = key.public_key();
+  signing_info.sig_algo_id = key.default_sig_algo_id();
+
+  const auto signed_data = v4_signed_data(tree.data_size, sig.hashing_info, signing_info);
+  signing_info.signature = key.sign(signing_info.sig_algo_id, signed_data.data(), signed_data.size());
+  return sig;
+}
+
+}  // namespace apksig
@@ -0,0 +1,93 @@
+#include "apksig/verify.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include "content_pass.hpp"
+
+namespace apksig {
+
+content_digest_set compute_content_digests(const std::filesystem::path& apk_fpath, const apk_sections& sections,
+                                           const content_digest_options& opts) {
+  return detail::run_content_pass(apk_fpath, sections, opts);
+}
+
+std::vector<uint8_t> compute_content_digest(const std::filesystem::path& apk_fpath, const apk_sections& sections,
+                                            content_digest_algo algo, unsigned threads) {
+  content_digest_options opts;
+  opts.algos = {algo};
+  opts.threads = threads;
+  auto set = compute_content_digests(apk_fpath, sections, opts);
+  return std::move(set.digests.front().digest_data);
+}
+
+namespace {
+
+// Both schemes sign the same content digests.
+content_verify_result verify_digests(const std::filesystem::path& apk_fpath, const apk_sections& sections,
+                                     const std::vector<digest>& digests, const content_verify_options& opts) {
+  content_verify_result result;
+  for (const auto& d : digests) {
+    if (const auto algo = content_digest_algo_of(d.sig_algo_id)) {
+      result.checks.push_back({*algo, d.digest_data, {}});
+    }
+  }
+
+  if (opts.cheapest_only && !result.checks.empty()) {
+    const auto cheapest = std::min_element(result.checks.cbegin(), result.checks.cend(), [](const auto& a, const auto& b) {
+                            return content_digest_preference(a.algo) < content_digest_preference(b.algo);
+                          })->algo;
+    result.checks.erase(std::remove_if(result.checks.begin(), result.checks.end(),
+                                       [&](const auto& c) { return c.algo != cheapest; }),
+                        result.checks.end());
+  }
+  if (result.checks.empty() && !opts.whole_file_sha256) return result;
+
+  content_digest_options digest_opts;
+  for (const auto& check : result.checks) digest_opts.algos.push_back(check.algo);
+  digest_opts.whole_file_sha256 = opts.whole_file_sha256;
+  digest_opts.threads = opts.threads;
+  // The pass records into the cache it reads from, so it reads from a copy.
+  chunk_digest_cache previous;
+  if (opts.cache != nullptr) {
+    previous = *opts.cache;
+    digest_opts.previous = &previous;
+    digest_opts.detection = opts.detection;
+    digest_opts.sample_ratio = opts.sample_ratio;
+    digest_opts.sample_seed = opts.sample_seed;
+    // A spot check does not see every chunk, so it must not become the reference for later runs.
+    if (opts.sample_ratio >= 1.0) digest_opts.record = opts.cache;
+  } else if (opts.sample_ratio < 1.0) {
+    throw std::invalid_argument("Spot-check verification needs a chunk digest cache");
+  }
+  auto set = compute_content_digests(apk_fpath, sections, digest_opts);
+
+  for (auto& check : result.checks) {
+    const auto it = std::find_if(set.digests.cbegin(), set.digests.cend(), [&](const auto& d) { return d.algo == check.algo; });
+    check.computed = it->digest_data;
+  }
+  result.whole_file_sha256 = std::move(set.whole_file_sha256);
+  result.hashed_chunks = set.hashed_chunks;
+  result.reused_chunks = set.reused_chunks;
+  result.sampled = opts.sample_ratio < 1.0;
+  const auto total_chunks = set.hashed_chunks + set.reused_chunks;
+  result.sample_ratio = total_chunks == 0 ? 1.0 : double(set.hashed_chunks) / double(total_chunks);
+  result.verified = !result.checks.empty() &&
+                    std::all_of(result.checks.cbegin(), result.checks.cend(), [](const auto& c) { return c.matches(); });
+  return result;
+}
+
+}  // namespace
+
+content_verify_result verify_contents(const std::filesystem::path& apk_fpath, const apk_sections& sections,
+                                      const v2_signed_data& signed_data, const content_verify_options& opts) {
+  return verify_digests(apk_fpath, sections, signed_data.digests, opts);
+}
+
+content_verify_result verify_contents(const std::filesystem::path& apk_fpath, const apk_sections& sections,
+                                      const v3_signed_data& signed_data, const content_verify_options& opts) {
+  return verify_digests(apk_fpath, sections, signed_data.digests, opts);
+}
+
+}  // namespace apksig
@@ -0,0 +1,117 @@
+#include "apksig/verity.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "parallel.hpp"
+#include "sha.hpp"
+#include "verity_tree.hpp"
+
+namespace {
+
+constexpr size_t hash_size = 32;
+constexpr size_t blocks_per_read = 256;  // 1MiB
+
+uint64_t div_round_up(uint64_t n, uint64_t d) { return (n + d - 1) / d; }
+
+// Sizes of the levels from the leaves up, each padded to whole blocks.
+std::vector<uint64_t> level_sizes(uint64_t data_size) {
+  std::vector<uint64_t> sizes;
+  while (true) {
+    const auto block_count = div_round_up(data_size, apksig::verity_block_size);
+    const auto hashes_size = block_count * hash_size;
+    sizes.push_back(div_round_up(hashes_size, apksig::verity_block_size) * apksig::verity_block_size);
+    if (hashes_size <= apksig::verity_block_size) break;
+    data_size = hashes_size;
+  }
+  return sizes;
+}
+
+void hash_block(apksig::detail::sha_context& ctx, const std::vector<uint8_t>& salt, const uint8_t* block,
+                uint8_t* out) {
+  ctx.restart();
+  ctx.update(salt.data(), salt.size());
+  ctx.update(block, apksig::verity_block_size);
+  ctx.finish(out);
+}
+
+}  // namespace
+
+namespace apksig::detail {
+
+merkle_tree_builder::merkle_tree_builder(uint64_t data_size, verity_options opts) : opts_(std::move(opts)) {
+  tree_.data_size = data_size;
+  if (data_size == 0) return;
+
+  leaf_blocks_ = static_cast<size_t>(div_round_up(data_size, verity_block_size));
+  level_sizes_ = level_sizes(data_size);
+  // Level i lives after every level above it.
+  level_offsets_.resize(level_sizes_.size());
+  uint64_t total = 0;
+  for (size_t i = level_sizes_.size(); i-- > 0;) {
+    level_offsets_[i] = total;
+    total += level_sizes_[i];
+  }
+  tree_.tree.assign(static_cast<size_t>(total), 0);
+}
+
+void merkle_tree_builder::hash_leaf_blocks(size_t first, const uint8_t* blocks, size_t count) {
+  sha_context ctx(sha_kind::sha256);
+  auto* out = tree_.tree.data() + level_offsets_[0] + first * hash_size;
+  for (size_t i = 0; i < count; i++) {
+    hash_block(ctx, opts_.salt, blocks + i * verity_block_size, out + i * hash_size);
+  }
+}
+
+merkle_tree merkle_tree_builder::finish() {
+  if (tree_.data_size == 0) return std::move(tree_);
+
+  for (size_t level = 1; level < level_sizes_.size(); level++) {
+    const auto* below = tree_.tree.data() + level_offsets_[level - 1];
+    auto* dst = tree_.tree.data() + level_offsets_[level];
+    parallel_for(static_cast<size_t>(level_sizes_[level - 1] / verity_block_size), opts_.threads,
+                 [&](size_t begin, size_t end) {
+                   sha_context ctx(sha_kind::sha256);
+                   for (size_t i = begin; i < end; i++) {
+                     hash_block(ctx, opts_.salt, below + i * verity_block_size, dst + i * hash_size);
+                   }
+                 });
+  }
+
+  sha_context ctx(sha_kind::sha256);
+  hash_block(ctx, opts_.salt, tree_.tree.data(), tree_.root_hash.data());
+  return std::move(tree_);
+}
+
+merkle_tree build_merkle_tree(const std::filesystem::path& file, const std::vector<segment>& segments,
+                              const verity_options& opts) {
+  uint64_t data_size = 0;
+  for (const auto& s : segments) data_size += s.size;
+  merkle_tree_builder builder(data_size, opts);
+
+  parallel_for(builder.leaf_block_count(), opts.threads, [&](size_t begin, size_t end) {
+    segment_reader reader(file, segments);
+    std::vector<uint8_t> buf(blocks_per_read * verity_block_size);
+    for (size_t first = begin; first < end; first += blocks_per_read) {
+      const auto count = std::min(blocks_per_read, end - first);
+      const auto pos = uint64_t(first) * verity_block_size;
+      const auto len = static_cast<size_t>(std::min<uint64_t>(count * verity_block_size, data_size - pos));
+      reader.read(pos, buf.data(), len);
+      std::memset(buf.data() + len, 0, count * verity_block_size - len);
+      builder.hash_leaf_blocks(first, buf.data(), count);
+    }
+  });
+  return builder.finish();
+}
+
+}  // namespace apksig::detail
+
+namespace apksig {
+
+merkle_tree build_merkle_tree(const std::filesystem::path& file, const verity_options& opts) {
+  const std::vector<detail::segment> segments{{0, std::filesystem::file_size(file)}};
+  return detail::build_merkle_tree(file, segments, opts);
+}
+
+}  // namespace apksig
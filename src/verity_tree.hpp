@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "apksig/verity.hpp"
+#include "segments.hpp"
+
+namespace apksig::detail {
+
+// Fills a merkle_tree level by level. Leaf blocks may be hashed from any thread as long as the
+// ranges are disjoint; finish() then hashes the upper levels across threads.
+class merkle_tree_builder {
+ public:
+  merkle_tree_builder(uint64_t data_size, verity_options opts);
+
+  size_t leaf_block_count() const noexcept { return leaf_blocks_; }
+  // Hashes count whole blocks, the first being leaf block `first`. The final data block has to be
+  // zero padded by the caller.
+  void hash_leaf_blocks(size_t first, const uint8_t* blocks, size_t count);
+  merkle_tree finish();
+
+ private:
+  verity_options opts_;
+  merkle_tree tree_;
+  size_t leaf_blocks_ = 0;
+  std::vector<uint64_t> level_sizes_;
+  std::vector<uint64_t> level_offsets_;
+};
+
+// Builds the tree over the concatenation of segments of file.
+merkle_tree build_merkle_tree(const std::filesystem::path& file, const std::vector<segment>& segments,
+                              const verity_options& opts);
+
+}  // namespace apksig::detail
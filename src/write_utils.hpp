@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <type_traits>
+#include <vector>
+
+namespace apksig::detail {
+
+template <class T>
+void append_le(std::vector<uint8_t>& out, T v) {
+  static_assert(std::is_unsigned_v<T> && std::is_integral_v<T>, "T must be a unsigned integral type");
+  for (std::size_t i = 0; i < sizeof(T); i++) {
+    out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+  }
+}
+
+// Overwrites sizeof(T) bytes at p.
+template <class T>
+void store_le(uint8_t* p, T v) {
+  static_assert(std::is_unsigned_v<T> && std::is_integral_v<T>, "T must be a unsigned integral type");
+  for (std::size_t i = 0; i < sizeof(T); i++) {
+    p[i] = static_cast<uint8_t>(v >> (8 * i));
+  }
+}
+
+inline void append_bytes(std::vector<uint8_t>& out, const std::vector<uint8_t>& bytes) {
+  out.insert(out.end(), bytes.cbegin(), bytes.cend());
+}
+
+// uint32 length followed by the bytes.
+inline void append_len_prefixed(std::vector<uint8_t>& out, const std::vector<uint8_t>& bytes) {
+  append_le(out, static_cast<uint32_t>(bytes.size()));
+  append_bytes(out, bytes);
+}
+
+inline void write_bytes(std::ostream& os, const uint8_t* p, size_t n) {
+  os.write(reinterpret_cast<const char*>(p), static_cast<std::streamsize>(n));
+}
+
+inline void write_bytes(std::ostream& os, const std::vector<uint8_t>& bytes) {
+  write_bytes(os, bytes.data(), bytes.size());
+}
+
+}  // namespace apksig::detail
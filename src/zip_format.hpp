@@ -0,0 +1,63 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace apksig::detail {
+
+constexpr std::array<std::uint8_t, 4> eocd_magic{0x50, 0x4B, 0x05, 0x06};
+constexpr size_t eocd_min_size = 22;
+constexpr size_t eocd_entry_count_offset = 10;
+constexpr size_t eocd_cd_size_offset = 12;
+constexpr size_t eocd_cd_offset_offset = 16;
+// The EOCD record is followed by at most a 64 KiB comment, so it starts within this many bytes of
+// the end of the file.
+constexpr size_t eocd_max_distance = eocd_min_size + 0xffff;
+
+constexpr uint32_t cd_entry_magic = 0x02014b50;
+constexpr size_t cd_entry_size = 46;
+constexpr size_t cd_entry_method_offset = 10;
+constexpr size_t cd_entry_crc_offset = 16;
+constexpr size_t cd_entry_compressed_size_offset = 20;
+constexpr size_t cd_entry_size_offset = 24;
+constexpr size_t cd_entry_name_len_offset = 28;
+constexpr size_t cd_entry_extra_len_offset = 30;
+constexpr size_t cd_entry_comment_len_offset = 32;
+constexpr size_t cd_entry_local_header_offset = 42;
+
+constexpr uint32_t local_header_magic = 0x04034b50;
+constexpr size_t local_header_size = 30;
+constexpr size_t local_header_name_len_offset = 26;
+constexpr size_t local_header_extra_len_offset = 28;
+
+constexpr uint16_t method_stored = 0;
+constexpr uint16_t method_deflated = 8;
+
+// Sizes and offsets that don't fit the 32-bit fields are 0xffffffff there and live in this extra
+// field instead.
+constexpr uint16_t zip64_extra_id = 0x0001;
+constexpr uint32_t zip64_marker = 0xffffffff;
+
+// Offset of the last EOCD record in tail, the last size bytes of a file, searching no further back
+// than eocd_max_distance from the end.
+inline std::optional<size_t> find_eocd(const uint8_t* tail, size_t size) noexcept {
+  if (size < eocd_min_size) return std::nullopt;
+  const auto lowest = size - std::min(size, eocd_max_distance);
+  for (auto pos = size - eocd_min_size + 1; pos-- > lowest;) {
+    if (std::equal(eocd_magic.cbegin(), eocd_magic.cend(), tail + pos)) return pos;
+  }
+  return std::nullopt;
+}
+
+// Content digests see the EOCD record as if the central directory started right where the APK
+// Signing Block does.
+inline void patch_eocd_cd_offset(uint8_t* eocd, uint64_t signing_block_offset) noexcept {
+  for (size_t i = 0; i < 4; i++) {
+    eocd[eocd_cd_offset_offset + i] = static_cast<uint8_t>(signing_block_offset >> (8 * i));
+  }
+}
+
+}  // namespace apksig::detail
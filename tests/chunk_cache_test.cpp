@@ -0,0 +1,102 @@
+#include "apksig/chunk_cache.hpp"
+
+#include "apksig/sign.hpp"
+#include "apksig/verify.hpp"
+#include "test.hpp"
+
+namespace {
+
+using namespace apksig;
+
+bool same_chunks(const chunk_digest_cache& a, const chunk_digest_cache& b) {
+  if (a.chunks.size() != b.chunks.size()) return false;
+  for (size_t i = 0; i < a.chunks.size(); i++) {
+    const auto &x = a.chunks[i], &y = b.chunks[i];
+    if (x.offset != y.offset || x.size != y.size || x.checksum != y.checksum) return false;
+  }
+  return a.algos == b.algos && a.chunk_digests == b.chunk_digests;
+}
+
+}  // namespace
+
+APKSIG_TEST(chunk_cache_round_trip) {
+  const auto dir = test::scratch_dir();
+  test::write_unsigned_apk(dir / "unsigned.apk");
+  sign_apk(dir / "unsigned.apk", dir / "signed.apk", test::fixture_key());
+  siginfo info{dir / "signed.apk"};
+  info.parse();
+
+  chunk_digest_cache cache;
+  content_digest_options opts;
+  opts.algos = {content_digest_algo::chunked_sha256, content_digest_algo::chunked_sha512};
+  opts.record = &cache;
+  compute_content_digests(dir / "signed.apk", info.get_sections(), opts);
+  // Three chunks of ZIP entries, one of central directory and one of EOCD.
+  CHECK(cache.chunks.size() == 5);
+
+  save_chunk_cache(dir / "cache.bin", cache);
+  const auto loaded = load_chunk_cache(dir / "cache.bin");
+  CHECK(loaded.sections.signing_block_offset == cache.sections.signing_block_offset);
+  CHECK(loaded.sections.cd_offset == cache.sections.cd_offset);
+  CHECK(loaded.sections.eocd_offset == cache.sections.eocd_offset);
+  CHECK(loaded.sections.file_size == cache.sections.file_size);
+  CHECK(same_chunks(loaded, cache));
+
+  auto bytes = test::read_file(dir / "cache.bin");
+  test::write_file(dir / "truncated.bin", {bytes.cbegin(), bytes.cend() - 1});
+  CHECK_THROWS(load_chunk_cache(dir / "truncated.bin"), std::exception);
+  bytes[0] ^= 1;
+  test::write_file(dir / "damaged.bin", bytes);
+  CHECK_THROWS(load_chunk_cache(dir / "damaged.bin"), parse_error);
+}
+
+APKSIG_TEST(incremental_digests_match_full_recompute) {
+  const auto dir = test::scratch_dir();
+  test::write_unsigned_apk(dir / "unsigned.apk");
+  sign_apk(dir / "unsigned.apk", dir / "signed.apk", test::fixture_key());
+  siginfo info{dir / "signed.apk"};
+  info.parse();
+  const auto& sections = info.get_sections();
+
+  content_digest_options opts;
+  opts.algos = {content_digest_algo::chunked_sha256, content_digest_algo::chunked_sha512};
+  chunk_digest_cache recorded;
+  opts.record = &recorded;
+  compute_content_digests(dir / "signed.apk", sections, opts);
+  save_chunk_cache(dir / "cache.bin", recorded);
+  const auto previous = load_chunk_cache(dir / "cache.bin");
+
+  // One byte of classes.dex in the second chunk.
+  constexpr uint64_t patched_offset = 1024 * 1024 + 4321;
+  auto bytes = test::read_file(dir / "signed.apk");
+  bytes[patched_offset] ^= 0x80;
+  test::write_file(dir / "patched.apk", bytes);
+
+  opts.record = nullptr;
+  const auto full = compute_content_digests(dir / "patched.apk", sections, opts);
+  CHECK(full.hashed_chunks == 5);
+
+  opts.previous = &previous;
+  change_detector by_checksum;
+  change_detector by_copy{change_detection::reference_copy, dir / "signed.apk", {}};
+  change_detector by_range{change_detection::dirty_ranges, {}, {{patched_offset, 1}}};
+  for (const auto& detection : {by_checksum, by_copy, by_range}) {
+    opts.detection = detection;
+    const auto incremental = compute_content_digests(dir / "patched.apk", sections, opts);
+    // The patched chunk and the EOCD record, which is always rehashed.
+    CHECK(incremental.hashed_chunks == 2);
+    CHECK(incremental.reused_chunks == 3);
+    CHECK(incremental.digests.size() == full.digests.size());
+    for (size_t i = 0; i < incremental.digests.size() && i < full.digests.size(); i++) {
+      CHECK(incremental.digests[i].algo == full.digests[i].algo);
+      CHECK(incremental.digests[i].digest_data == full.digests[i].digest_data);
+    }
+  }
+
+  // Unpatched, only the EOCD record is rehashed and the digests are the signed ones.
+  opts.detection = {};
+  const auto unchanged = compute_content_digests(dir / "signed.apk", sections, opts);
+  CHECK(unchanged.hashed_chunks == 1);
+  CHECK(unchanged.digests.at(0).digest_data == info.get_v2_block().signers.at(0).signed_data.digests.at(0).digest_data);
+  CHECK(unchanged.digests.at(0).digest_data != full.digests.at(0).digest_data);
+}
@@ -0,0 +1,81 @@
+#include "inflate.hpp"
+
+#include <string_view>
+
+#include "apksig/apksig.hpp"
+#include "test.hpp"
+
+namespace {
+
+using namespace apksig;
+
+using test::from_hex;
+
+std::vector<uint8_t> to_bytes(std::string_view s) { return {s.cbegin(), s.cend()}; }
+
+std::vector<uint8_t> inflate(const std::vector<uint8_t>& stream, size_t max_size = 1 << 20) {
+  return detail::inflate(stream.data(), stream.size(), max_size);
+}
+
+// One fixed Huffman block with a match: "hello hello hello hello".
+const auto fixed_block = from_hex("cb48cdc9c957c8402701");
+
+// One dynamic block whose literal/length code is 1, 2, ..., 14, 15, 15 bits long for 'a' to 'o'
+// and end-of-block, so 'n' and 'o' and end-of-block take longer codes than the fast lookup table.
+const auto long_code_block = from_hex(
+    "05e1019024499224490200000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000"
+    "0000128b9a4756cfde0300000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000"
+    "000000000000000000000000000000000000000000000000003ca276effbfdfdfbef7ffff7fffebfffdfffeffffb7ffff7bffffefdfdbe77"
+    "0bf8fffdfffe7fffbfff3f");
+
+std::vector<uint8_t> long_code_text() {
+  std::vector<uint8_t> text;
+  for (uint8_t c = 'a'; c <= 'o'; c++) text.push_back(c);
+  for (const auto c : std::string_view("onmlkjihgfedcbaaaaaaoooo")) text.push_back(static_cast<uint8_t>(c));
+  return text;
+}
+
+}  // namespace
+
+APKSIG_TEST(inflate_stored_block) {
+  const auto text = to_bytes("stored, not compressed");
+  const auto len = static_cast<uint16_t>(text.size());
+  std::vector<uint8_t> stream{0x01, static_cast<uint8_t>(len), static_cast<uint8_t>(len >> 8),
+                              static_cast<uint8_t>(~len), static_cast<uint8_t>(~len >> 8)};
+  stream.insert(stream.end(), text.cbegin(), text.cend());
+  CHECK(inflate(stream) == text);
+
+  // NLEN has to be the complement of LEN.
+  stream[3] ^= 1;
+  CHECK_THROWS(inflate(stream), parse_error);
+}
+
+APKSIG_TEST(inflate_fixed_and_dynamic_blocks) {
+  CHECK(inflate(fixed_block) == to_bytes("hello hello hello hello"));
+  CHECK(inflate(long_code_block) == long_code_text());
+  const auto entry = test::deflated_text_entry("bottles.txt");
+  CHECK(inflate(entry.deflated) == entry.data);
+  CHECK(detail::crc32(entry.data.data(), entry.data.size()) ==
+        detail::crc32_update(detail::crc32(entry.data.data(), 100), entry.data.data() + 100, entry.data.size() - 100));
+  CHECK(detail::crc32(reinterpret_cast<const uint8_t*>("123456789"), 9) == 0xcbf43926);
+}
+
+APKSIG_TEST(inflate_rejects_malformed_streams) {
+  // Over-subscribed code length code, then over-subscribed literal/length code.
+  CHECK_THROWS(inflate(from_hex("05e0932449922449920000000000")), parse_error);
+  CHECK_THROWS(inflate(from_hex("05e10190244992244902000000000000000000000000000000000000000000000000000000000000000000"
+                                "00000000000000000000000000000022020000000000000000000000000000000000000000000000000000"
+                                "00000000000000000000000000000000000000000000000000000000000000000000000000000000000000"
+                                "00000000000000001062")),
+               parse_error);
+  // A fixed block whose first symbol is a match.
+  CHECK_THROWS(inflate(from_hex("030200")), parse_error);
+
+  const auto entry = test::deflated_text_entry("bottles.txt");
+  for (const auto* stream : {&fixed_block, &long_code_block, &entry.deflated}) {
+    const auto size = inflate(*stream).size();
+    CHECK(inflate(*stream, size).size() == size);
+    CHECK_THROWS(inflate(*stream, size - 1), parse_error);
+    for (size_t n = 0; n < stream->size(); n++) CHECK_THROWS(detail::inflate(stream->data(), n, size), parse_error);
+  }
+}
@@ -0,0 +1,145 @@
+#include "apksig/limits.hpp"
+
+#include <fstream>
+
+#include "apksig/apksig.hpp"
+#include "apksig/central_directory.hpp"
+#include "apksig/sign.hpp"
+#include "signing_block_format.hpp"
+#include "test.hpp"
+#include "write_utils.hpp"
+
+namespace {
+
+using namespace apksig;
+
+struct signed_fixture {
+  std::filesystem::path path;
+  std::vector<uint8_t> bytes;
+  apk_sections sections;
+  id_value_pair v2_pair;
+};
+
+signed_fixture make_signed_apk() {
+  const auto dir = test::scratch_dir();
+  test::write_unsigned_apk(dir / "unsigned.apk");
+  signed_fixture fixture{dir / "signed.apk", {}, {}, {}};
+  sign_apk(dir / "unsigned.apk", fixture.path, test::fixture_key());
+  fixture.bytes = test::read_file(fixture.path);
+  siginfo info{fixture.path};
+  info.parse();
+  fixture.sections = info.get_sections();
+  fixture.v2_pair = *info.find_pair(detail::v2_block_id);
+  return fixture;
+}
+
+// Writes bytes with the little-endian value v stored at offset and returns the file's path.
+template <class T>
+std::filesystem::path patched(std::vector<uint8_t> bytes, uint64_t offset, T v) {
+  detail::store_le(bytes.data() + offset, v);
+  const auto path = test::scratch_dir() / "patched.apk";
+  test::write_file(path, bytes);
+  return path;
+}
+
+parse_errc try_parse_code(const std::filesystem::path& path, const parse_limits& limits = {}) {
+  siginfo info{path, limits};
+  return info.try_parse().code;
+}
+
+parse_errc try_decode_code(const std::filesystem::path& path, const parse_limits& limits = {}) {
+  siginfo info{path, limits};
+  const auto status = info.try_parse();
+  if (!status) return status.code;
+  return info.try_decode().code;
+}
+
+}  // namespace
+
+APKSIG_TEST(truncated_and_oversized_lengths) {
+  const auto fixture = make_signed_apk();
+  const auto& sections = fixture.sections;
+  CHECK(try_decode_code(fixture.path) == parse_errc::ok);
+
+  // Cut before the EOCD record.
+  auto truncated = fixture.bytes;
+  truncated.resize(static_cast<size_t>(sections.cd_offset));
+  test::write_file(test::scratch_dir() / "truncated.apk", truncated);
+  CHECK(try_parse_code(test::scratch_dir() / "truncated.apk") == parse_errc::not_a_zip);
+
+  // The footer's block size reaches past the start of the file.
+  const auto footer_size_offset = sections.cd_offset - detail::signing_block_footer_size;
+  CHECK(try_parse_code(patched(fixture.bytes, footer_size_offset, sections.cd_offset)) ==
+        parse_errc::bad_signing_block_size);
+
+  // The first pair's length runs past the block, or is too short to hold its ID.
+  const auto first_pair_offset = sections.signing_block_offset + 8;
+  CHECK(try_parse_code(patched(fixture.bytes, first_pair_offset, ~uint64_t{0})) == parse_errc::bad_id_value_pair);
+  CHECK(try_parse_code(patched(fixture.bytes, first_pair_offset, uint64_t{2})) == parse_errc::bad_id_value_pair);
+
+  // The v2 signer's length field runs past the signer sequence, or cuts the signer short. Pairs are
+  // still located, but the block doesn't decode.
+  const auto signer_length_offset = fixture.v2_pair.value_offset + 4;
+  for (const uint32_t length : {0xffffffffu, 4u}) {
+    const auto path = patched(fixture.bytes, signer_length_offset, length);
+    CHECK(try_parse_code(path) == parse_errc::ok);
+    CHECK(try_decode_code(path) == parse_errc::bad_block);
+    siginfo info{path};
+    info.parse();
+    CHECK_THROWS(info.get_v2_block(), parse_error);
+  }
+}
+
+APKSIG_TEST(signing_block_limits) {
+  const auto fixture = make_signed_apk();
+  const auto block_size = fixture.sections.cd_offset - fixture.sections.signing_block_offset;
+
+  parse_limits limits;
+  limits.max_block_size = block_size;
+  CHECK(try_decode_code(fixture.path, limits) == parse_errc::ok);
+  limits.max_block_size = block_size - 1;
+  CHECK(try_parse_code(fixture.path, limits) == parse_errc::limit_exceeded);
+
+  limits = {};
+  limits.max_signers = 0;
+  CHECK(try_decode_code(fixture.path, limits) == parse_errc::limit_exceeded);
+
+  limits = {};
+  limits.max_certificates = 0;
+  CHECK(try_decode_code(fixture.path, limits) == parse_errc::limit_exceeded);
+
+  limits = {};
+  limits.max_total_allocation = 1024;
+  CHECK(try_decode_code(fixture.path, limits) == parse_errc::limit_exceeded);
+  siginfo info{fixture.path, limits};
+  info.parse();
+  CHECK_THROWS(info.get_v2_block(), parse_error);
+}
+
+APKSIG_TEST(zip_read_limits) {
+  const auto fixture = make_signed_apk();
+  const auto cd_size = fixture.sections.eocd_offset - fixture.sections.cd_offset;
+
+  parse_limits limits;
+  limits.max_central_directory_size = cd_size;
+  CHECK(central_directory::read(fixture.path, limits).entries().size() == 2);
+  limits.max_central_directory_size = cd_size - 1;
+  CHECK_THROWS(central_directory::read(fixture.path, limits), parse_error);
+  siginfo info{fixture.path, limits};
+  info.parse();
+  CHECK_THROWS(info.read_central_directory(), parse_error);
+
+  const auto dir = central_directory::read(fixture.path);
+  const auto* dex = dir.find("classes.dex");
+  CHECK(dex != nullptr);
+  if (dex == nullptr) return;
+  std::ifstream ifs(fixture.path, std::ios_base::in | std::ios_base::binary);
+  ifs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+  CHECK(read_entry(ifs, *dex, dir.offset(), dex->uncompressed_size).size() == dex->uncompressed_size);
+  CHECK_THROWS(read_entry(ifs, *dex, dir.offset(), dex->uncompressed_size - 1), parse_error);
+
+  // An entry whose data would run into the central directory.
+  auto oversized = *dex;
+  oversized.compressed_size = oversized.uncompressed_size = dir.offset();
+  CHECK_THROWS(read_entry(ifs, oversized, dir.offset(), parse_limits{}.max_entry_size), parse_error);
+}
@@ -0,0 +1,157 @@
+#include "apksig/manifest.hpp"
+
+#include "apksig/apksig.hpp"
+#include "test.hpp"
+#include "write_utils.hpp"
+
+namespace {
+
+using namespace apksig;
+using detail::append_le;
+
+constexpr uint8_t type_string = 0x03;
+constexpr uint8_t type_int_dec = 0x10;
+constexpr uint8_t type_int_hex = 0x11;
+
+// Over 127 bytes in UTF-8, so its lengths take the two byte form there.
+const std::string long_package = "com.example." + std::string(150, 'a');
+// Two and three byte UTF-8 sequences, and a character outside the BMP that UTF-16 encodes as a
+// surrogate pair.
+const std::string version_name = "1.0-\xc3\xa9t\xc3\xa9-\xe2\x82\xac-\xf0\x9f\x9a\x80";
+
+// versionCode, versionName, minSdkVersion and targetSdkVersion come first, in the resource map.
+const std::vector<std::string> pool_strings{"versionCode", "versionName", "minSdkVersion", "targetSdkVersion",
+                                            "package",     "manifest",    "uses-sdk",      long_package,
+                                            version_name};
+const std::vector<uint32_t> resource_ids{0x0101021b, 0x0101021c, 0x0101020c, 0x01010270};
+
+std::u16string to_utf16(const std::string& s) {
+  std::u16string out;
+  for (size_t i = 0; i < s.size();) {
+    const auto c = static_cast<uint8_t>(s[i]);
+    const size_t n = c < 0x80 ? 1 : c < 0xe0 ? 2 : c < 0xf0 ? 3 : 4;
+    uint32_t cp = n == 1 ? c : c & (0xff >> (n + 1));
+    for (size_t j = 1; j < n; j++) cp = (cp << 6) | (static_cast<uint8_t>(s[i + j]) & 0x3f);
+    i += n;
+    if (cp >= 0x10000) {
+      out.push_back(static_cast<char16_t>(0xd800 + ((cp - 0x10000) >> 10)));
+      out.push_back(static_cast<char16_t>(0xdc00 + ((cp - 0x10000) & 0x3ff)));
+    } else {
+      out.push_back(static_cast<char16_t>(cp));
+    }
+  }
+  return out;
+}
+
+// A length in the pool's one or two unit form, the high bit of the first unit flagging the second.
+template <class Unit>
+void append_pool_len(std::vector<uint8_t>& out, size_t len) {
+  constexpr size_t high_bit = size_t{1} << (sizeof(Unit) * 8 - 1);
+  if (len >= high_bit) append_le(out, static_cast<Unit>(high_bit | (len >> (sizeof(Unit) * 8))));
+  append_le(out, static_cast<Unit>(len & (high_bit * 2 - 1)));
+}
+
+std::vector<uint8_t> chunk(uint16_t type, uint16_t header_size, const std::vector<uint8_t>& header_rest,
+                           const std::vector<uint8_t>& body) {
+  std::vector<uint8_t> out;
+  append_le(out, type);
+  append_le(out, header_size);
+  append_le(out, static_cast<uint32_t>(8 + header_rest.size() + body.size()));
+  out.insert(out.end(), header_rest.cbegin(), header_rest.cend());
+  out.insert(out.end(), body.cbegin(), body.cend());
+  return out;
+}
+
+std::vector<uint8_t> string_pool_chunk(bool utf8) {
+  std::vector<uint8_t> offsets, data;
+  for (const auto& s : pool_strings) {
+    append_le(offsets, static_cast<uint32_t>(data.size()));
+    if (utf8) {
+      append_pool_len<uint8_t>(data, to_utf16(s).size());
+      append_pool_len<uint8_t>(data, s.size());
+      data.insert(data.end(), s.cbegin(), s.cend());
+      data.push_back(0);
+    } else {
+      const auto units = to_utf16(s);
+      append_pool_len<uint16_t>(data, units.size());
+      for (const auto unit : units) append_le(data, static_cast<uint16_t>(unit));
+      append_le(data, uint16_t{0});
+    }
+  }
+  data.resize((data.size() + 3) / 4 * 4);
+
+  std::vector<uint8_t> header;
+  append_le(header, static_cast<uint32_t>(pool_strings.size()));
+  append_le(header, uint32_t{0});  // style count
+  append_le(header, utf8 ? uint32_t{1 << 8} : uint32_t{0});
+  append_le(header, static_cast<uint32_t>(28 + offsets.size()));
+  append_le(header, uint32_t{0});  // styles start
+  offsets.insert(offsets.end(), data.cbegin(), data.cend());
+  return chunk(0x0001, 28, header, offsets);
+}
+
+struct attribute {
+  uint32_t name;
+  uint8_t type;
+  uint32_t data;
+};
+
+std::vector<uint8_t> start_element(uint32_t name, const std::vector<attribute>& attrs) {
+  std::vector<uint8_t> header;
+  append_le(header, uint32_t{1});           // line number
+  append_le(header, uint32_t{0xffffffff});  // comment
+  std::vector<uint8_t> body;
+  append_le(body, uint32_t{0xffffffff});  // namespace
+  append_le(body, name);
+  append_le(body, uint16_t{20});  // attribute start
+  append_le(body, uint16_t{20});  // attribute size
+  append_le(body, static_cast<uint16_t>(attrs.size()));
+  for (int i = 0; i < 3; i++) append_le(body, uint16_t{0});  // id, class and style indices
+  for (const auto& attr : attrs) {
+    append_le(body, uint32_t{0xffffffff});
+    append_le(body, attr.name);
+    append_le(body, attr.type == type_string ? attr.data : uint32_t{0xffffffff});
+    append_le(body, uint16_t{8});
+    body.push_back(0);
+    body.push_back(attr.type);
+    append_le(body, attr.data);
+  }
+  return chunk(0x0102, 16, header, body);
+}
+
+std::vector<uint8_t> binary_manifest(bool utf8) {
+  std::vector<uint8_t> ids;
+  for (const auto id : resource_ids) append_le(ids, id);
+  std::vector<uint8_t> body = string_pool_chunk(utf8);
+  for (const auto& c : {chunk(0x0180, 8, {}, ids),
+                        start_element(5, {{4, type_string, 7}, {0, type_int_dec, 42}, {1, type_string, 8}}),
+                        start_element(6, {{2, type_int_dec, 21}, {3, type_int_hex, 0x22}})}) {
+    body.insert(body.end(), c.cbegin(), c.cend());
+  }
+  return chunk(0x0003, 8, {}, body);
+}
+
+}  // namespace
+
+APKSIG_TEST(binary_manifest_string_pools) {
+  for (const bool utf8 : {true, false}) {
+    const auto xml = binary_manifest(utf8);
+    const auto info = parse_binary_manifest(xml.data(), xml.size());
+    CHECK(info.package == long_package);
+    CHECK(info.version_code == 42u);
+    CHECK(info.version_name == version_name);
+    CHECK(info.min_sdk_version == 21);
+    CHECK(info.target_sdk_version == 0x22);
+
+    const auto path = test::scratch_dir() / "app.apk";
+    test::write_zip(path, {{"AndroidManifest.xml", xml}, {"classes.dex", {0}}});
+    CHECK(read_manifest(path).package == long_package);
+
+    // Cut inside the document header, then inside the string pool.
+    CHECK_THROWS(parse_binary_manifest(xml.data(), 3), parse_error);
+    CHECK_THROWS(parse_binary_manifest(xml.data(), 100), parse_error);
+  }
+
+  const std::vector<uint8_t> not_xml{'<', '?', 'x', 'm', 'l', ' ', 'v', 'e'};
+  CHECK_THROWS(parse_binary_manifest(not_xml.data(), not_xml.size()), parse_error);
+}
@@ -0,0 +1,80 @@
+#include "apksig/probe.hpp"
+
+#include <string>
+
+#include "apksig/apksig.hpp"
+#include "apksig/sign.hpp"
+#include "signing_block_format.hpp"
+#include "test.hpp"
+#include "write_utils.hpp"
+
+namespace {
+
+using namespace apksig;
+
+// What probe() throws, or empty if it succeeds.
+std::string probe_error(const std::filesystem::path& path, size_t tail_size, const parse_limits& limits = {}) {
+  try {
+    probe(path, tail_size, limits);
+  } catch (const parse_error& e) {
+    return e.what();
+  }
+  return "";
+}
+
+std::string message_of(parse_errc code) { return parse_status{code, 0}.message(); }
+
+}  // namespace
+
+APKSIG_TEST(probe_matches_siginfo) {
+  const auto dir = test::scratch_dir();
+  test::write_unsigned_apk(dir / "unsigned.apk");
+  sign_apk(dir / "unsigned.apk", dir / "signed.apk", test::fixture_key());
+  siginfo info{dir / "signed.apk"};
+  info.parse();
+  const auto& sections = info.get_sections();
+
+  // With the whole block in the tail, and with only the EOCD record in it.
+  for (const size_t tail_size : {size_t{64 * 1024}, size_t{64}}) {
+    const auto result = probe(dir / "signed.apk", tail_size);
+    CHECK(result.has_signing_block);
+    CHECK(result.has_v2 && result.has_v3 && !result.has_v3_1 && !result.has_v4);
+    CHECK(result.signing_block_offset == sections.signing_block_offset);
+    CHECK(result.signing_block_size == sections.cd_offset - sections.signing_block_offset);
+    CHECK(result.pair_ids.size() == info.get_pairs().size());
+    for (size_t i = 0; i < result.pair_ids.size() && i < info.get_pairs().size(); i++) {
+      CHECK(result.pair_ids[i] == info.get_pairs()[i].id);
+    }
+  }
+
+  const auto unsigned_result = probe(dir / "unsigned.apk");
+  CHECK(!unsigned_result.has_signing_block && unsigned_result.pair_ids.empty());
+}
+
+APKSIG_TEST(probe_limits_and_sizes_agree_with_try_parse) {
+  const auto dir = test::scratch_dir();
+  test::write_unsigned_apk(dir / "unsigned.apk");
+  sign_apk(dir / "unsigned.apk", dir / "signed.apk", test::fixture_key());
+  siginfo info{dir / "signed.apk"};
+  info.parse();
+  const auto sections = info.get_sections();
+  const auto block_size = sections.cd_offset - sections.signing_block_offset;
+
+  for (const size_t tail_size : {size_t{64 * 1024}, size_t{64}}) {
+    parse_limits limits;
+    limits.max_block_size = block_size;
+    CHECK(probe(dir / "signed.apk", tail_size, limits).has_signing_block);
+    limits.max_block_size = block_size - 1;
+    CHECK(probe_error(dir / "signed.apk", tail_size, limits) == message_of(parse_errc::limit_exceeded));
+  }
+
+  // A leading size that disagrees with the footer's is rejected by both.
+  auto bytes = test::read_file(dir / "signed.apk");
+  detail::store_le<uint64_t>(bytes.data() + sections.signing_block_offset, block_size);
+  test::write_file(dir / "mismatch.apk", bytes);
+  siginfo mismatch{dir / "mismatch.apk"};
+  CHECK(mismatch.try_parse().code == parse_errc::bad_signing_block_size);
+  for (const size_t tail_size : {size_t{64 * 1024}, size_t{64}}) {
+    CHECK(probe_error(dir / "mismatch.apk", tail_size) == message_of(parse_errc::bad_signing_block_size));
+  }
+}
@@ -0,0 +1,102 @@
+#include "apksig/serialize.hpp"
+
+#include "apksig/apksig.hpp"
+#include "apksig/sign.hpp"
+#include "signing_block_format.hpp"
+#include "test.hpp"
+
+namespace {
+
+using namespace apksig;
+
+constexpr uint32_t unknown_pair_id = 0x12345678;
+
+bool same_bytes(byte_view view, const std::vector<uint8_t>& bytes) { return view.to_vector() == bytes; }
+
+template <class Element>
+bool same_elements(const std::vector<id_bytes_view>& views, const std::vector<Element>& elements,
+                   std::vector<uint8_t> Element::*bytes, uint32_t Element::*id) {
+  if (views.size() != elements.size()) return false;
+  for (size_t i = 0; i < views.size(); i++) {
+    if (views[i].id != elements[i].*id || !same_bytes(views[i].bytes, elements[i].*bytes)) return false;
+  }
+  return true;
+}
+
+template <class Signer>
+void check_signer(const signer_view& view, const Signer& signer) {
+  CHECK(same_bytes(view.signed_data, signer.signed_data_bytes));
+  CHECK(same_elements(view.digests, signer.signed_data.digests, &digest::digest_data, &digest::sig_algo_id));
+  CHECK(view.certificates.size() == signer.signed_data.certificates.size());
+  for (size_t i = 0; i < view.certificates.size() && i < signer.signed_data.certificates.size(); i++) {
+    CHECK(same_bytes(view.certificates[i], signer.signed_data.certificates[i]));
+  }
+  CHECK(same_elements(view.add_attrs, signer.signed_data.add_attrs, &add_attr::value, &add_attr::id));
+  CHECK(same_elements(view.signatures, signer.signatures, &signature::signature_data, &signature::sig_algo_id));
+  CHECK(same_bytes(view.public_key, signer.public_key));
+}
+
+}  // namespace
+
+APKSIG_TEST(serialized_view_matches_siginfo) {
+  const auto dir = test::scratch_dir();
+  test::write_unsigned_apk(dir / "unsigned.apk");
+  sign_options opts;
+  opts.extra_pairs.push_back({unknown_pair_id, {1, 2, 3}});
+  sign_apk(dir / "unsigned.apk", dir / "signed.apk", test::fixture_key(), opts);
+
+  siginfo info{dir / "signed.apk"};
+  info.parse();
+  const auto bytes = serialize_siginfo(info);
+  const siginfo_view view(bytes.data(), bytes.size());
+
+  const auto& sections = info.get_sections();
+  CHECK(view.sections().signing_block_offset == sections.signing_block_offset);
+  CHECK(view.sections().cd_offset == sections.cd_offset);
+  CHECK(view.sections().eocd_offset == sections.eocd_offset);
+  CHECK(view.sections().file_size == sections.file_size);
+
+  CHECK(view.pairs().size() == info.get_pairs().size());
+  for (size_t i = 0; i < view.pairs().size() && i < info.get_pairs().size(); i++) {
+    CHECK(view.pairs()[i].id == info.get_pairs()[i].id);
+    CHECK(view.pairs()[i].value_offset == info.get_pairs()[i].value_offset);
+    CHECK(view.pairs()[i].value_size == info.get_pairs()[i].value_size);
+  }
+  CHECK(same_bytes(view.pair_value(detail::v2_block_id), info.read_pair_value(*info.find_pair(detail::v2_block_id))));
+  // Only the blocks siginfo decodes are embedded.
+  CHECK(view.pair_value(unknown_pair_id).empty());
+
+  CHECK(view.has_v2_block() == info.has_v2_block());
+  CHECK(view.has_v3_block() == info.has_v3_block());
+  CHECK(view.has_v3_1_block() == info.has_v3_1_block());
+  CHECK(view.has_source_stamp() == info.has_source_stamp());
+
+  const auto v2_signers = view.v2_signers();
+  CHECK(v2_signers.size() == 1);
+  if (!v2_signers.empty()) check_signer(v2_signers[0], info.get_v2_block().signers.at(0));
+
+  const auto v3_signers = view.v3_signers();
+  CHECK(v3_signers.size() == 1);
+  if (!v3_signers.empty()) {
+    const auto& signer = info.get_v3_block().signers.at(0);
+    check_signer(v3_signers[0], signer);
+    CHECK(v3_signers[0].min_sdk == signer.min_sdk);
+    CHECK(v3_signers[0].max_sdk == signer.max_sdk);
+  }
+  CHECK(view.v3_1_signers().empty());
+}
+
+APKSIG_TEST(serialized_view_rejects_damaged_buffers) {
+  const auto dir = test::scratch_dir();
+  test::write_unsigned_apk(dir / "unsigned.apk");
+  sign_apk(dir / "unsigned.apk", dir / "signed.apk", test::fixture_key());
+  siginfo info{dir / "signed.apk"};
+  info.parse();
+  auto bytes = serialize_siginfo(info);
+
+  // Every truncation either leaves the header short or cuts off an embedded value.
+  for (size_t size = 0; size < bytes.size(); size += 7) CHECK_THROWS(siginfo_view(bytes.data(), size), parse_error);
+
+  bytes[0] ^= 0xff;
+  CHECK_THROWS(siginfo_view(bytes.data(), bytes.size()), parse_error);
+}
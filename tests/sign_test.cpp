@@ -0,0 +1,151 @@
+#include "apksig/sign.hpp"
+
+#include <fstream>
+
+#include "apksig/apksig.hpp"
+#include "apksig/central_directory.hpp"
+#include "apksig/signature.hpp"
+#include "apksig/verify.hpp"
+#include "read_utils.hpp"
+#include "test.hpp"
+#include "zip_format.hpp"
+
+namespace {
+
+using namespace apksig;
+
+bool all_valid(const std::vector<signature_status>& statuses) {
+  if (statuses.empty()) return false;
+  for (const auto status : statuses) {
+    if (status != signature_status::valid) return false;
+  }
+  return true;
+}
+
+// Parses apk and checks that both signers carry the fixture key and verify.
+void check_signed(const std::filesystem::path& apk) {
+  siginfo info{apk};
+  info.parse();
+  CHECK(info.has_v2_block());
+  CHECK(info.has_v3_block());
+  CHECK(!info.has_v3_1_block());
+
+  const auto& key = test::fixture_key();
+  const auto& v2 = info.get_v2_block();
+  CHECK(v2.signers.size() == 1);
+  const auto& v3 = info.get_v3_block();
+  CHECK(v3.signers.size() == 1);
+  if (v2.signers.size() != 1 || v3.signers.size() != 1) return;
+
+  const auto& v2_signer = v2.signers[0];
+  CHECK(v2_signer.public_key == key.public_key());
+  CHECK(v2_signer.signed_data.certificates == key.certificates());
+  CHECK(verify_contents(apk, info.get_sections(), v2_signer.signed_data).verified);
+
+  const auto& v3_signer = v3.signers[0];
+  CHECK(v3_signer.public_key == key.public_key());
+  CHECK(v3_signer.min_sdk == 28);
+  CHECK(verify_contents(apk, info.get_sections(), v3_signer.signed_data).verified);
+
+  signature_verifier verifier;
+  CHECK(all_valid(verifier.verify_batch(signature_requests(v2_signer))));
+  CHECK(all_valid(verifier.verify_batch(signature_requests(v3_signer))));
+}
+
+// Number of zipalign records in the local header extra field of entry.
+int alignment_record_count(const std::vector<uint8_t>& apk, const cd_entry& entry) {
+  const auto* header = apk.data() + entry.local_header_offset;
+  const auto name_len = detail::le_to_host<uint16_t>(header + detail::local_header_name_len_offset);
+  const auto extra_len = detail::le_to_host<uint16_t>(header + detail::local_header_extra_len_offset);
+  const auto* extra = header + detail::local_header_size + name_len;
+  int count = 0;
+  for (size_t pos = 0; pos + 4 <= extra_len;) {
+    if (detail::le_to_host<uint16_t>(extra + pos) == 0xd935) count++;
+    pos += 4 + size_t{detail::le_to_host<uint16_t>(extra + pos + 2)};
+  }
+  return count;
+}
+
+// Checks that every stored entry of apk starts at its alignment and has exactly one alignment
+// record, and that the contents are those of entries.
+void check_aligned(const std::filesystem::path& apk, const std::vector<test::zip_entry_spec>& entries) {
+  const auto bytes = test::read_file(apk);
+  const auto dir = central_directory::read(apk);
+  CHECK(dir.entries().size() == entries.size());
+  std::ifstream ifs(apk, std::ios_base::in | std::ios_base::binary);
+  ifs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+  for (const auto& spec : entries) {
+    const auto* entry = dir.find(spec.name);
+    CHECK(entry != nullptr);
+    if (entry == nullptr) continue;
+    CHECK(read_entry(ifs, *entry, dir.offset(), spec.data.size()) == spec.data);
+    if (entry->method != detail::method_stored) {
+      CHECK(alignment_record_count(bytes, *entry) == 0);
+      continue;
+    }
+    const bool native_library = spec.name.size() > 3 && spec.name.substr(spec.name.size() - 3) == ".so";
+    CHECK(entry_data_offset(ifs, *entry) % (native_library ? 16 * 1024 : 4) == 0);
+    CHECK(alignment_record_count(bytes, *entry) == 1);
+  }
+}
+
+}  // namespace
+
+APKSIG_TEST(sign_parse_verify) {
+  const auto dir = test::scratch_dir();
+  test::write_unsigned_apk(dir / "unsigned.apk");
+  sign_apk(dir / "unsigned.apk", dir / "signed.apk", test::fixture_key());
+  check_signed(dir / "signed.apk");
+
+  // Re-signing replaces the existing signing block.
+  sign_apk(dir / "signed.apk", dir / "resigned.apk", test::fixture_key());
+  check_signed(dir / "resigned.apk");
+  siginfo resigned{dir / "resigned.apk"};
+  resigned.parse();
+  CHECK(resigned.get_pairs().size() == 2);
+}
+
+APKSIG_TEST(tampering_is_detected) {
+  const auto dir = test::scratch_dir();
+  test::write_unsigned_apk(dir / "unsigned.apk");
+  sign_apk(dir / "unsigned.apk", dir / "signed.apk", test::fixture_key());
+
+  // One flipped byte in classes.dex.
+  auto bytes = test::read_file(dir / "signed.apk");
+  bytes[1024 * 1024] ^= 0x01;
+  test::write_file(dir / "tampered.apk", bytes);
+  siginfo info{dir / "tampered.apk"};
+  info.parse();
+  const auto& signer = info.get_v2_block().signers.at(0);
+  CHECK(!verify_contents(dir / "tampered.apk", info.get_sections(), signer.signed_data).verified);
+
+  // One flipped byte in the signed data.
+  auto signed_data = signer.signed_data_bytes;
+  signed_data[signed_data.size() / 2] ^= 0x01;
+  auto requests = signature_requests(signer);
+  for (auto& request : requests) request.data = signed_data.data();
+  signature_verifier verifier;
+  for (const auto status : verifier.verify_batch(requests)) CHECK(status == signature_status::invalid);
+}
+
+APKSIG_TEST(align_and_sign_aligns_stored_entries) {
+  const auto dir = test::scratch_dir();
+  std::vector<uint8_t> library(5000);
+  for (size_t i = 0; i < library.size(); i++) library[i] = static_cast<uint8_t>(i * 13);
+  // The odd sized entries put the stored ones after them off any alignment.
+  const std::vector<test::zip_entry_spec> entries{{"AndroidManifest.xml", {1, 2, 3}},
+                                                  test::deflated_text_entry("assets/bottles.txt"),
+                                                  {"lib/arm64-v8a/libx.so", library},
+                                                  {"res/raw/odd.bin", {4, 5, 6, 7, 8}},
+                                                  {"classes.dex", std::vector<uint8_t>(3 * 1024 * 1024 + 1, 0x5a)}};
+  test::write_zip(dir / "unaligned.apk", entries);
+
+  align_and_sign(dir / "unaligned.apk", dir / "aligned.apk", test::fixture_key());
+  check_signed(dir / "aligned.apk");
+  check_aligned(dir / "aligned.apk", entries);
+
+  // Re-aligning replaces the alignment records rather than adding to them.
+  align_and_sign(dir / "aligned.apk", dir / "realigned.apk", test::fixture_key());
+  check_signed(dir / "realigned.apk");
+  check_aligned(dir / "realigned.apk", entries);
+}
@@ -0,0 +1,160 @@
+#include "apksig/source_stamp.hpp"
+
+#include <algorithm>
+
+#include "apksig/cert_cache.hpp"
+#include "apksig/sign.hpp"
+#include "signing_block_format.hpp"
+#include "test.hpp"
+#include "write_utils.hpp"
+
+namespace {
+
+using namespace apksig;
+using detail::append_le;
+using detail::append_len_prefixed;
+
+constexpr uint32_t sig_algo_id = 0x0201;  // ECDSA with SHA2-256
+constexpr uint32_t stamp_time_attr_id = 0xe43c5946;
+
+std::vector<uint8_t> encode_seq(const std::vector<std::vector<uint8_t>>& elements) {
+  std::vector<uint8_t> body;
+  for (const auto& e : elements) append_len_prefixed(body, e);
+  std::vector<uint8_t> out;
+  append_len_prefixed(out, body);
+  return out;
+}
+
+// A sequence holding one signature of data by key.
+std::vector<uint8_t> encode_signature(const signing_key& key, const std::vector<uint8_t>& data) {
+  std::vector<uint8_t> signature;
+  append_le(signature, sig_algo_id);
+  append_len_prefixed(signature, key.sign(sig_algo_id, data.data(), data.size()));
+  return encode_seq({signature});
+}
+
+// The stamp's signed data for one scheme, encoded independently of the library: the digests
+// ordered by algorithm ID, each a length-prefixed (algorithm ID, length-prefixed digest) pair.
+std::vector<uint8_t> encode_scheme_digests(std::vector<content_digest> digests) {
+  std::sort(digests.begin(), digests.end(), [](const auto& a, const auto& b) { return a.algo < b.algo; });
+  std::vector<uint8_t> out;
+  for (const auto& d : digests) {
+    std::vector<uint8_t> record;
+    append_le(record, static_cast<uint32_t>(d.algo));
+    append_len_prefixed(record, d.digest_data);
+    append_len_prefixed(out, record);
+  }
+  return out;
+}
+
+// A SourceStamp block value signing schemes and a timestamp attribute with stamp_key.
+std::vector<uint8_t> encode_stamp(const signing_key& stamp_key, const std::vector<stamp_scheme_digests>& schemes) {
+  std::vector<uint8_t> signer;
+  append_len_prefixed(signer, stamp_key.certificates().front());
+  std::vector<std::vector<uint8_t>> signed_digests;
+  for (const auto& scheme : schemes) {
+    auto& element = signed_digests.emplace_back();
+    append_le(element, scheme.scheme_id);
+    const auto signature = encode_signature(stamp_key, encode_scheme_digests(scheme.digests));
+    element.insert(element.end(), signature.cbegin(), signature.cend());
+  }
+  const auto digests = encode_seq(signed_digests);
+  signer.insert(signer.end(), digests.cbegin(), digests.cend());
+
+  std::vector<uint8_t> attr;
+  append_le(attr, stamp_time_attr_id);
+  append_le(attr, uint64_t{1791936000});
+  const auto attrs = encode_seq({attr});
+  append_len_prefixed(signer, attrs);
+  const auto attr_signature = encode_signature(stamp_key, attrs);
+  signer.insert(signer.end(), attr_signature.cbegin(), attr_signature.cend());
+
+  std::vector<uint8_t> out;
+  append_len_prefixed(out, signer);
+  return out;
+}
+
+// Signs unsigned_apk into output with the fixture key and a stamp built from the digests it gets.
+// edit may change the stamp's inputs before it is encoded.
+template <class Edit>
+siginfo sign_stamped(const std::filesystem::path& unsigned_apk, const std::filesystem::path& output, Edit edit) {
+  sign_apk(unsigned_apk, output, test::fixture_key());
+  siginfo unstamped{output};
+  unstamped.parse();
+  auto schemes = stamp_digests(unstamped);
+  auto stamp = encode_stamp(test::previous_key(0), schemes);
+  edit(schemes, stamp);
+
+  sign_options opts;
+  opts.extra_pairs.push_back({detail::source_stamp_block_id, stamp});
+  sign_apk(unsigned_apk, output, test::fixture_key(), opts);
+  siginfo info{output};
+  info.parse();
+  return info;
+}
+
+}  // namespace
+
+APKSIG_TEST(source_stamp_verifies) {
+  const auto dir = test::scratch_dir();
+  test::write_unsigned_apk(dir / "unsigned.apk");
+  const auto info = sign_stamped(dir / "unsigned.apk", dir / "stamped.apk", [](auto&, auto&) {});
+
+  const auto schemes = stamp_digests(info);
+  CHECK(schemes.size() == 2 && schemes[0].scheme_id == 2 && schemes[1].scheme_id == 3);
+  CHECK(info.has_source_stamp());
+  CHECK(info.get_source_stamp().signed_digests.size() == 2);
+
+  const auto result = verify_source_stamp(info);
+  CHECK(result.verified);
+  CHECK(result.error.empty());
+  CHECK(result.certificate_sha256 == intern_certificate(test::previous_key(0).certificates().front())->sha256());
+
+  signature_verifier verifier;
+  CHECK(verify_source_stamp(info.get_source_stamp(), schemes, &verifier).verified);
+  // Checking a subset of the schemes is up to the caller.
+  CHECK(verify_source_stamp(info.get_source_stamp(), {schemes.back()}, &verifier).verified);
+}
+
+APKSIG_TEST(source_stamp_failures) {
+  const auto dir = test::scratch_dir();
+  test::write_unsigned_apk(dir / "unsigned.apk");
+
+  // The stamp signed other v3 digests.
+  auto info = sign_stamped(dir / "unsigned.apk", dir / "wrong_digest.apk", [](auto& schemes, auto& stamp) {
+    schemes.back().digests.front().digest_data[0] ^= 1;
+    stamp = encode_stamp(test::previous_key(0), schemes);
+  });
+  auto result = verify_source_stamp(info);
+  CHECK(!result.verified);
+  CHECK(result.error.find("scheme 3") != std::string::npos);
+
+  // The stamp only covers v2.
+  info = sign_stamped(dir / "unsigned.apk", dir / "v2_only.apk", [](auto& schemes, auto& stamp) {
+    schemes.pop_back();
+    stamp = encode_stamp(test::previous_key(0), schemes);
+  });
+  result = verify_source_stamp(info);
+  CHECK(!result.verified);
+  CHECK(result.error.find("no signature for scheme 3") != std::string::npos);
+
+  // One flipped byte in the last attribute signature.
+  info = sign_stamped(dir / "unsigned.apk", dir / "bad_attr.apk",
+                      [](auto&, auto& stamp) { stamp[stamp.size() - 5] ^= 1; });
+  result = verify_source_stamp(info);
+  CHECK(!result.verified);
+  CHECK(result.error.find("attribute") != std::string::npos);
+
+  // The certificate isn't X.509.
+  auto stamp = info.get_source_stamp();
+  stamp.stamp_certificate = {0x30, 0x03, 0x02, 0x01, 0x01};
+  result = verify_source_stamp(stamp, stamp_digests(info));
+  CHECK(!result.verified);
+  CHECK(result.error.find("does not parse") != std::string::npos);
+
+  sign_apk(dir / "unsigned.apk", dir / "unstamped.apk", test::fixture_key());
+  siginfo unstamped{dir / "unstamped.apk"};
+  unstamped.parse();
+  CHECK(!unstamped.has_source_stamp());
+  CHECK(!verify_source_stamp(unstamped).verified);
+}
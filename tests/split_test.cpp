@@ -0,0 +1,168 @@
+#include "apksig/split.hpp"
+
+#include "apksig/cert_cache.hpp"
+#include "apksig/sign.hpp"
+#include "signing_block_format.hpp"
+#include "test.hpp"
+#include "write_utils.hpp"
+
+namespace {
+
+using namespace apksig;
+using detail::append_le;
+using detail::append_len_prefixed;
+
+constexpr uint32_t proof_of_rotation_attr_id = 0x3ba06f8c;
+constexpr uint32_t sig_algo_id = 0x0201;  // ECDSA with SHA2-256
+
+std::vector<uint8_t> encode_seq(const std::vector<std::vector<uint8_t>>& elements) {
+  std::vector<uint8_t> body;
+  for (const auto& e : elements) append_len_prefixed(body, e);
+  std::vector<uint8_t> out;
+  append_len_prefixed(out, body);
+  return out;
+}
+
+// A proof-of-rotation attribute value over keys, oldest first. Each node is signed by the key before
+// it.
+std::vector<uint8_t> encode_lineage(const std::vector<const signing_key*>& keys) {
+  std::vector<uint8_t> out;
+  append_le(out, uint32_t{1});
+  for (size_t i = 0; i < keys.size(); i++) {
+    std::vector<uint8_t> signed_data;
+    append_len_prefixed(signed_data, keys[i]->certificates().front());
+    append_le(signed_data, i == 0 ? uint32_t{0} : sig_algo_id);
+    std::vector<uint8_t> node;
+    append_len_prefixed(node, signed_data);
+    append_le(node, uint32_t{1});  // installed data
+    append_le(node, sig_algo_id);
+    append_len_prefixed(node, i == 0 ? std::vector<uint8_t>{}
+                                     : keys[i - 1]->sign(sig_algo_id, signed_data.data(), signed_data.size()));
+    append_len_prefixed(out, node);
+  }
+  return out;
+}
+
+// Signs input with v2 and with a v3 signer carrying the lineage attribute, which sign_apk() has no
+// option for. The v3 signer reuses the content digest of the v2 one.
+void sign_with_lineage(const std::filesystem::path& input, const std::filesystem::path& output,
+                       const std::vector<uint8_t>& lineage) {
+  const auto& key = test::fixture_key();
+  sign_options opts;
+  opts.v3 = false;
+  sign_apk(input, output, key, opts);
+  siginfo info{output};
+  info.parse();
+  const auto& digest = info.get_v2_block().signers.at(0).signed_data.digests.at(0);
+
+  std::vector<uint8_t> digest_record;
+  append_le(digest_record, digest.sig_algo_id);
+  append_len_prefixed(digest_record, digest.digest_data);
+  std::vector<uint8_t> sdk_range;
+  append_le(sdk_range, uint32_t{28});
+  append_le(sdk_range, uint32_t{0x7fffffff});
+  std::vector<uint8_t> attr;
+  append_le(attr, proof_of_rotation_attr_id);
+  attr.insert(attr.end(), lineage.cbegin(), lineage.cend());
+
+  std::vector<uint8_t> signed_data = encode_seq({digest_record});
+  const auto certs = encode_seq(key.certificates());
+  signed_data.insert(signed_data.end(), certs.cbegin(), certs.cend());
+  signed_data.insert(signed_data.end(), sdk_range.cbegin(), sdk_range.cend());
+  const auto attrs = encode_seq({attr});
+  signed_data.insert(signed_data.end(), attrs.cbegin(), attrs.cend());
+
+  std::vector<uint8_t> signature;
+  append_le(signature, sig_algo_id);
+  append_len_prefixed(signature, key.sign(sig_algo_id, signed_data.data(), signed_data.size()));
+  std::vector<uint8_t> signer;
+  append_len_prefixed(signer, signed_data);
+  signer.insert(signer.end(), sdk_range.cbegin(), sdk_range.cend());
+  const auto signatures = encode_seq({signature});
+  signer.insert(signer.end(), signatures.cbegin(), signatures.cend());
+  append_len_prefixed(signer, key.public_key());
+
+  opts.extra_pairs.push_back({detail::v3_block_id, encode_seq({signer})});
+  sign_apk(input, output, key, opts);
+}
+
+std::array<uint8_t, 32> certificate_sha256(const signing_key& key) {
+  return intern_certificate(key.certificates().front())->sha256();
+}
+
+}  // namespace
+
+APKSIG_TEST(split_set_lineages) {
+  const auto dir = test::scratch_dir();
+  test::write_unsigned_apk(dir / "unsigned.apk");
+  const auto& key = test::fixture_key();
+  const auto& old_key = test::previous_key(0);
+  const auto& other_old_key = test::previous_key(1);
+
+  sign_with_lineage(dir / "unsigned.apk", dir / "base.apk", encode_lineage({&old_key, &key}));
+  sign_apk(dir / "unsigned.apk", dir / "plain.apk", key);
+  sign_with_lineage(dir / "unsigned.apk", dir / "longer.apk", encode_lineage({&other_old_key, &old_key, &key}));
+
+  auto report = verify_split_set({dir / "base.apk", dir / "plain.apk", dir / "longer.apk"});
+  CHECK(report.consistent);
+  CHECK(report.verified);
+  CHECK(report.lineages_compatible);
+  CHECK(report.splits.size() == 3);
+  if (report.splits.size() == 3) {
+    const auto& base = report.splits[0];
+    CHECK(base.error.empty());
+    CHECK(base.scheme == 3);
+    CHECK(base.lineage.size() == 2);
+    if (base.lineage.size() == 2) {
+      CHECK(base.lineage[0].certificate_sha256 == certificate_sha256(old_key));
+      CHECK(base.lineage[0].flags == 1);
+      CHECK(base.lineage[1].certificate_sha256 == certificate_sha256(key));
+    }
+    CHECK(report.splits[1].lineage.empty());
+    CHECK(report.splits[1].matches_base);
+    CHECK(report.splits[2].lineage.size() == 3);
+    CHECK(report.splits[2].matches_base);
+  }
+
+  // Same signer, but the lineages fork before it.
+  sign_with_lineage(dir / "unsigned.apk", dir / "forked.apk", encode_lineage({&other_old_key, &key}));
+  report = verify_split_set({dir / "base.apk", dir / "forked.apk"});
+  CHECK(!report.lineages_compatible);
+  CHECK(!report.consistent);
+  CHECK(report.splits.size() == 2 && report.splits[1].matches_base);
+
+  // Signed by another key.
+  sign_apk(dir / "unsigned.apk", dir / "other.apk", old_key);
+  report = verify_split_set({dir / "base.apk", dir / "other.apk"});
+  CHECK(!report.consistent);
+  CHECK(report.splits.size() == 2 && !report.splits[1].matches_base);
+}
+
+APKSIG_TEST(split_set_rejects_bad_lineages) {
+  const auto dir = test::scratch_dir();
+  test::write_unsigned_apk(dir / "unsigned.apk");
+  const auto& key = test::fixture_key();
+  const auto& old_key = test::previous_key(0);
+
+  // The rotation signature doesn't verify: the split parses but isn't verified.
+  auto lineage = encode_lineage({&old_key, &key});
+  lineage[lineage.size() - 10] ^= 1;
+  sign_with_lineage(dir / "unsigned.apk", dir / "bad_signature.apk", lineage);
+  auto report = verify_split_set({dir / "bad_signature.apk"});
+  CHECK(report.consistent);
+  CHECK(!report.verified);
+  CHECK(report.splits.size() == 1 && report.splits[0].error.empty() && !report.splits[0].verified);
+
+  // Doesn't end with the signing certificate, repeats a certificate, or is cut short.
+  lineage = encode_lineage({&key, &old_key});
+  sign_with_lineage(dir / "unsigned.apk", dir / "wrong_end.apk", lineage);
+  sign_with_lineage(dir / "unsigned.apk", dir / "duplicate.apk", encode_lineage({&key, &old_key, &key}));
+  lineage = encode_lineage({&old_key, &key});
+  lineage.resize(lineage.size() - 1);
+  sign_with_lineage(dir / "unsigned.apk", dir / "truncated.apk", lineage);
+  for (const auto* name : {"wrong_end.apk", "duplicate.apk", "truncated.apk"}) {
+    report = verify_split_set({dir / name});
+    CHECK(!report.consistent);
+    CHECK(report.splits.size() == 1 && !report.splits[0].error.empty());
+  }
+}
@@ -0,0 +1,76 @@
+#include "apksig/stream.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+#include "apksig/sign.hpp"
+#include "apksig/verify.hpp"
+#include "test.hpp"
+
+namespace {
+
+using namespace apksig;
+
+// Feeds bytes to a stream_parser in odd sized pieces.
+stream_result parse_in_pieces(const std::vector<uint8_t>& bytes, const stream_options& opts) {
+  stream_parser parser(opts);
+  for (size_t pos = 0; pos < bytes.size(); pos += 100003) {
+    parser.update(bytes.data() + pos, std::min<size_t>(100003, bytes.size() - pos));
+  }
+  return parser.finish();
+}
+
+}  // namespace
+
+APKSIG_TEST(stream_parser_matches_siginfo) {
+  const auto dir = test::scratch_dir();
+  test::write_unsigned_apk(dir / "unsigned.apk");
+  sign_apk(dir / "unsigned.apk", dir / "signed.apk", test::fixture_key());
+  const auto bytes = test::read_file(dir / "signed.apk");
+
+  siginfo info{dir / "signed.apk"};
+  info.parse();
+  const auto& sections = info.get_sections();
+  content_digest_options digest_opts;
+  digest_opts.algos = {content_digest_algo::chunked_sha256, content_digest_algo::chunked_sha512};
+  const auto expected = compute_content_digests(dir / "signed.apk", sections, digest_opts).digests;
+
+  stream_options opts;
+  opts.max_tail_size = 64 * 1024;
+  opts.digest_algos = digest_opts.algos;
+  std::istringstream is(std::string(bytes.cbegin(), bytes.cend()));
+  for (const auto& result : {parse_in_pieces(bytes, opts), parse_stream(is, opts)}) {
+    CHECK(result.size == bytes.size());
+    const auto& streamed = result.info.get_sections();
+    CHECK(streamed.signing_block_offset == sections.signing_block_offset);
+    CHECK(streamed.cd_offset == sections.cd_offset);
+    CHECK(streamed.eocd_offset == sections.eocd_offset);
+    CHECK(streamed.file_size == sections.file_size);
+    CHECK(result.info.get_v2_block().signers.at(0).signed_data_bytes ==
+          info.get_v2_block().signers.at(0).signed_data_bytes);
+
+    CHECK(result.content_digests.size() == expected.size());
+    for (size_t i = 0; i < result.content_digests.size() && i < expected.size(); i++) {
+      CHECK(result.content_digests[i].algo == expected[i].algo);
+      CHECK(result.content_digests[i].digest_data == expected[i].digest_data);
+    }
+  }
+
+  // No digests requested, none computed.
+  opts.digest_algos.clear();
+  CHECK(parse_in_pieces(bytes, opts).content_digests.empty());
+}
+
+APKSIG_TEST(stream_parser_tail_too_small) {
+  // The signing block starts just before the first chunk boundary and ends after it.
+  const auto dir = test::scratch_dir();
+  test::write_zip(dir / "unsigned.apk", {{"classes.dex", std::vector<uint8_t>(chunked_digester::chunk_size - 1000)}});
+  sign_apk(dir / "unsigned.apk", dir / "signed.apk", test::fixture_key());
+  const auto bytes = test::read_file(dir / "signed.apk");
+
+  stream_options opts;
+  opts.max_tail_size = 1;
+  CHECK_THROWS(parse_in_pieces(bytes, opts), parse_error);
+  opts.max_tail_size = bytes.size();
+  CHECK(parse_in_pieces(bytes, opts).info.has_v2_block());
+}
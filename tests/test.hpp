@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "apksig/key.hpp"
+
+// A minimal test registry. APKSIG_TEST(name) defines a test; CHECK records a failure and carries
+// on, so one run reports every broken expectation of a test.
+namespace apksig::test {
+
+struct test_case {
+  const char* name;
+  void (*run)();
+};
+
+std::vector<test_case>& registry();
+
+struct registrar {
+  registrar(const char* name, void (*run)()) { registry().push_back({name, run}); }
+};
+
+void record_failure(const char* file, int line, const std::string& what);
+
+// A directory of its own for the running test, emptied before the test starts.
+std::filesystem::path scratch_dir();
+
+// The self-signed P-256 fixture key and certificate.
+const signing_key& fixture_key();
+// Two more self-signed P-256 keys, for rotation lineages and SourceStamps. i is 0 or 1.
+const signing_key& previous_key(size_t i);
+
+struct zip_entry_spec {
+  std::string name;
+  std::vector<uint8_t> data;
+  // The raw DEFLATE stream of data for a deflated entry, empty for a stored one.
+  std::vector<uint8_t> deflated = {};
+};
+
+// Writes an unsigned ZIP of the entries in order.
+void write_zip(const std::filesystem::path& path, const std::vector<zip_entry_spec>& entries);
+
+// Decodes a string of hex digit pairs.
+std::vector<uint8_t> from_hex(std::string_view hex);
+
+// A deflated text entry, compressed by zlib at level 9 into one dynamic block with matches.
+zip_entry_spec deflated_text_entry(const std::string& name);
+
+// An unsigned APK with an AndroidManifest.xml stand-in and a classes.dex spanning several 1 MiB
+// content chunks.
+void write_unsigned_apk(const std::filesystem::path& path);
+
+std::vector<uint8_t> read_file(const std::filesystem::path& path);
+void write_file(const std::filesystem::path& path, const std::vector<uint8_t>& bytes);
+
+}  // namespace apksig::test
+
+#define APKSIG_TEST(name)                                                \
+  static void name();                                                    \
+  static const ::apksig::test::registrar name##_registrar{#name, name}; \
+  static void name()
+
+#define CHECK(expr) \
+  ((expr) ? void() : ::apksig::test::record_failure(__FILE__, __LINE__, "CHECK(" #expr ") failed"))
+
+#define CHECK_THROWS(expr, exception)                                                                     \
+  do {                                                                                                    \
+    bool thrown_ = false;                                                                                 \
+    try {                                                                                                 \
+      (void)(expr);                                                                                       \
+    } catch (const exception&) {                                                                          \
+      thrown_ = true;                                                                                     \
+    }                                                                                                     \
+    if (!thrown_) ::apksig::test::record_failure(__FILE__, __LINE__, #expr " did not throw " #exception); \
+  } while (false)
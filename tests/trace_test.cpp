@@ -0,0 +1,32 @@
+#include "apksig/trace.hpp"
+
+#include <sstream>
+#include <thread>
+
+#include "test.hpp"
+#include "trace.hpp"
+
+using namespace apksig;
+
+APKSIG_TEST(clear_trace_drops_recorded_events) {
+  const auto trace = [] {
+    std::ostringstream os;
+    write_chrome_trace(os);
+    return os.str();
+  };
+
+  clear_trace();
+  std::thread([] {
+    // More than one block's worth, so overflow blocks get released too.
+    for (int i = 0; i < 5000; i++) detail::scoped_trace(trace_phase::signature_verify, 1);
+  }).join();
+  CHECK((trace().find("signature_verify") != std::string::npos) == tracing_enabled());
+  // Writing leaves the events in place.
+  CHECK((trace().find("signature_verify") != std::string::npos) == tracing_enabled());
+
+  clear_trace();
+  CHECK(trace().find("signature_verify") == std::string::npos);
+  { const detail::scoped_trace t(trace_phase::eocd_search); }
+  CHECK((trace().find("eocd_search") != std::string::npos) == tracing_enabled());
+  clear_trace();
+}
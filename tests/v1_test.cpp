@@ -0,0 +1,136 @@
+#include "apksig/v1.hpp"
+
+#include <string_view>
+
+#include "test.hpp"
+
+namespace {
+
+using namespace apksig;
+
+// A JAR signature over the entries of fixture_entries(), signed by the fixture key the way jarsigner
+// signs: a detached PKCS #7 SignedData over CERT.SF with SHA-256 and no signed attributes.
+constexpr std::string_view manifest_mf =
+    "Manifest-Version: 1.0\r\n"
+    "Created-By: 1.0 (apksig tests)\r\n"
+    "\r\n"
+    "Name: AndroidManifest.xml\r\n"
+    "SHA-256-Digest: 5XaZnz+NLvIFEk7VlFLi7xyAsmOKEZVj0wDTZQA4EJk=\r\n"
+    "\r\n"
+    "Name: assets/bottles.txt\r\n"
+    "SHA-256-Digest: EOumP6ueXfcRA92NcWltucAH0E0Dq84tQ8ohPGlahAM=\r\n"
+    "\r\n"
+    "Name: res/raw/data.bin\r\n"
+    "SHA-256-Digest: BHc/hybIHK/PoaCagmZLmLANICEDGhcVvKEVTy2tNHI=\r\n"
+    "\r\n";
+
+constexpr std::string_view cert_sf =
+    "Signature-Version: 1.0\r\n"
+    "SHA-256-Digest-Manifest-Main-Attributes: mcx0nK4zDU5WX8zO9KjV81EfQuGXdWMMeq3QohtLDXg=\r\n"
+    "SHA-256-Digest-Manifest: cn5f/1IP/X4T4l8btDKxTUrTI52nkRoO3kSaEzx4IyY=\r\n"
+    "Created-By: 1.0 (apksig tests)\r\n"
+    "\r\n"
+    "Name: AndroidManifest.xml\r\n"
+    "SHA-256-Digest: cPno1kcHuPkYcmKnSyKC8SO78mdWEAtSUaodX/k9aoU=\r\n"
+    "\r\n"
+    "Name: assets/bottles.txt\r\n"
+    "SHA-256-Digest: 8CKV/8zStlKhNnmwGw7HV0ts6xIKWoBUp2L0JKTDuL8=\r\n"
+    "\r\n"
+    "Name: res/raw/data.bin\r\n"
+    "SHA-256-Digest: 8gJOz1kSCUqD9Djpzc1XLYsecJ6adEsD4YjKXjdP09o=\r\n"
+    "\r\n";
+
+const std::vector<uint8_t> cert_ec{
+    0x30, 0x82, 0x02, 0x57, 0x06, 0x09, 0x2a, 0x86, 0x48, 0x86, 0xf7, 0x0d, 0x01, 0x07, 0x02, 0xa0,
+    0x82, 0x02, 0x48, 0x30, 0x82, 0x02, 0x44, 0x02, 0x01, 0x01, 0x31, 0x0d, 0x30, 0x0b, 0x06, 0x09,
+    0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x01, 0x30, 0x0b, 0x06, 0x09, 0x2a, 0x86, 0x48,
+    0x86, 0xf7, 0x0d, 0x01, 0x07, 0x01, 0xa0, 0x82, 0x01, 0x87, 0x30, 0x82, 0x01, 0x83, 0x30, 0x82,
+    0x01, 0x29, 0xa0, 0x03, 0x02, 0x01, 0x02, 0x02, 0x14, 0x77, 0x92, 0xd3, 0x56, 0x75, 0xd8, 0x1c,
+    0x14, 0x68, 0xd1, 0xfa, 0x4f, 0xdf, 0x51, 0x0f, 0x6a, 0xae, 0xde, 0x61, 0xc4, 0x30, 0x0a, 0x06,
+    0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x04, 0x03, 0x02, 0x30, 0x16, 0x31, 0x14, 0x30, 0x12, 0x06,
+    0x03, 0x55, 0x04, 0x03, 0x0c, 0x0b, 0x61, 0x70, 0x6b, 0x73, 0x69, 0x67, 0x20, 0x74, 0x65, 0x73,
+    0x74, 0x30, 0x20, 0x17, 0x0d, 0x32, 0x36, 0x31, 0x30, 0x31, 0x36, 0x31, 0x33, 0x33, 0x32, 0x34,
+    0x32, 0x5a, 0x18, 0x0f, 0x32, 0x31, 0x32, 0x36, 0x30, 0x39, 0x32, 0x32, 0x31, 0x33, 0x33, 0x32,
+    0x34, 0x32, 0x5a, 0x30, 0x16, 0x31, 0x14, 0x30, 0x12, 0x06, 0x03, 0x55, 0x04, 0x03, 0x0c, 0x0b,
+    0x61, 0x70, 0x6b, 0x73, 0x69, 0x67, 0x20, 0x74, 0x65, 0x73, 0x74, 0x30, 0x59, 0x30, 0x13, 0x06,
+    0x07, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x02, 0x01, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x03,
+    0x01, 0x07, 0x03, 0x42, 0x00, 0x04, 0x77, 0x69, 0x49, 0xf7, 0xc1, 0xe1, 0x89, 0x43, 0x46, 0x71,
+    0x5d, 0x7e, 0x3b, 0x75, 0x3e, 0xcf, 0x32, 0x94, 0x1f, 0x04, 0x57, 0xdc, 0x8a, 0x7e, 0xd0, 0xa4,
+    0xcf, 0xb1, 0xd7, 0xb8, 0xec, 0xaf, 0x81, 0xce, 0x92, 0x8d, 0x76, 0x35, 0xaa, 0x47, 0x37, 0xab,
+    0x38, 0xe3, 0x7e, 0x23, 0x29, 0x8d, 0x6f, 0xdd, 0x1a, 0xf4, 0x3b, 0xdc, 0x14, 0x73, 0x81, 0x18,
+    0x8a, 0x2a, 0x34, 0xc4, 0xdd, 0x34, 0xa3, 0x53, 0x30, 0x51, 0x30, 0x1d, 0x06, 0x03, 0x55, 0x1d,
+    0x0e, 0x04, 0x16, 0x04, 0x14, 0xef, 0x71, 0x60, 0x59, 0xb3, 0xec, 0x46, 0x1e, 0xa3, 0x64, 0xdc,
+    0xaa, 0x4e, 0xa8, 0xcd, 0xa0, 0x82, 0xa3, 0x96, 0x07, 0x30, 0x1f, 0x06, 0x03, 0x55, 0x1d, 0x23,
+    0x04, 0x18, 0x30, 0x16, 0x80, 0x14, 0xef, 0x71, 0x60, 0x59, 0xb3, 0xec, 0x46, 0x1e, 0xa3, 0x64,
+    0xdc, 0xaa, 0x4e, 0xa8, 0xcd, 0xa0, 0x82, 0xa3, 0x96, 0x07, 0x30, 0x0f, 0x06, 0x03, 0x55, 0x1d,
+    0x13, 0x01, 0x01, 0xff, 0x04, 0x05, 0x30, 0x03, 0x01, 0x01, 0xff, 0x30, 0x0a, 0x06, 0x08, 0x2a,
+    0x86, 0x48, 0xce, 0x3d, 0x04, 0x03, 0x02, 0x03, 0x48, 0x00, 0x30, 0x45, 0x02, 0x21, 0x00, 0xae,
+    0x69, 0xd2, 0xe0, 0x09, 0x78, 0xe6, 0x6a, 0x8a, 0xb1, 0x02, 0x8f, 0x1f, 0x2c, 0xec, 0xd3, 0x64,
+    0x6e, 0x4a, 0xc4, 0x7a, 0xbc, 0xc7, 0x84, 0xdd, 0x34, 0x71, 0x7f, 0x67, 0xa3, 0xfa, 0xa6, 0x02,
+    0x20, 0x5d, 0xd3, 0xbb, 0x1d, 0xe3, 0x1a, 0x1b, 0x45, 0x6b, 0x14, 0xe3, 0x7e, 0x99, 0x75, 0x0c,
+    0xeb, 0x15, 0x5c, 0xf5, 0x3c, 0xca, 0x0f, 0xee, 0x2c, 0x25, 0xf2, 0xa7, 0x9b, 0x70, 0x36, 0xf7,
+    0x86, 0x31, 0x81, 0x97, 0x30, 0x81, 0x94, 0x02, 0x01, 0x01, 0x30, 0x2e, 0x30, 0x16, 0x31, 0x14,
+    0x30, 0x12, 0x06, 0x03, 0x55, 0x04, 0x03, 0x0c, 0x0b, 0x61, 0x70, 0x6b, 0x73, 0x69, 0x67, 0x20,
+    0x74, 0x65, 0x73, 0x74, 0x02, 0x14, 0x77, 0x92, 0xd3, 0x56, 0x75, 0xd8, 0x1c, 0x14, 0x68, 0xd1,
+    0xfa, 0x4f, 0xdf, 0x51, 0x0f, 0x6a, 0xae, 0xde, 0x61, 0xc4, 0x30, 0x0b, 0x06, 0x09, 0x60, 0x86,
+    0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x01, 0x30, 0x0a, 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d,
+    0x04, 0x03, 0x02, 0x04, 0x46, 0x30, 0x44, 0x02, 0x20, 0x16, 0xb8, 0x24, 0x4e, 0x01, 0x61, 0xc2,
+    0x1f, 0xcc, 0x90, 0x9a, 0x1e, 0xda, 0x61, 0x41, 0x23, 0x4a, 0x66, 0x75, 0x33, 0x66, 0x08, 0x7c,
+    0xc1, 0x46, 0x93, 0x51, 0x0b, 0x77, 0x43, 0x6c, 0x9d, 0x02, 0x20, 0x78, 0xc4, 0x0f, 0xa9, 0x8e,
+    0xed, 0x93, 0xb3, 0xcd, 0x25, 0x68, 0xc9, 0xa2, 0x33, 0x4a, 0x66, 0x7e, 0xfa, 0x9d, 0x42, 0x35,
+    0x02, 0x69, 0x23, 0xf8, 0x1f, 0x3e, 0x86, 0x81, 0xc5, 0x2e, 0x6c,
+};
+
+std::vector<uint8_t> to_bytes(std::string_view s) { return {s.cbegin(), s.cend()}; }
+
+std::vector<test::zip_entry_spec> fixture_entries() {
+  std::vector<uint8_t> data;
+  for (int i = 0; i < 300; i++) data.push_back(static_cast<uint8_t>(i * 7 + 3));
+  return {{"AndroidManifest.xml", to_bytes("not binary XML")},
+          test::deflated_text_entry("assets/bottles.txt"),
+          {"res/raw/data.bin", data}};
+}
+
+v1_verify_result verify_fixture(std::vector<test::zip_entry_spec> entries, std::string_view sf = cert_sf) {
+  entries.insert(entries.begin(), {{"META-INF/MANIFEST.MF", to_bytes(manifest_mf)},
+                                   {"META-INF/CERT.SF", to_bytes(sf)},
+                                   {"META-INF/CERT.EC", cert_ec}});
+  const auto path = test::scratch_dir() / "v1.apk";
+  test::write_zip(path, entries);
+  return verify_v1(path);
+}
+
+}  // namespace
+
+APKSIG_TEST(v1_verifies_signed_jar) {
+  const auto result = verify_fixture(fixture_entries());
+  CHECK(result.present);
+  CHECK(result.verified);
+  CHECK(result.signers.size() == 1);
+  if (!result.signers.empty()) {
+    CHECK(result.signers[0].name == "CERT");
+    CHECK(result.signers[0].signature_verified);
+    CHECK(result.signers[0].manifest_verified);
+    CHECK(result.signers[0].certificate == test::fixture_key().certificates().at(0));
+  }
+  CHECK(result.entries.size() == 3);
+  for (const auto& entry : result.entries) CHECK(entry.verified);
+}
+
+APKSIG_TEST(v1_detects_tampered_entry) {
+  auto entries = fixture_entries();
+  entries[2].data[150] ^= 1;
+  const auto result = verify_fixture(entries);
+  CHECK(!result.verified);
+  CHECK(result.signers.size() == 1 && result.signers[0].signature_verified);
+  CHECK(result.entries.size() == 3);
+  for (const auto& entry : result.entries) CHECK(entry.verified == (entry.name != "res/raw/data.bin"));
+}
+
+APKSIG_TEST(v1_detects_tampered_signature_file) {
+  std::string sf(cert_sf);
+  sf[sf.find("1.0 (apksig tests)")] = '2';
+  const auto result = verify_fixture(fixture_entries(), sf);
+  CHECK(!result.verified);
+  CHECK(result.signers.size() == 1 && !result.signers[0].signature_verified);
+}
@@ -0,0 +1,115 @@
+#include "apksig/v4.hpp"
+
+#include <sstream>
+#include <utility>
+
+#include "apksig/apksig.hpp"
+#include "apksig/sign.hpp"
+#include "apksig/verity.hpp"
+#include "sha.hpp"
+#include "test.hpp"
+
+using namespace apksig;
+
+namespace {
+
+// Like the path overload, reading past the end throws.
+v4_signature parse_v4_bytes(const std::vector<uint8_t>& bytes) {
+  std::istringstream is(std::string(bytes.cbegin(), bytes.cend()));
+  is.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+  return parse_v4_signature(is);
+}
+
+}  // namespace
+
+APKSIG_TEST(v4_apk_digest_prefers_v3) {
+  const auto dir = test::scratch_dir();
+  test::write_unsigned_apk(dir / "unsigned.apk");
+
+  sign_options opts;
+  for (const auto& [v2, v3] : {std::pair{false, true}, std::pair{true, false}, std::pair{true, true}}) {
+    opts.v2 = v2;
+    opts.v3 = v3;
+    // SHA-512 is preferred over SHA-256 whichever order the signer lists them in.
+    for (const auto& sig_algo_ids : {std::vector<uint32_t>{0x0201, 0x0202}, std::vector<uint32_t>{0x0202, 0x0201}}) {
+      opts.sig_algo_ids = sig_algo_ids;
+      sign_apk(dir / "unsigned.apk", dir / "signed.apk", test::fixture_key(), opts);
+      siginfo info{dir / "signed.apk"};
+      info.parse();
+      const auto& digests = v3 ? info.get_v3_block().signers.at(0).signed_data.digests
+                               : info.get_v2_block().signers.at(0).signed_data.digests;
+
+      const auto sig = generate_v4_signature(dir / "signed.apk", test::fixture_key(), 2);
+      bool found = false;
+      for (const auto& d : digests) {
+        if (d.sig_algo_id == 0x0202) found = sig.signing_info.apk_digest == d.digest_data;
+      }
+      CHECK(found);
+      CHECK(verify_v4_merkle_tree(dir / "signed.apk", sig, 2));
+    }
+  }
+
+  CHECK_THROWS(generate_v4_signature(dir / "unsigned.apk", test::fixture_key()), parse_error);
+}
+
+APKSIG_TEST(v4_idsig_known_answer) {
+  // Version 2; SHA-256 over 4 KiB blocks, no salt, a root hash of 0x11s; a signing info followed
+  // by 4 bytes of further signing info blocks; an 8 byte tree.
+  const auto bytes = test::from_hex(
+      "020000002d000000010000000c00000000200000001111111111111111111111111111111111111111111111111111111111111111"
+      "270000000300000001020302000000c0de00000000020000000b0c03010000040000005a5b5c5deeff0001080000000001020304050607");
+  const auto sig = parse_v4_bytes(bytes);
+  CHECK(sig.version == 2);
+  CHECK(sig.hashing_info.hash_algorithm == 1);
+  CHECK(sig.hashing_info.log2_blocksize == 12);
+  CHECK(sig.hashing_info.salt.empty());
+  CHECK(sig.hashing_info.raw_root_hash == std::vector<uint8_t>(32, 0x11));
+  CHECK(sig.signing_info.apk_digest == test::from_hex("010203"));
+  CHECK(sig.signing_info.certificate == test::from_hex("c0de"));
+  CHECK(sig.signing_info.additional_data.empty());
+  CHECK(sig.signing_info.public_key == test::from_hex("0b0c"));
+  CHECK(sig.signing_info.sig_algo_id == 0x0103);
+  CHECK(sig.signing_info.signature == test::from_hex("5a5b5c5d"));
+  CHECK(sig.signing_info_blocks == test::from_hex("eeff0001"));
+  CHECK(sig.merkle_tree == test::from_hex("0001020304050607"));
+
+  std::ostringstream os;
+  write_v4_signature(os, sig);
+  CHECK(os.str() == std::string(bytes.cbegin(), bytes.cend()));
+
+  // The tree is optional, but one that is there has to be whole.
+  CHECK(parse_v4_bytes({bytes.cbegin(), bytes.cend() - 12}).merkle_tree.empty());
+  CHECK_THROWS(parse_v4_bytes({bytes.cbegin(), bytes.cend() - 1}), std::ios_base::failure);
+  auto v3 = bytes;
+  v3[0] = 3;
+  CHECK_THROWS(parse_v4_bytes(v3), parse_error);
+}
+
+APKSIG_TEST(merkle_tree_known_answer) {
+  // 147 leaf blocks, the last one partial: two blocks of leaf hashes under a single root block.
+  std::vector<uint8_t> data(600000);
+  for (size_t i = 0; i < data.size(); i++) data[i] = static_cast<uint8_t>(i * 31 + 7);
+  const auto path = test::scratch_dir() / "data.bin";
+  test::write_file(path, data);
+
+  for (const unsigned threads : {1u, 3u}) {
+    const auto tree = build_merkle_tree(path, {{}, threads});
+    CHECK(tree.data_size == data.size());
+    CHECK(std::vector<uint8_t>(tree.root_hash.cbegin(), tree.root_hash.cend()) ==
+          test::from_hex("a703c3a5b1212de7dd725b22f971889a088e42c553af14604307fa4b9019be2f"));
+    CHECK(tree.tree.size() == 3 * verity_block_size);
+    CHECK(detail::sha_digest(detail::sha_kind::sha256, tree.tree.data(), tree.tree.size()) ==
+          test::from_hex("9f707a51765a3dbe59401bb9316dc549758acdad6630896c65b43f6fad094d5a"));
+
+    const auto salted = build_merkle_tree(path, {{'s', 'a', 'l', 't'}, threads});
+    CHECK(std::vector<uint8_t>(salted.root_hash.cbegin(), salted.root_hash.cend()) ==
+          test::from_hex("033b83166fc395e8eb0efb6658d54d409b5a2c319768a7a5a59cbb3596635d63"));
+
+    v4_signature sig{};
+    sig.hashing_info = {1, 12, {}, {tree.root_hash.cbegin(), tree.root_hash.cend()}};
+    sig.merkle_tree = tree.tree;
+    CHECK(verify_v4_merkle_tree(path, sig, threads));
+    sig.merkle_tree[100] ^= 1;
+    CHECK(!verify_v4_merkle_tree(path, sig, threads));
+  }
+}